@@ -1,6 +1,6 @@
 import { createContext, useEffect, useMemo, useRef, useState } from 'react';
 import MpvPlayer from 'libmpv-wasm/build';
-import { BlurayDiscInfo } from 'libmpv-wasm/build/libmpv';
+import { DiscInfo } from 'libmpv-wasm/build/libmpv';
 
 export const useMpvPlayer = () => {
     const [mpvPlayer, setMpvPlayer] = useState<MpvPlayer>();
@@ -26,7 +26,7 @@ export const useMpvPlayer = () => {
     
     const [uploading, setUploading] = useState('');
     const [fileEnd, setFileEnd] = useState(false);
-    const [bluray, setBluray] = useState<BlurayDiscInfo | null>(null);
+    const [bluray, setBluray] = useState<DiscInfo | null>(null);
     const [menuPictures, setMenuPictures] = useState<Record<string, Record<string, Record<string, HTMLImageElement>>>>({});
     const [menuActivated, setMenuActivated] = useState(false);
     const [menuSelected, setMenuSelected] = useState(0);
@@ -126,6 +126,13 @@ const FileExplorer = ({ onFileClick, openFileExplorer, setOpenFileExplorer }: Fi
                             }
                         >
                             <ListItemButton onClick={async () => {
+                                if (handle.kind === 'file' && handle.name.toLowerCase().endsWith('.iso')) {
+                                    setLoading(true);
+                                    await player?.mpvPlayer?.loadBluray(`${path}/${handle.name}`);
+                                    setLoading(false);
+                                    return setOpenFileExplorer(false);
+                                }
+
                                 if (handle.kind === 'file')
                                     return onFileClick(`${path}/${handle.name}`);
 
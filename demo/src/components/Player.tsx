@@ -5,7 +5,6 @@ import { PlayerContext } from '../MpvPlayerHooks';
 import PlayerControls from './PlayerControls';
 import { useMediaQuery } from '@mui/material';
 import json2mq from 'json2mq';
-import MpvPlayer from 'libmpv-wasm/build';
 
 interface PlayerProps {
     setHideHeader: Dispatch<SetStateAction<boolean>>;
@@ -83,18 +82,20 @@ const Player = ({ setHideHeader }: PlayerProps) => {
 
         // console.log(player.mpvPlayer.module.getFreeMemory());
 
-        const playlist = player.mpvPlayer.blurayDiscInfo?.playlists.get(player.playlistId.toString());
-        if (!playlist) throw new Error('Playlist not found');
+        const discInfo = player.mpvPlayer.blurayDiscInfo;
+        if (!discInfo?.hasPlaylist(player.playlistId)) throw new Error('Playlist not found');
         
-        const page = playlist.igs.menu.pages.get(player.menuPageId);
-        if (!page) throw new Error('Menu not found');
+        const menu = discInfo.getMenuInfo(player.playlistId);
+        if (player.menuPageId >= menu.pageCount) throw new Error('Menu not found');
+        const page = discInfo.getPage(player.playlistId, player.menuPageId);
 
-        ctx.canvas.width = playlist.igs.menu.width;
-        ctx.canvas.height = playlist.igs.menu.height;
+        ctx.canvas.width = menu.width;
+        ctx.canvas.height = menu.height;
         
         player.mpvPlayer.buttonState.forEach(id => {
-            const button = page.buttons.get(id.toString());
-            if (!button) return;
+            if (!discInfo.hasButton(player.playlistId, player.menuPageId, id)) return;
+            const button = discInfo.getButton(player.playlistId, player.menuPageId, id);
+            button.commands.delete();
 
             const state = player.menuSelected === id
                 ? player.menuActivated
@@ -106,8 +107,6 @@ const Player = ({ setHideHeader }: PlayerProps) => {
             
             ctx.drawImage(playlistPictures[state.start][page.palette], button.x, button.y);
         });
-
-        MpvPlayer.destructPlaylist(playlist);
     }, [
         playlistPictures,
         player?.bluray, player?.blurayTitle, player?.overlayRef, player?.playlistId, 
@@ -121,33 +120,25 @@ const Player = ({ setHideHeader }: PlayerProps) => {
         if (player?.menuPageId > -1) {
             if (!player.mpvPlayer) return;
 
-            const playlist = player.mpvPlayer.blurayDiscInfo?.playlists.get(player.playlistId.toString());
-            if (!playlist) return;
-            
-            const nav = playlist?.igs.menu.pages.get(player.menuPageId)
-                ?.buttons.get(player.menuSelected.toString())?.navigation;
-            if (!nav) return;
+            const { HdmvDirection } = module;
 
             switch (e.code) {
                 case 'ArrowUp':
-                    player.mpvPlayer.proxy.menuSelected = nav.up;
+                    player.mpvPlayer.moveSelection(HdmvDirection.UP);
                     break;
                 case 'ArrowDown':
-                    player.mpvPlayer.proxy.menuSelected = nav.down;
+                    player.mpvPlayer.moveSelection(HdmvDirection.DOWN);
                     break;
                 case 'ArrowLeft':
-                    player.mpvPlayer.proxy.menuSelected = nav.left;
+                    player.mpvPlayer.moveSelection(HdmvDirection.LEFT);
                     break;
                 case 'ArrowRight':
-                    player.mpvPlayer.proxy.menuSelected = nav.right;
+                    player.mpvPlayer.moveSelection(HdmvDirection.RIGHT);
                     break;
                 case 'Enter':
                     player.mpvPlayer.menuActivate();
                     break;
             }
-
-            MpvPlayer.destructPlaylist(playlist);
-            player.mpvPlayer.nextMenuCommand();
         } else {
             switch (e.code) {
                 case 'ArrowLeft':
@@ -76,12 +76,10 @@ const PlayerControls = ({ player }: PlayerControlsProps) => {
         return { pointerEvents: mouseIsMoving ? 'auto' : 'none' };
     }, [mouseIsMoving]);
 
-    const marks = useMemo(() => chapters?.filter(({ title }) => title
-        .includes(`(Clip ${(mpvPlayer?.playItemId ?? 0) + 1})`))
-        .map(({ title, time }) => ({
-            label: title.slice(0, title.indexOf(' (Clip')),
-            value: time
-        })), [chapters, mpvPlayer?.playItemId]);
+    const marks = useMemo(() => chapters?.map(({ title, time }) => ({
+        label: title,
+        value: time
+    })), [chapters]);
 
     if (!mpvPlayer) return null;
 
@@ -101,6 +99,7 @@ const PlayerControls = ({ player }: PlayerControlsProps) => {
                             return;
 
                         mpvPlayer.isSeeking = true;
+                        mpvPlayer.scrub(val);
                         setElapsed(val);
                     }}
                     onChangeCommitted={(_, val) => {
@@ -108,7 +107,7 @@ const PlayerControls = ({ player }: PlayerControlsProps) => {
                             return;
 
                         mpvPlayer.isSeeking = false;
-                        mpvPlayer.module.setPlaybackTime(val);
+                        mpvPlayer.setPlaybackTime(val);
                     }}
                     marks={marks && marks.length > 1 ? marks : false}
                     disabled={!mouseIsMoving || (!!mpvPlayer.blurayDiscInfo && mpvPlayer.blurayTitle === 0)}
@@ -132,24 +131,11 @@ const PlayerControls = ({ player }: PlayerControlsProps) => {
                         onClick={() => mpvPlayer.module.skipForward()}
                         style={pointerStyle}
                     />
-                    { (menuCallAllow || (player.blurayTitle === 0 && player.mpvPlayer?.resumeInfo)) &&
+                    { (menuCallAllow || (player.blurayTitle === 0 && player.mpvPlayer?.hasResume)) &&
                     <FontAwesomeIcon 
                         icon={player.blurayTitle === 0 ? faFilm : faBars} 
                         onClick={() => player.blurayTitle === 0
-                            ? mpvPlayer.executeCommand({
-                                insn: {
-                                    opCnt: 0,
-                                    grp: 0,
-                                    subGrp: 1,
-                                    immOp1: 0,
-                                    immOp2: 0,
-                                    branchOpt: 4,
-                                    cmpOpt: 0,
-                                    setOpt: 0
-                                },
-                                dst: 0,
-                                src: 0
-                            }, true)
+                            ? mpvPlayer.resumePlayback()
                             : mpvPlayer.openTopMenu() }
                         style={pointerStyle}
                     /> }
@@ -157,8 +143,8 @@ const PlayerControls = ({ player }: PlayerControlsProps) => {
                     <FontAwesomeIcon 
                         icon={faCompass} 
                         onClick={() => mpvPlayer.menuPageId < 0
-                            ? mpvPlayer.nextMenuCommand()
-                            : mpvPlayer.resetMenu()
+                            ? mpvPlayer.popupOn()
+                            : mpvPlayer.popupOff()
                         }
                         style={pointerStyle}
                     /> }
@@ -218,20 +204,7 @@ const PlayerControls = ({ player }: PlayerControlsProps) => {
                         <MenuItem key={`chapter_${i}`} 
                             onClick={() => {
                                 if (player.bluray) {
-                                    player.mpvPlayer?.executeCommand({
-                                        insn: {
-                                            opCnt: 2,
-                                            grp: 0,
-                                            subGrp: 2,
-                                            immOp1: 1,
-                                            immOp2: 1,
-                                            branchOpt: 2,
-                                            cmpOpt: 0,
-                                            setOpt: 0
-                                        },
-                                        dst: player.playlistId,
-                                        src: i
-                                    }, true);
+                                    player.mpvPlayer?.playMark(i);
                                     return;
                                 }
                                 
@@ -0,0 +1,38 @@
+#ifndef BD_CHAPTERS_H
+#define BD_CHAPTERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include "thumbnail.h"
+#include "libbluray.h"
+
+using namespace std;
+
+// Chapters are decoded by up to this many threads at once, each with its
+// own single threaded decoder.
+const uint32_t BD_CHAPTER_WORKERS = 4;
+
+// Thumbnail for an entry mark. time is in seconds on the playlist
+// timeline, and image is a base64 PNG, empty if the frame couldn't be
+// decoded.
+typedef struct bd_chapter_thumbnail_t {
+    uint32_t mark_idx;
+    double time;
+    string image;
+} bd_chapter_thumbnail_t;
+
+// Decodes the keyframe at or before every entry mark of the playlist and
+// caches the result per disc, playlist and width. Blocks until done, so
+// call it off the main thread. Clips inside disc images aren't reachable
+// by path and give no thumbnails.
+vector<bd_chapter_thumbnail_t> bd_chapter_thumbnails(DiscInfo disc, string disc_path, uint32_t playlist_id, int width);
+
+// Cached thumbnails only, empty if they haven't been generated yet.
+vector<bd_chapter_thumbnail_t> bd_get_chapter_thumbnails(string disc_path, uint32_t playlist_id, int width);
+
+#endif /* BD_CHAPTERS_H */
@@ -0,0 +1,40 @@
+#ifndef BD_IMAGE_H
+#define BD_IMAGE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <istream>
+#include <fstream>
+#include <libbluray/bluray.h>
+#include <libbluray/filesystem.h>
+
+using namespace std;
+
+// UDF sectors are read in aligned runs of BD_IMAGE_BLOCK_SECTORS, and the
+// most recent runs are kept up to BD_IMAGE_CACHE_SIZE.
+const int BD_IMAGE_SECTOR_SIZE = 2048;
+const int BD_IMAGE_BLOCK_SECTORS = 32;
+const int64_t BD_IMAGE_CACHE_SIZE = 32 * 1024 * 1024;
+
+bool bd_image_is_iso(string path);
+
+// Opens a disc image through libbluray's UDF reader on top of the block
+// cache. Handles from bd_image_open must be closed with bd_image_close.
+BLURAY *bd_image_open(string path);
+void bd_image_close(BLURAY *bd);
+
+// Reads "<image>/BDMV/..." paths from inside the image and anything else
+// from the filesystem, so path based parsers work for both layouts.
+unique_ptr<istream> bd_image_open_stream(string path);
+
+#endif /* BD_IMAGE_H */
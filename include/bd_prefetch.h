@@ -0,0 +1,33 @@
+#ifndef BD_PREFETCH_H
+#define BD_PREFETCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <libbluray/bluray.h>
+#include <libbluray/filesystem.h>
+#include "libbluray.h"
+
+using namespace std;
+
+// Bytes warmed from the start of each clip, and the cap over all clips.
+const int64_t BD_PREFETCH_SIZE = 8 * 1024 * 1024;
+const int64_t BD_PREFETCH_CACHE_SIZE = 64 * 1024 * 1024;
+const uint32_t BD_PREFETCH_MAX_PLAYLISTS = 4;
+
+void bd_prefetch_set_disc(string path);
+void bd_prefetch_clip(string clip_id);
+void bd_prefetch_next(DiscInfo disc, uint32_t playlist_id, uint32_t play_item, vector<uint32_t> playlist_ids);
+
+// libbluray file callbacks for bd_open_files; handle is the disc root as a string*.
+BD_DIR_H *bd_prefetch_dir_open(void *handle, const char *rel_path);
+BD_FILE_H *bd_prefetch_file_open(void *handle, const char *rel_path);
+
+#endif /* BD_PREFETCH_H */
@@ -0,0 +1,58 @@
+#ifndef BD_STREAM_H
+#define BD_STREAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <mpv/client.h>
+#include <mpv/stream_cb.h>
+#include <libbluray/bluray.h>
+#include "bd_prefetch.h"
+#include "bd_image.h"
+
+using namespace std;
+
+// Playlists are opened as BD_STREAM_PROTOCOL "://<playlist id>".
+const char BD_STREAM_PROTOCOL[] = "bdpl";
+
+// Source packets are a 4 byte arrival timestamp and a 188 byte TS packet.
+// Reads are buffered in whole aligned units of 32 of them.
+const uint32_t BD_SOURCE_PACKET = 192;
+const uint32_t BD_STREAM_BUFFER = 32 * 6144;
+
+// reply_userdata of the unthrottled playback-time observer the clip
+// transition measurement reads, after the shader tier ids.
+const uint64_t BD_STREAM_TIME_ID = (1ull << 32) + 4;
+
+// Wall time a transition into play_item took beyond the playlist time
+// that passed over it, in milliseconds.
+typedef struct bd_clip_gap_t {
+    uint32_t playlist_id;
+    uint32_t play_item;
+    double gap;
+} bd_clip_gap_t;
+
+int bd_stream_register(mpv_handle *mpv);
+void bd_stream_set_disc(string path);
+string bd_stream_uri(uint32_t playlist_id);
+
+// Each clip keeps its own PTS, so timestamps are moved onto the playlist
+// timeline as they're read: a clip's in_time lands at its start_time in
+// the playlist, offset by the first clip's in_time. playback-time is then
+// playlist time across the whole stream.
+
+// For the thread handling mpv events, with every playback-time change of
+// a playlist. Seeks, pauses and new files reset it, so they aren't taken
+// for gaps.
+void bd_stream_on_playback_time(double time);
+void bd_stream_reset_timing();
+
+// Transitions measured since the last call.
+vector<bd_clip_gap_t> bd_stream_take_gaps();
+
+#endif /* BD_STREAM_H */
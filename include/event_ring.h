@@ -0,0 +1,71 @@
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mpv/client.h>
+
+using namespace std;
+
+// Records waiting for JS. The capacity has to be a power of two so the
+// free running indices wrap cleanly; JS is asked to drain early once
+// EVENT_RING_HIGH_WATER records are waiting.
+const uint32_t EVENT_RING_CAPACITY = 4096;
+const uint32_t EVENT_RING_HIGH_WATER = 3072;
+
+typedef enum event_ring_type {
+    EVENT_RING_IDLE,
+    EVENT_RING_FILE_START,
+    EVENT_RING_FILE_END,
+    EVENT_RING_PROPERTY_CHANGE,
+    EVENT_RING_LIBRARY_UPDATE,
+    // property holds the request's reply id and value its mpv error code.
+    EVENT_RING_COMMAND_REPLY,
+    // property holds the adaptive shader tier, or -1 if the preset was
+    // picked by hand, and value the preset's name.
+    EVENT_RING_SHADER_PRESET,
+} event_ring_type;
+
+// Fixed layout read straight out of the heap by MpvPlayer. format is the
+// mpv_format of value; strings are a pointer and length into a buffer
+// that stays put until the consumer has moved past the record.
+typedef struct event_record_t {
+    uint32_t type;
+    int32_t property;
+    uint32_t format;
+    uint32_t length;
+    union {
+        double f;
+        int64_t i;
+        uint32_t str;
+    } value;
+} event_record_t;
+
+// Heap offsets for the consumer. head is only written by the producer
+// and tail only by the consumer.
+typedef struct event_ring_info_t {
+    uint32_t records;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t capacity;
+    uint32_t record_size;
+} event_ring_info_t;
+
+// Producer side, only ever called from the event thread. data points at a
+// value of the given format, like mpv_event_property::data. Returns the
+// number of records waiting including this one, or -1 if the ring was
+// full and the record was dropped.
+int64_t event_ring_push(event_ring_type type, int32_t property, mpv_format format, void *data);
+
+// Properties are numbered the first time they're pushed. Names can be
+// looked up from any thread.
+int32_t event_ring_property_id(const char *name);
+string event_ring_property_name(int32_t property);
+
+event_ring_info_t event_ring_get_info();
+
+#endif /* EVENT_RING_H */
@@ -0,0 +1,49 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// Render times are counted in 1 ms buckets; the last one takes everything
+// at or over FRAME_STATS_BUCKETS - 1 ms.
+const uint32_t FRAME_STATS_BUCKETS = 34;
+
+// Ticks this much longer than the measured vsync interval count as
+// missed frames; shorter ones refine the interval.
+const double FRAME_STATS_LATE_TICK = 1.5;
+const double FRAME_STATS_VSYNC_SMOOTHING = 0.05;
+
+// vsync_interval and missed_frames are only measured while frames are
+// paced to the display, which display_sync says. render_scale is what the
+// frame time budget currently takes off the render size.
+typedef struct frame_stats_t {
+    uint32_t frames;
+    double average_time;
+    double max_time;
+    vector<uint32_t> histogram;
+    bool display_sync;
+    double vsync_interval;
+    uint32_t missed_frames;
+    uint32_t render_width;
+    uint32_t render_height;
+    double render_scale;
+} frame_stats_t;
+
+// Called by the render thread with the time a frame took in milliseconds.
+void frame_stats_record(double time);
+
+// Called by the render thread on every animation frame while paced to the
+// display, with its timestamp in milliseconds. Returns the vsync interval
+// measured so far, or 0 before there is one.
+double frame_stats_vsync(double now);
+void frame_stats_set_display_sync(bool display_sync);
+void frame_stats_set_render_size(uint32_t width, uint32_t height, double scale);
+
+frame_stats_t frame_stats_get();
+void frame_stats_reset();
+
+#endif /* FRAME_STATS_H */
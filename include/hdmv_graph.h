@@ -0,0 +1,18 @@
+#ifndef HDMV_GRAPH_H
+#define HDMV_GRAPH_H
+
+#include <vector>
+#include <map>
+#include <deque>
+#include "libbluray.h"
+#include "hdmv_insn.h"
+
+using namespace std;
+
+// Jumps followed past an object's own PLAY commands when predicting.
+const uint32_t HDMV_GRAPH_DEPTH = 2;
+
+nav_targets_t decode_nav_targets(const vector<bluray_mobj_cmd_t> &cmds);
+bluray_nav_graph_t build_nav_graph(const bluray_disc_info_t &info);
+
+#endif /* HDMV_GRAPH_H */
@@ -1,56 +1,51 @@
+#ifndef HDMV_INSN_H
+#define HDMV_INSN_H
+
 /*
  * instruction groups
  */
 
-const enum HDMV_INSN_GRP {
+enum hdmv_insn_grp {
     INSN_GROUP_BRANCH = 0,
     INSN_GROUP_CMP    = 1,
     INSN_GROUP_SET    = 2,
-}
-
-/*
- * BRANCH group
- */
+};
 
 /* BRANCH sub-groups */
-const enum HDMV_INSN_GRP_BRANCH {
+enum hdmv_insn_grp_branch {
     BRANCH_GOTO   = 0x00,
     BRANCH_JUMP   = 0x01,
     BRANCH_PLAY   = 0x02,
-}
+};
 
 /* GOTO sub-group */
-const enum HDMV_INSN_GOTO {
+enum hdmv_insn_goto {
     INSN_NOP          = 0x00,
     INSN_GOTO         = 0x01,
     INSN_BREAK        = 0x02,
-}
+};
 
 /* JUMP sub-group */
-
-const enum HDMV_INSN_JUMP {
+enum hdmv_insn_jump {
     INSN_JUMP_OBJECT  = 0x00,
     INSN_JUMP_TITLE   = 0x01,
     INSN_CALL_OBJECT  = 0x02,
     INSN_CALL_TITLE   = 0x03,
     INSN_RESUME       = 0x04,
-}
+};
 
 /* PLAY sub-group */
-const enum HDMV_INSN_PLAY {
+enum hdmv_insn_play {
     INSN_PLAY_PL      = 0x00,
     INSN_PLAY_PL_PI   = 0x01,
     INSN_PLAY_PL_PM   = 0x02,
     INSN_TERMINATE_PL = 0x03,
     INSN_LINK_PI      = 0x04,
     INSN_LINK_MK      = 0x05,
-}
+};
 
-/*
- * COMPARE group
- */
-
-const enum HDMV_INSN_CMP {
+/* COMPARE group */
+enum hdmv_insn_cmp {
     INSN_BC = 0x01,
     INSN_EQ = 0x02,
     INSN_NE = 0x03,
@@ -58,19 +53,16 @@ const enum HDMV_INSN_CMP {
     INSN_GT = 0x05,
     INSN_LE = 0x06,
     INSN_LT = 0x07,
-}
-
-/*
- * SET group
- */
+};
 
 /* SET sub-groups */
-const enum HDMV_INSN_GRP_SET {
+enum hdmv_insn_grp_set {
     SET_SET       = 0x00,
     SET_SETSYSTEM = 0x01,
-}
+};
+
 /* SET sub-group */
-const enum HDMV_INSN_SET {
+enum hdmv_insn_set {
     INSN_MOVE   = 0x01,
     INSN_SWAP   = 0x02,
     INSN_ADD    = 0x03,
@@ -86,10 +78,10 @@ const enum HDMV_INSN_SET {
     INSN_BITCLR = 0x0d,
     INSN_SHL    = 0x0e,
     INSN_SHR    = 0x0f,
-}
+};
 
 /* SETSYSTEM sub-group */
-const enum HDMV_INSN_SETSYSTEM {
+enum hdmv_insn_setsystem {
     INSN_SET_STREAM      = 0x01,
     INSN_SET_NV_TIMER    = 0x02,
     INSN_SET_BUTTON_PAGE = 0x03,
@@ -103,4 +95,6 @@ const enum HDMV_INSN_SETSYSTEM {
     INSN_SET_STREAM_SS   = 0x0b,
 
     INSN_SETSYSTEM_0x10  = 0x10,
-}
\ No newline at end of file
+};
+
+#endif /* HDMV_INSN_H */
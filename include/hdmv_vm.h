@@ -0,0 +1,172 @@
+#ifndef HDMV_VM_H
+#define HDMV_VM_H
+
+#include <vector>
+#include <cstdlib>
+#include "libbluray.h"
+#include "hdmv_insn.h"
+
+using namespace std;
+
+const uint32_t HDMV_GPR_COUNT = 4096;
+const uint32_t HDMV_PSR_COUNT = 128;
+const uint32_t HDMV_MAX_STEPS = 0x10000;
+const uint16_t HDMV_NO_BUTTON = 0xFFFF;
+const uint32_t HDMV_FIRST_PLAY = 0xFFFF;
+
+enum hdmv_psr {
+    PSR_IG_STREAM_ID       = 0,
+    PSR_PRIMARY_AUDIO_ID   = 1,
+    PSR_PG_STREAM          = 2,
+    PSR_ANGLE_NUMBER       = 3,
+    PSR_TITLE_NUMBER       = 4,
+    PSR_CHAPTER            = 5,
+    PSR_PLAYLIST           = 6,
+    PSR_PLAYITEM           = 7,
+    PSR_TIME               = 8,
+    PSR_NAV_TIMER          = 9,
+    PSR_SELECTED_BUTTON_ID = 10,
+    PSR_MENU_PAGE_ID       = 11,
+    PSR_PARENTAL           = 13,
+    PSR_AUDIO_CAP          = 15,
+    PSR_AUDIO_LANG         = 16,
+    PSR_PG_AND_SUB_LANG    = 17,
+    PSR_MENU_LANG          = 18,
+    PSR_COUNTRY            = 19,
+    PSR_REGION             = 20,
+    PSR_TITLE_NUMBER_ALT   = 36,
+    PSR_CHAPTER_ALT        = 37,
+};
+
+enum hdmv_action_type {
+    HDMV_ACTION_PLAY_PL      = 1,
+    HDMV_ACTION_STOP         = 2,
+    HDMV_ACTION_MENU_PAGE    = 3,
+    HDMV_ACTION_BUTTON_STATE = 4,
+    HDMV_ACTION_POPUP_OFF    = 5,
+    HDMV_ACTION_SET_STREAM   = 6,
+};
+
+enum hdmv_direction {
+    HDMV_DIRECTION_UP    = 0,
+    HDMV_DIRECTION_DOWN  = 1,
+    HDMV_DIRECTION_LEFT  = 2,
+    HDMV_DIRECTION_RIGHT = 3,
+};
+
+// Result of a whole batch of instructions. Only these cross back into JS;
+// register updates, compares and gotos stay inside the VM.
+typedef struct hdmv_action_t {
+    hdmv_action_type type;
+    uint32_t playlist;
+    uint32_t play_item;
+    double start;
+    uint8_t audio_flag;
+    uint32_t audio_stream;
+    uint8_t pg_flag;
+    uint8_t pg_display;
+    uint32_t pg_stream;
+    int32_t page;
+    uint16_t button;
+    uint32_t delay;
+} hdmv_action_t;
+
+typedef struct hdmv_state_t {
+    uint32_t title;
+    uint32_t object;
+    uint32_t object_pc;
+    uint32_t playlist;
+    uint32_t play_item;
+    int32_t menu_page;
+    uint16_t menu_selected;
+    bool menu_activated;
+    bool menu_call_allow;
+    bool has_popup_menu;
+    bool has_resume;
+} hdmv_state_t;
+
+typedef struct hdmv_resume_t {
+    bool valid;
+    uint32_t title;
+    uint32_t object;
+    uint32_t object_pc;
+    uint32_t playlist;
+    uint32_t play_item;
+    uint32_t time;
+} hdmv_resume_t;
+
+class HdmvVm {
+public:
+    HdmvVm(DiscInfo disc);
+
+    vector<hdmv_action_t> start();
+    vector<hdmv_action_t> playlist_end();
+    vector<hdmv_action_t> run_command(bluray_mobj_cmd_t cmd, bool menu);
+    vector<hdmv_action_t> top_menu();
+    vector<hdmv_action_t> resume();
+    vector<hdmv_action_t> play_mark(uint32_t playlist_id, uint32_t mark_idx);
+    vector<hdmv_action_t> popup_on();
+    vector<hdmv_action_t> popup_off();
+    vector<hdmv_action_t> select_button(uint16_t button_id);
+    vector<hdmv_action_t> move_selection(hdmv_direction direction);
+    vector<hdmv_action_t> activate_button();
+
+    void set_playback_position(uint32_t play_item, uint32_t chapter, double time);
+    void set_audio_stream(uint32_t stream);
+    void set_pg_stream(uint32_t stream, bool display);
+
+    uint32_t get_psr(uint32_t idx) const;
+    uint32_t get_gpr(uint32_t idx) const;
+    hdmv_state_t get_state() const;
+    vector<uint16_t> get_button_state() const;
+    vector<uint32_t> get_likely_playlists() const;
+
+private:
+    enum step_result {
+        STEP_NEXT,
+        STEP_BREAK,
+        STEP_JUMP,
+        STEP_PLAY,
+    };
+
+    DiscInfo disc;
+    uint32_t gpr[HDMV_GPR_COUNT];
+    uint32_t psr[HDMV_PSR_COUNT];
+
+    uint32_t title;
+    uint32_t object;
+    uint32_t object_pc;
+
+    int32_t menu_page;
+    uint32_t menu_pc;
+    bool menu_activated;
+    bool menu_initiated;
+    vector<uint16_t> button_state;
+
+    hdmv_resume_t resume_info;
+    vector<hdmv_action_t> actions;
+
+    vector<hdmv_action_t> take_actions();
+    void run_object();
+    void run_menu();
+    step_result execute(const bluray_mobj_cmd_t &cmd, bool menu);
+    void advance(bool menu);
+
+    uint32_t read_reg(uint32_t reg) const;
+    void write_reg(uint32_t reg, uint32_t value);
+
+    void jump_title(uint32_t new_title);
+    void jump_object(uint32_t new_object);
+    void save_resume(uint32_t pc);
+    step_result play(uint32_t playlist_id, uint32_t play_item, double start, bool menu);
+    step_result play_mark_internal(uint32_t playlist_id, uint32_t mark_idx, bool menu);
+    step_result resume_internal();
+
+    void reset_menu();
+    void init_menu_page(uint32_t page_id, uint16_t selected);
+    void set_stream(const bluray_mobj_cmd_t &cmd);
+    bool set_button_page(const bluray_mobj_cmd_t &cmd);
+    void enable_button(uint16_t button_id, bool enable);
+};
+
+#endif /* HDMV_VM_H */
@@ -144,12 +144,15 @@ typedef struct picture_extended_t {
     map<string, string> data;
 } picture_extended_t;
 
+// background_clips are the clips the video under the menu may come from,
+// filled in by the disc reader rather than the IGS parser.
 typedef struct igs_t {
     menu_t menu;
     vector<vector<color_t>> palettes;
     map<string, picture_extended_t> pictures;
+    vector<string> background_clips;
 } igs_t;
 
-igs_t extract_menu(char const *filename);
+igs_t extract_menu(istream &stream);
 
 #endif /* IGS_READER_H */
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef KEYFRAME_INDEX_H
+#define KEYFRAME_INDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libavutil/avutil.h>
+}
+
+using namespace std;
+
+// Indexes read back from disk are kept in memory for this many files.
+const uint32_t KEYFRAME_INDEX_MEMORY = 16;
+
+// Keyframe PTS and byte offsets of a file's video stream, sorted by PTS.
+// Times are in the stream's time base and include its start_time. The
+// file it was built from is identified by size and mtime.
+typedef struct keyframe_index_t {
+    int64_t size;
+    int64_t mtime;
+    int stream_index;
+    AVRational time_base;
+    int64_t start_time;
+    vector<int64_t> pts;
+    vector<int64_t> pos;
+} keyframe_index_t;
+
+// Where indexes are stored, one file per media file. Nothing is written
+// until this is set.
+void keyframe_index_set_dir(string dir);
+
+// Queues path to be indexed in the background, unless an up to date index
+// is already stored for it. Indexing only demuxes; nothing is decoded.
+void keyframe_index_request(string path);
+
+// Stored index for path, or NULL if there's none or the file changed
+// since it was built.
+shared_ptr<const keyframe_index_t> keyframe_index_get(string path);
+
+// Time in seconds from the start of the stream of the keyframe nearest to
+// time, or at or before it if before is set. Returns false without an index.
+bool keyframe_index_find(string path, double time, bool before, double *keyframe_time);
+
+// Seeks format to the keyframe at or before time using the index of the
+// file it was opened from, by byte offset for MPEG TS/PS and by the
+// keyframe's exact timestamp otherwise.
+// Returns false, leaving format as it was, if there's no usable index.
+bool keyframe_index_seek(AVFormatContext *format, int stream_index, double time);
+
+#endif /* KEYFRAME_INDEX_H */
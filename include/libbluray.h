@@ -2,14 +2,23 @@
 #define LIBBLURAY_H
 
 #include <string>
+#include <memory>
+#include <map>
+#include <pthread.h>
+#include <algorithm>
 #include <cassert>
 #include <libbluray/bluray.h>
 #include <libbluray/mpls_data.h>
+#include <libbluray/clpi_data.h>
 #include "igs_reader.h"
+#include "bd_image.h"
+#include "thumbnail.h"
 
 using namespace std;
 
 const uint8_t MAX_THREADS = 15;
+// Menu background stills are scaled down to this width.
+const int MENU_BACKGROUND_WIDTH = 960;
 
 typedef struct bluray_mobj_object_t {
     uint8_t resume_intention_flag;
@@ -25,30 +34,178 @@ typedef struct bluray_mobj_objects_t {
     vector<bluray_mobj_object_t> objects;
 } bluray_mobj_objects_t;
 
+// A stream from the clip's STN table. track_id is the mpv track id the
+// stream's PID gets from the demuxer, or 0 if it isn't in the clip.
+typedef struct bluray_stream_attr_t {
+    uint16_t pid;
+    uint8_t coding_type;
+    string lang;
+    uint32_t track_id;
+} bluray_stream_attr_t;
+
 typedef struct bluray_clip_info_t {
     string clip_id;
     uint64_t in_time;
     uint64_t out_time;
+    vector<bluray_stream_attr_t> audio_streams;
+    vector<bluray_stream_attr_t> pg_streams;
 } bluray_clip_info_t;
 
+// Entry point from a clip's CLPI EP map, placed on the playlist timeline.
+typedef struct bluray_ep_entry_t {
+    uint64_t time;
+    uint32_t play_item;
+} bluray_ep_entry_t;
+
+// Playlist time (90kHz) to I-frame lookups, sorted by time.
+typedef struct bluray_time_index_t {
+    vector<uint64_t> play_item_starts;
+    vector<uint64_t> mark_starts;
+    vector<bluray_ep_entry_t> entries;
+} bluray_time_index_t;
+
 typedef struct bluray_playlist_info_t {
     uint32_t playlist_id;
     vector<bluray_clip_info_t> clips;
     vector<BLURAY_TITLE_MARK> marks;
     igs_t igs;
+    bluray_time_index_t time_index;
 } bluray_playlist_info_t;
 
+// Immediate branch targets decoded from a command list.
+typedef struct nav_targets_t {
+    vector<uint32_t> objects;
+    vector<uint32_t> titles;
+    vector<uint32_t> playlists;
+} nav_targets_t;
+
+// Static reachability over movie objects and IGS buttons. Playlists are
+// ordered by the number of jumps needed to reach them.
+typedef struct bluray_nav_graph_t {
+    vector<nav_targets_t> objects;
+    vector<vector<uint32_t>> object_playlists;
+    map<uint32_t, vector<vector<uint32_t>>> page_playlists;
+} bluray_nav_graph_t;
+
 typedef struct bluray_disc_info_t {
     string disc_name;
     uint32_t num_playlists;
-    map<string, bluray_playlist_info_t> playlists;
+    map<uint32_t, bluray_playlist_info_t> playlists;
     uint8_t first_play_supported;
     uint32_t first_play_idx;
     uint8_t top_menu_supported;
     vector<uint32_t> title_map;
     bluray_mobj_objects_t mobj;
+    bluray_nav_graph_t nav_graph;
 } bluray_disc_info_t;
 
+typedef struct menu_info_t {
+    uint16_t width;
+    uint16_t height;
+    uint8_t page_count;
+} menu_info_t;
+
+typedef struct page_info_t {
+    uint8_t id;
+    uint8_t framerate_divider;
+    uint16_t def_button;
+    uint16_t def_activated;
+    uint8_t palette;
+    uint8_t bog_count;
+    uint32_t in_effects_duration;
+    uint32_t out_effects_duration;
+} page_info_t;
+
+typedef struct time_entry_t {
+    double time;
+    uint32_t play_item;
+} time_entry_t;
+
+// Handle over disc info kept in native storage. Accessors only convert
+// the piece that was asked for, so JS never pays for the whole disc.
+class DiscInfo {
+public:
+    DiscInfo() {}
+    DiscInfo(shared_ptr<const bluray_disc_info_t> info) : info(info) {}
+
+    string disc_name() const;
+    uint32_t num_playlists() const;
+    bool first_play_supported() const;
+    uint32_t first_play_idx() const;
+    bool top_menu_supported() const;
+    uint32_t num_titles() const;
+    uint32_t get_title_object(uint32_t title) const;
+
+    uint16_t num_objects() const;
+    bluray_mobj_object_t get_object(uint32_t object_idx) const;
+    uint16_t get_object_command_count(uint32_t object_idx) const;
+    bluray_mobj_cmd_t get_object_command(uint32_t object_idx, uint32_t cmd_idx) const;
+
+    vector<uint32_t> get_playlist_ids() const;
+    bool has_playlist(uint32_t playlist_id) const;
+    uint32_t get_clip_count(uint32_t playlist_id) const;
+    bluray_clip_info_t get_clip(uint32_t playlist_id, uint32_t clip_idx) const;
+    vector<bluray_clip_info_t> get_clips(uint32_t playlist_id) const;
+    uint32_t get_mark_count(uint32_t playlist_id) const;
+    BLURAY_TITLE_MARK get_mark(uint32_t playlist_id, uint32_t mark_idx) const;
+
+    time_entry_t find_time_entry(uint32_t playlist_id, double time) const;
+    uint32_t find_play_item(uint32_t playlist_id, double time) const;
+    uint32_t find_chapter(uint32_t playlist_id, double time) const;
+    double get_play_item_time(uint32_t playlist_id, uint32_t play_item) const;
+    vector<uint32_t> get_likely_playlists(uint32_t object_idx, uint32_t playlist_id, int32_t page_id) const;
+
+    vector<bluray_stream_attr_t> get_audio_streams(uint32_t playlist_id, uint32_t play_item) const;
+    vector<bluray_stream_attr_t> get_pg_streams(uint32_t playlist_id, uint32_t play_item) const;
+    uint32_t get_audio_track(uint32_t playlist_id, uint32_t play_item, uint32_t stream) const;
+    uint32_t get_pg_track(uint32_t playlist_id, uint32_t play_item, uint32_t stream) const;
+    uint32_t find_audio_stream(uint32_t playlist_id, uint32_t play_item, uint32_t track_id) const;
+    uint32_t find_pg_stream(uint32_t playlist_id, uint32_t play_item, uint32_t track_id) const;
+
+    menu_info_t get_menu_info(uint32_t playlist_id) const;
+    page_info_t get_page(uint32_t playlist_id, uint32_t page_id) const;
+    vector<uint16_t> get_page_default_buttons(uint32_t playlist_id, uint32_t page_id) const;
+    int get_button_group(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const;
+    bool has_button(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const;
+    button_t get_button(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const;
+    vector<uint16_t> get_picture_ids(uint32_t playlist_id) const;
+    picture_extended_t get_picture(uint32_t playlist_id, uint16_t picture_id) const;
+
+    // Native-only lookups, not bound to JS.
+    const bluray_mobj_object_t *find_object(uint32_t object_idx) const;
+    const bluray_playlist_info_t *find_playlist(uint32_t playlist_id) const;
+    const page_t *find_page(uint32_t playlist_id, uint32_t page_id) const;
+    const button_t *find_button(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const;
+    const bluray_clip_info_t *find_clip(uint32_t playlist_id, uint32_t play_item) const;
+
+private:
+    shared_ptr<const bluray_disc_info_t> info;
+};
+
+// Light scan of a disc: just the index and title list, without menus,
+// clip info or the navigation graph. Coding types and format are from
+// the main title's first clip.
+typedef struct bluray_disc_summary_t {
+    string disc_name;
+    uint32_t num_titles;
+    uint32_t main_playlist;
+    double duration;
+    string main_clip_id;
+    uint8_t video_coding_type;
+    uint8_t video_format;
+    uint8_t audio_coding_type;
+} bluray_disc_summary_t;
+
 bluray_disc_info_t open_bd_disc(string path);
+bool probe_bd_disc(string path, bluray_disc_summary_t *summary);
+
+// Decodes a still for every menu playlist of the disc and caches them per
+// disc, as base64 PNGs keyed by playlist. Blocks until done, so call it off
+// the main thread. Disc open leaves this out since it costs a decode per
+// menu, pop-up menus included.
+map<uint32_t, string> bd_menu_backgrounds(DiscInfo disc, string disc_path);
+
+// Cached still only, empty if it hasn't been decoded yet or there is none.
+string bd_get_menu_background(string disc_path, uint32_t playlist_id);
 
 #endif /* LIBBLURAY_H */
\ No newline at end of file
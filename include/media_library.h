@@ -0,0 +1,59 @@
+#ifndef MEDIA_LIBRARY_H
+#define MEDIA_LIBRARY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <filesystem>
+#include "thumbnail.h"
+#include "libbluray.h"
+#include "bd_image.h"
+
+using namespace std;
+
+// Probing stops after this many bytes / microseconds of input, so a file
+// costs about the same no matter how long it is.
+const uint32_t LIBRARY_WORKERS = 4;
+const int64_t LIBRARY_PROBE_SIZE = 1024 * 1024;
+const int64_t LIBRARY_ANALYZE_DURATION = 1000000;
+const double LIBRARY_POSTER_POSITION = 0.1;
+const int LIBRARY_POSTER_WIDTH = 320;
+
+// A media file, BDMV root or disc image found under a scanned directory.
+// Updates for entries that disappeared on rescan have removed set.
+typedef struct library_entry_t {
+    string path;
+    bool is_disc;
+    bool removed;
+    int64_t size;
+    int64_t mtime;
+    double duration;
+    string title;
+    string video_codec;
+    string audio_codec;
+    uint32_t width;
+    uint32_t height;
+    uint32_t title_count;
+    string poster;
+} library_entry_t;
+
+// Starts scanning root in the background. Unchanged entries from earlier
+// scans are kept without probing them again. Returns false if a scan is
+// already running.
+bool library_scan(string root);
+bool library_is_scanning();
+
+// Entries added, changed or removed since the last call.
+vector<library_entry_t> library_take_updates();
+vector<library_entry_t> library_get_entries();
+
+// Called from scanner threads whenever updates are waiting.
+void library_set_notify(void (*notify)());
+
+#endif /* MEDIA_LIBRARY_H */
@@ -0,0 +1,17 @@
+#ifndef NODE_JSON_H
+#define NODE_JSON_H
+
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <mpv/client.h>
+
+using namespace std;
+
+// Appends node to out as JSON in one walk, nested maps and arrays
+// included. Integers are written as plain numbers and flags as 0 or 1,
+// like the track fields JS already reads. Values JSON can't hold (byte
+// arrays, NaN, infinities) become null.
+void node_to_json(const mpv_node *node, string &out);
+
+#endif /* NODE_JSON_H */
@@ -0,0 +1,44 @@
+#ifndef PROPERTY_FILTER_H
+#define PROPERTY_FILTER_H
+
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+#include <string>
+#include <map>
+#include <chrono>
+#include <mpv/client.h>
+
+using namespace std;
+
+// How changes of an observed property are coalesced before they reach
+// JS. max_rate is in Hz, with 0 for no limit; changes inside the interval
+// are held and only the newest is sent once it's over. min_delta drops
+// numeric changes smaller than it, relative to the last value sent, and
+// on_change drops values equal to the last one sent. Node values are
+// never held or compared.
+typedef struct property_policy_t {
+    double max_rate;
+    double min_delta;
+    bool on_change;
+} property_policy_t;
+
+// One subscription per name; observing a name again replaces its format
+// and policy. Safe to call from any thread.
+bool property_observe(mpv_handle *mpv, string name, mpv_format format, property_policy_t policy);
+bool property_unobserve(mpv_handle *mpv, string name);
+
+// The rest is for the thread handling mpv events. Returns whether a
+// property change event should be forwarded now; events that weren't
+// observed through property_observe are always forwarded.
+bool property_filter_accept(uint64_t reply_userdata, mpv_event_property *property);
+
+typedef void (*property_emit_t)(const char *name, mpv_format format, void *data);
+
+// Sends held values whose interval is over.
+void property_filter_flush(property_emit_t emit);
+
+// Milliseconds until the next held value is due, or -1 if none are held.
+int32_t property_filter_next_flush();
+
+#endif /* PROPERTY_FILTER_H */
@@ -0,0 +1,42 @@
+#ifndef SCRUB_PREVIEW_H
+#define SCRUB_PREVIEW_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include "thumbnail.h"
+
+using namespace std;
+
+// Decoded previews kept per open file, keyed by keyframe and width.
+const uint32_t SCRUB_CACHE_FRAMES = 96;
+const int SCRUB_MAX_WIDTH = 640;
+
+typedef struct scrub_frame_t {
+    double keyframe_time;
+    int width;
+    int height;
+    vector<uint8_t> rgba;
+} scrub_frame_t;
+
+typedef void (*scrub_done_t)(void *arg);
+
+// Keeps a decoder open on path until the next open or close. Paths that
+// aren't on the filesystem (e.g. bdpl://) just close the current one.
+void scrub_preview_open(string path);
+void scrub_preview_close();
+
+// Only the newest request waits for the decoder; a request that gets
+// superseded before it starts has done called right away.
+void scrub_preview_request(double time, int width, scrub_done_t done, void *arg);
+
+// Most recently decoded preview, or NULL. time is what it was requested for.
+shared_ptr<const scrub_frame_t> scrub_preview_get(double *time);
+
+#endif /* SCRUB_PREVIEW_H */
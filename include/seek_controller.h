@@ -0,0 +1,47 @@
+#ifndef SEEK_CONTROLLER_H
+#define SEEK_CONTROLLER_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <mpv/client.h>
+
+using namespace std;
+
+// reply_userdata of the seeks issued here, outside the range of the
+// int32 reply ids handed to JS.
+const uint64_t SEEK_REPLY_ID = 1ull << 32;
+
+// A seek that hasn't restarted playback by then no longer holds back the
+// next one.
+const int64_t SEEK_TIMEOUT_MS = 2000;
+
+// Latencies are in milliseconds, from issuing the seek to mpv restarting
+// playback. coalesced counts targets replaced by a newer one before they
+// were issued.
+typedef struct seek_stats_t {
+    uint32_t seeks;
+    uint32_t coalesced;
+    double last_latency;
+    double average_latency;
+    double max_latency;
+} seek_stats_t;
+
+// Only one seek is in flight at a time. Targets arriving meanwhile
+// replace each other, and the newest is issued once the current one is
+// done. Precise seeks decode up to time; the others land on a keyframe,
+// which is what a drag wants. Safe to call from any thread.
+void seek_request(mpv_handle *mpv, double time, bool precise);
+
+// The rest is for the thread handling mpv events.
+void seek_on_playback_restart(mpv_handle *mpv);
+void seek_on_reply(mpv_handle *mpv, int error);
+
+// Drops anything pending when a file starts or ends.
+void seek_reset();
+
+seek_stats_t seek_get_stats();
+
+#endif /* SEEK_CONTROLLER_H */
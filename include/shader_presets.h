@@ -0,0 +1,60 @@
+#ifndef SHADER_PRESETS_H
+#define SHADER_PRESETS_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <mpv/client.h>
+
+using namespace std;
+
+// Presets are read from a manifest next to the shaders, one per line as
+// "name = first.glsl:second.glsl", with paths relative to the directory.
+// Blank lines and lines starting with # are skipped.
+const char * const SHADER_PRESETS_MANIFEST = "presets.conf";
+
+// reply_userdata of the change-list commands applying a preset, next to
+// SEEK_REPLY_ID.
+const uint64_t SHADER_PRESET_REPLY_ID = (1ull << 32) + 1;
+
+// available is false if any of the preset's shaders isn't in the directory.
+typedef struct shader_preset_t {
+    string name;
+    vector<string> shaders;
+    bool available;
+} shader_preset_t;
+
+// active is the preset last applied, empty for none. latency is the time
+// in milliseconds from applying it to the first frame rendered with it,
+// or -1 while that frame is still pending.
+typedef struct shader_state_t {
+    string active;
+    double latency;
+} shader_state_t;
+
+// Scans dir once and reads its manifest. The directory is part of the
+// preloaded package, so the inventory never changes afterwards.
+void shader_presets_load(string dir);
+
+vector<shader_preset_t> shader_presets_get();
+uint32_t shader_inventory_count();
+
+// Colon separated absolute paths for glsl-shaders, or false if the preset
+// doesn't exist or is missing shaders.
+bool shader_preset_paths(string name, string *paths);
+
+// Called when a preset is sent to mpv, when mpv replies to it (from the
+// event thread) and after every rendered frame (from the render thread).
+void shader_preset_begin(string name);
+void shader_preset_on_reply(int error);
+void shader_preset_on_frame();
+
+shader_state_t shader_preset_state();
+
+#endif /* SHADER_PRESETS_H */
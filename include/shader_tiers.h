@@ -0,0 +1,55 @@
+#ifndef SHADER_TIERS_H
+#define SHADER_TIERS_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "shader_presets.h"
+
+using namespace std;
+
+// Frames are judged over windows of this long. A window steps down a tier
+// when the average frame time goes over SHADER_TIER_DOWN of the budget or
+// mpv drops SHADER_TIER_MAX_DROPS frames. Stepping back up takes
+// SHADER_TIER_UP_WINDOWS windows in a row under SHADER_TIER_UP of the
+// budget without drops, doubling after every step down up to
+// SHADER_TIER_MAX_UP_WINDOWS, so a tier that can't hold isn't retried
+// over and over.
+const double SHADER_TIER_WINDOW_MS = 2000;
+const double SHADER_TIER_DOWN = 0.85;
+const double SHADER_TIER_UP = 0.4;
+const int64_t SHADER_TIER_MAX_DROPS = 3;
+const uint32_t SHADER_TIER_UP_WINDOWS = 5;
+const uint32_t SHADER_TIER_MAX_UP_WINDOWS = 80;
+// Frames skipped after a change, since the first ones compile shaders.
+const uint32_t SHADER_TIER_SETTLE_FRAMES = 30;
+
+// reply_userdata of the frame-drop-count and vo-delayed-frame-count
+// observers, after SHADER_PRESET_REPLY_ID.
+const uint64_t SHADER_TIER_DROPS_ID = (1ull << 32) + 2;
+const uint64_t SHADER_TIER_DELAYED_ID = (1ull << 32) + 3;
+
+// Preset names from best to cheapest. No shaders at all is always the
+// last tier, after these.
+extern const vector<string> SHADER_DEFAULT_TIERS;
+
+// Sets the tiers, keeping only available presets, and turns adaptive mode
+// on or off. Returns the preset to apply now, if adaptive: the best tier.
+bool shader_tiers_set(vector<string> tiers, bool adaptive, string *preset);
+void shader_tiers_disable();
+
+// From the event thread, as the observed counters change.
+void shader_tiers_on_drops(uint64_t reply_userdata, int64_t count);
+
+// From the render thread after each frame, with its time and the budget in
+// milliseconds. Returns true with the preset to apply when the tier changes.
+bool shader_tiers_on_frame(double frame_time, double budget, string *preset);
+
+// Index into the tiers of the active one, or -1 while not adaptive.
+int32_t shader_tiers_current();
+
+#endif /* SHADER_TIERS_H */
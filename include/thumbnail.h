@@ -6,8 +6,14 @@
 #include <stdlib.h>
 #include <filesystem>
 #include <string>
+#include <chrono>
 #include <inttypes.h>
+#include <vector>
+#include <memory>
+#include <istream>
 #include <png.h>
+#include "base64.h"
+#include "keyframe_index.h"
 
 extern "C" { 
     #include <libavcodec/avcodec.h>
@@ -17,6 +23,53 @@ extern "C" {
     #include <libavutil/imgutils.h>
 }
 
+// An opened file and, if it has one, a decoder for its first video stream.
+// codec is NULL and stream_index -1 when there's no video. io is only set
+// when the input is read from a stream instead of a path.
+typedef struct video_decoder_t {
+    AVFormatContext *format;
+    AVCodecContext *codec;
+    int stream_index;
+    AVIOContext *io;
+} video_decoder_t;
+
+// Sprite sheet of evenly spaced tiles, filled left to right and top to
+// bottom. times[i] is the keyframe time shown in tile i, or negative if
+// that tile couldn't be decoded.
+typedef struct storyboard_t {
+    uint32_t tile_width;
+    uint32_t tile_height;
+    uint32_t columns;
+    uint32_t rows;
+    std::vector<double> times;
+    std::string sprite;
+} storyboard_t;
+
+// Wall times in milliseconds for the same tiles made two ways: by
+// generate_storyboard, and by one linear pass decoding every frame from
+// the start, which is how generate_thumbnail finds its frame. The linear
+// pass is shared by all tiles, so it's the best case for that approach.
+typedef struct storyboard_benchmark_t {
+    uint32_t tiles;
+    double duration;
+    double storyboard_time;
+    double linear_time;
+    uint32_t linear_frames;
+} storyboard_benchmark_t;
+
 void generate_thumbnail(std::string *path, int64_t offset_in_seconds);
+storyboard_t generate_storyboard(std::string path, uint32_t count, uint32_t tile_width, uint32_t columns);
+storyboard_benchmark_t benchmark_storyboard(std::string path, uint32_t count, uint32_t tile_width);
+
+// probesize and analyzeduration of 0 keep libavformat's defaults.
+bool open_video_decoder(video_decoder_t *decoder, const char *path, int64_t probesize, int64_t analyzeduration);
+// Same, reading through a seekable stream the decoder takes over, for
+// files that aren't reachable by path. name is only used in messages.
+bool open_video_decoder_stream(video_decoder_t *decoder, std::unique_ptr<std::istream> stream, const char *name);
+void close_video_decoder(video_decoder_t *decoder);
+// Decodes the first frame from the keyframe at or before time, in seconds.
+AVFrame *decode_frame_at(video_decoder_t *decoder, double time);
+// Scales frame down to width, keeping its aspect, and encodes it as a base64 PNG.
+std::string encode_frame_png(AVFrame *frame, int width);
 
 #endif /* THUMBNAIL_H */
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sched.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <memory>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libavutil/avutil.h>
+}
+
+using namespace std;
+
+const uint32_t WAVEFORM_MAX_BUCKETS = 8192;
+// The worker yields after every this many packets so playback threads
+// get the core back quickly.
+const uint32_t WAVEFORM_YIELD_PACKETS = 32;
+// Short-term loudness is measured over 3s, updated every 100ms block.
+const double WAVEFORM_LOUDNESS_WINDOW = 3.0;
+const double WAVEFORM_LOUDNESS_BLOCK = 0.1;
+const float WAVEFORM_SILENCE = -70;
+
+// Overview of one audio stream split into equal buckets over the file's
+// duration. Peaks and RMS are of the downmix, from 0 to 1. loudness is
+// the EBU R128 short-term loudness in LUFS at the end of each bucket,
+// and empty unless it was asked for.
+typedef struct waveform_t {
+    uint32_t buckets;
+    double bucket_duration;
+    vector<float> peaks;
+    vector<float> rms;
+    vector<float> loudness;
+} waveform_t;
+
+typedef void (*waveform_done_t)(void *arg);
+
+// Queues an overview of path's audio_track (numbered from 1 like mpv's
+// aid, 0 for the default stream) on the background worker. done is called
+// from the worker once it's cached, or right away if it already is.
+void waveform_request(string path, uint32_t audio_track, uint32_t buckets, bool loudness, waveform_done_t done, void *arg);
+
+// Cached overview, or NULL if it hasn't been generated or failed.
+shared_ptr<const waveform_t> waveform_get(string path, uint32_t audio_track, uint32_t buckets, bool loudness);
+
+#endif /* WAVEFORM_H */
@@ -1,7 +1,19 @@
-import libmpvLoader, { BlurayDiscInfo, BlurayPlaylistInfo, MobjCmd } from './libmpv.js';
+import libmpvLoader, { BlurayClipInfo, DiscInfo, HdmvAction, HdmvDirection, HdmvVm, LibraryEntry, MobjCmd } from './libmpv.js';
 import _ from 'lodash';
-import { getRandom, isAudioTrack, isVideoTrack, loadImage } from './utils';
-import { MainModule } from './libmpv.js';
+import { isAudioTrack, isVideoTrack, loadImage } from './utils';
+import { MainModule, EventRingInfo } from './libmpv.js';
+
+// Mirror event_ring_type in event_ring.h and mpv_format in mpv/client.h.
+enum EventRingType { Idle, FileStart, FileEnd, PropertyChange, LibraryUpdate, CommandReply, ShaderPreset }
+export enum MpvFormat { None = 0, String = 1, Flag = 3, Int64 = 4, Double = 5 }
+
+const textDecoder = new TextDecoder();
+
+// A command's arguments, or a property and the value to set it to. The
+// value's type picks the mpv format: bigint and whole numbers go as INT64.
+export type MpvRequest =
+    | { command: string[] }
+    | { property: string, value: string | number | boolean | bigint };
 
 type ProxyHandle<K, V> = (this: MpvPlayer, value: V, key: K) => void;
 interface ProxyOptions {
@@ -9,6 +21,7 @@ interface ProxyOptions {
     isPlaying: ProxyHandle<'isPlaying', MpvPlayer['isPlaying']>;
     duration: ProxyHandle<'duration', MpvPlayer['duration']>;
     elapsed: ProxyHandle<'elapsed', MpvPlayer['elapsed']>;
+    cacheDuration: ProxyHandle<'cacheDuration', MpvPlayer['cacheDuration']>;
     videoStream: ProxyHandle<'videoStream', MpvPlayer['videoStream']>;
     videoTracks: ProxyHandle<'videoTracks', MpvPlayer['videoTracks']>;
     audioStream: ProxyHandle<'audioStream', MpvPlayer['audioStream']>;
@@ -23,8 +36,8 @@ interface ProxyOptions {
     fileEnd: ProxyHandle<'fileEnd', MpvPlayer['fileEnd']>;
     files: ProxyHandle<'files', MpvPlayer['files']>;
     shaderCount: ProxyHandle<'shaderCount', MpvPlayer['shaderCount']>;
-
-    memory: ProxyHandle<'memory', MpvPlayer['memory']>;
+    shaderPreset: ProxyHandle<'shaderPreset', MpvPlayer['shaderPreset']>;
+    shaderTier: ProxyHandle<'shaderTier', MpvPlayer['shaderTier']>;
 
     blurayDiscInfo: ProxyHandle<'blurayDiscInfo', MpvPlayer['blurayDiscInfo']>;
     blurayDiscPath: ProxyHandle<'blurayDiscPath', MpvPlayer['blurayDiscPath']>;
@@ -36,62 +49,76 @@ interface ProxyOptions {
     menuCallAllow: ProxyHandle<'menuCallAllow', MpvPlayer['menuCallAllow']>;
 
     menuPictures: ProxyHandle<'menuPictures', MpvPlayer['menuPictures']>;
+    menuBackgrounds: ProxyHandle<'menuBackgrounds', MpvPlayer['menuBackgrounds']>;
     menuActivated: ProxyHandle<'menuActivated', MpvPlayer['menuActivated']>;
     menuSelected: ProxyHandle<'menuSelected', MpvPlayer['menuSelected']>;
     menuPageId: ProxyHandle<'menuPageId', MpvPlayer['menuPageId']>;
     hasPopupMenu: ProxyHandle<'hasPopupMenu', MpvPlayer['hasPopupMenu']>;
+
+    libraryEntries: ProxyHandle<'libraryEntries', MpvPlayer['libraryEntries']>;
+    libraryScanning: ProxyHandle<'libraryScanning', MpvPlayer['libraryScanning']>;
 }
 
 const isMpvPlayerProperty = (prop: string | symbol): prop is keyof MpvPlayer => [
-    'idle', 'isPlaying', 'duration', 'elapsed',
+    'idle', 'isPlaying', 'duration', 'elapsed', 'cacheDuration',
     'videoStream', 'videoTracks', 'audioStream', 'audioTracks',
     'subtitleStream', 'subtitleTracks', 'currentChapter', 'chapters',
     'isSeeking', 'uploading', 'title', 'fileEnd', 'files', 'shaderCount',
-    'memory', 'blurayDiscInfo', 'blurayDiscPath', 'objectIdx', 'blurayTitle', 'menuCallAllow',
-    'playlistId', 'playItemId', 'menuPictures', 'menuActivated', 'menuSelected', 'menuPageId', 'hasPopupMenu'
+    'shaderPreset', 'shaderTier',
+    'blurayDiscInfo', 'blurayDiscPath', 'objectIdx', 'blurayTitle', 'menuCallAllow',
+    'playlistId', 'playItemId', 'menuPictures', 'menuBackgrounds', 'menuActivated', 'menuSelected', 'menuPageId', 'hasPopupMenu',
+    'libraryEntries', 'libraryScanning'
 ].includes(typeof prop === 'symbol' ? prop.toString() : prop);
 
 export default class MpvPlayer {
     module: MainModule;
+    canvas: HTMLCanvasElement;
+    resizeObserver: ResizeObserver | null = null;
 
     fsWorker: Worker | null = null;
     mpvWorker: Worker | null = null;
 
+    eventRing: EventRingInfo | null = null;
+    eventHeap: {
+        u8: Uint8Array, i32: Int32Array, u32: Uint32Array, i64: BigInt64Array, f64: Float64Array
+    } | null = null;
+    eventProperties: string[] = [];
+    pendingReplies = new Map<number, { resolve: () => void, reject: (err: Error) => void }>();
+
     fileEnd = false;
     
     idle = false;
     isPlaying = false;
     duration = 0;
     elapsed = 0;
+    cacheDuration = 0;
 
-    memory: Record<number, number> = {};
-
-    blurayDiscInfo: BlurayDiscInfo | null = null;
+    blurayDiscInfo: DiscInfo | null = null;
     blurayDiscPath = '/';
+    vm: HdmvVm | null = null;
     objectIdx = 0;
-    menuIdx = 0;
 
     videoStream = 1;
     audioStream = 1;
-    nextAudioTrack: number | null = null;
     currentChapter = 0;
     subtitleStream = 1;
-    subtitleDispFlag = false;
     
     blurayTitle = 0;
     playlistId = 0;
     playItemId = 0;
+    loadedPlaylistId: number | null = null;
 
     menuPictures: Record<string, Record<string, Record<string, HTMLImageElement>>> = {};
+    // Still of the video under each playlist's menu, for previews before
+    // the clip is playing.
+    menuBackgrounds: Record<string, HTMLImageElement> = {};
     menuActivated = false;
     menuSelected = 0;
     menuPageId = -1;
     buttonState: number[] = [];
     menuCallAllow = false;
     hasPopupMenu = false;
-    menuInitiated = false;
-
-    resumeInfo: ResumeInfo | null = null;
+    hasResume = false;
 
     videoTracks: VideoTrack[] = [];
     audioTracks: AudioTrack[] = [];
@@ -104,6 +131,12 @@ export default class MpvPlayer {
     files: string[] = [];
 
     shaderCount = -1;
+    shaderPreset = '';
+    // Index into the adaptive tiers, or -1 once a preset is picked by hand.
+    shaderTier = -1;
+
+    libraryEntries: LibraryEntry[] = [];
+    libraryScanning = false;
 
     proxy: MpvPlayer;
 
@@ -119,8 +152,9 @@ export default class MpvPlayer {
         return arr;
     }
 
-    private constructor(module: MainModule, options: Partial<ProxyOptions>) {
+    private constructor(module: MainModule, canvas: HTMLCanvasElement, options: Partial<ProxyOptions>) {
         this.module = module;
+        this.canvas = canvas;
 
         this.proxy = new Proxy(this, {
             set(target, prop, newValue) {
@@ -154,19 +188,18 @@ export default class MpvPlayer {
             mainScriptUrlOrBlob
         });
 
-        return new this(module, options);
+        return new this(module, canvas, options);
     }
     
-    static destructPlaylist(playlist: BlurayPlaylistInfo) {
-        playlist.clips.delete();
-        playlist.marks.delete();
-        playlist.igs.palettes.delete();
-        playlist.igs.pictures.delete();
-        playlist.igs.menu.pages.delete();
+    static takeVector<T>(vector: Vector<T>) {
+        const arr = MpvPlayer.vectorToArray(vector);
+        vector.delete();
+        return arr;
     }
 
     async setupMpvWorker() {
-        const mainThread = await new Promise<number>(resolve => {
+        // Messages come from the thread draining mpv events, not the one rendering.
+        const eventThread = await new Promise<number>(resolve => {
             const interval = setInterval(() => {
                 const threadId = this.module.getMpvThread();
                 if (!threadId) return;
@@ -175,7 +208,7 @@ export default class MpvPlayer {
             }, 100);
         });
         const pthreads: Record<number, Worker> = this.module.PThread.pthreads;
-        this.mpvWorker = pthreads[mainThread];
+        this.mpvWorker = pthreads[eventThread];
         if (!this.mpvWorker)
             throw new Error('mpv worker not found');
 
@@ -183,119 +216,11 @@ export default class MpvPlayer {
             try {
                 const payload = JSON.parse(e.data);
                 switch (payload.type) {
-                    case 'idle':
-                        this.proxy.idle = true;
-                        this.proxy.shaderCount = payload.shaderCount;
+                    case 'events':
+                        this.drainEvents();
                         break;
-                    case 'file-start':
-                        this.proxy.fileEnd = false;
-                        break;
-                    case 'file-end':
-                        this.proxy.fileEnd = true;
-                        break;
-                    case 'property-change':
-                        switch (payload.name) {
-                            case 'pause':
-                                this.proxy.isPlaying = !payload.value;
-                                break;
-                            case 'duration':
-                                this.proxy.duration = payload.value;
-                                break;
-                            case 'playlist-current-pos':
-                                if (this.blurayDiscInfo) {
-                                    if (payload.value > 0)
-                                        this.proxy.playItemId++;
-                                    
-                                    if (payload.value === '-1')
-                                        this.nextObjectCommand();
-                                }
-                                break;
-                            case 'playback-time':
-                                if (this.isSeeking) break;
-
-                                if (this.blurayDiscInfo && ![0, 0xFFFF].includes(this.blurayTitle)) {
-                                    const currentPlaylistChapter = (chapter: Chapter) => chapter.title.includes('Clip ' + (this.playItemId + 1));
-                                    const firstIdx = this.chapters.findIndex(currentPlaylistChapter)
-                                    const lastIdx = this.chapters.findLastIndex(currentPlaylistChapter);
-                                    const chapterIdx = this.chapters.slice(firstIdx, lastIdx + 1)
-                                        .findIndex(chapter => payload.value <= chapter.time) - 1;
-                                    this.proxy.currentChapter = chapterIdx < 0 ? lastIdx < 0 ? 0 : lastIdx : (firstIdx + chapterIdx);
-                                }
-
-                                this.proxy.elapsed = payload.value;
-                                break;
-                            case 'vid':
-                                this.proxy.videoStream = parseInt(payload.value);
-                                break;
-                            case 'aid':
-                                this.proxy.audioStream =  parseInt(payload.value);
-                                break;
-                            case 'sid':
-                                this.proxy.subtitleStream = parseInt(payload.value);
-                                if (this.blurayDiscInfo && this.subtitleStream)
-                                    this.subtitleDispFlag = true;
-                                break;
-                            case 'chapter':
-                                this.proxy.currentChapter = parseInt(payload.value);
-                                break;
-                            case 'shaderCount':
-                                this.proxy.shaderCount = payload.value;
-                                break;
-                            case 'metadata/by-key/title':
-                                this.proxy.title = payload.value;
-                                break;
-                            default:
-                                console.log(`event: property-change -> { name: ${
-                                    payload.name
-                                }, value: ${payload.value} }`);
-                        }
-                        break;
-                    case 'track-list':
-                        const bigIntKeys = [
-                            'id', 'srcId', 'mainSelection', 'ffIndex', 
-                            'demuxW', 'demuxH', 'demuxChannelCount', 'demuxSamplerate'
-                        ];
-                        
-                        const tracks: Track[] = payload.tracks
-                            .map((track: any) => _.mapKeys(track, (__, k) => _.camelCase(k)))
-                            .map((track: any) => _.mapValues(track, (v, k) => bigIntKeys.includes(k) ? BigInt(v) : v ));
-                            
-                        const audioTrackSrcIds: bigint[] = [];
-
-                        const { videoTracks, audioTracks, subtitleTracks } = tracks.reduce(
-                            (map: { 
-                                videoTracks: VideoTrack[], 
-                                audioTracks: AudioTrack[], 
-                                subtitleTracks: Track[]
-                            }, track) => {
-                                if (isVideoTrack(track))
-                                    map.videoTracks.push(track);
-                                else if (isAudioTrack(track) && !audioTrackSrcIds.includes(track.srcId)) {
-                                    map.audioTracks.push(track);
-                                    audioTrackSrcIds.push(track.srcId);
-                                } else
-                                    map.subtitleTracks.push(track);
-
-                                return map;
-                            }, {
-                                videoTracks: [], 
-                                audioTracks: [], 
-                                subtitleTracks: []
-                            }
-                        );
-                        
-                        if (this.blurayDiscInfo && this.nextAudioTrack && audioTracks[this.nextAudioTrack]) {
-                            this.module.setAudioTrack(audioTracks[this.nextAudioTrack].id);
-                            this.nextAudioTrack = null;
-                        }
-                        
-                        this.proxy.videoTracks = videoTracks;
-                        this.proxy.audioTracks = audioTracks;
-                        this.proxy.subtitleTracks = subtitleTracks;
-                        break;
-                    case "chapter-list":
-                        if (!this.blurayDiscInfo)
-                            this.proxy.chapters = payload.chapters;
+                    case 'property-node':
+                        this.onNodeProperty(payload.name, payload.value);
                         break;
                     default:
                         console.log('Recieved payload:', payload);
@@ -307,6 +232,252 @@ export default class MpvPlayer {
         }
 
         this.mpvWorker.addEventListener('message', listener);
+
+        const buffer = this.module.HEAPU8.buffer;
+        this.eventHeap = {
+            u8: this.module.HEAPU8,
+            i32: new Int32Array(buffer),
+            u32: new Uint32Array(buffer),
+            i64: new BigInt64Array(buffer),
+            f64: new Float64Array(buffer)
+        };
+        this.eventRing = this.module.eventRingInfo();
+
+        const drain = () => {
+            this.drainEvents();
+            requestAnimationFrame(drain);
+        };
+        requestAnimationFrame(drain);
+
+        this.observeProperty('demuxer-cache-duration', MpvFormat.Double, { maxRate: 1, minDelta: 0.5 });
+    }
+
+    // Changes are coalesced natively: at most maxRate per second (0 for no
+    // limit, keeping the newest), numeric changes under minDelta dropped,
+    // and repeats of the last value dropped with onChange. Values arrive
+    // through onPropertyChange.
+    observeProperty(name: string, format: MpvFormat, { maxRate = 0, minDelta = 0, onChange = false } = {}) {
+        return this.module.observeProperty(name, format, maxRate, minDelta, onChange);
+    }
+
+    unobserveProperty(name: string) {
+        return this.module.unobserveProperty(name);
+    }
+
+    // Queues every request with one call into the module. Each promise
+    // settles once mpv has carried its request out, and rejects with mpv's
+    // error if it failed.
+    submit(requests: MpvRequest[]): Promise<void>[] {
+        if (!requests.length) return [];
+
+        const ids: number[] = this.module.submitRequests(requests);
+        return ids.map(id => id < 0
+            ? Promise.reject(this.mpvError(id))
+            : new Promise<void>((resolve, reject) => this.pendingReplies.set(id, { resolve, reject }))
+        );
+    }
+
+    command(...args: string[]) {
+        return this.submit([{ command: args }])[0];
+    }
+
+    setProperty(property: string, value: string | number | boolean | bigint) {
+        return this.submit([{ property, value }])[0];
+    }
+
+    mpvError(code: number) {
+        return new Error(`mpv: ${this.module.errorString(code)}`);
+    }
+
+    // Reads every record the mpv thread has pushed since the last drain.
+    // Records mirror event_record_t in event_ring.h; the tail is only
+    // advanced once their values have been copied out.
+    drainEvents() {
+        const ring = this.eventRing;
+        const heap = this.eventHeap;
+        if (!ring || !heap) return;
+
+        const head = Atomics.load(heap.i32, ring.head >> 2) >>> 0;
+        let tail = Atomics.load(heap.i32, ring.tail >> 2) >>> 0;
+
+        for (; tail !== head; tail = (tail + 1) >>> 0) {
+            const record = ring.records + (tail & (ring.capacity - 1)) * ring.recordSize;
+            const type: EventRingType = heap.u32[record >> 2];
+            const property = heap.i32[(record >> 2) + 1];
+            const format: MpvFormat = heap.u32[(record >> 2) + 2];
+            const length = heap.u32[(record >> 2) + 3];
+            const valueOffset = record + 16;
+
+            let value: string | number = 0;
+            switch (format) {
+                case MpvFormat.String: {
+                    const start = heap.u32[valueOffset >> 2];
+                    value = textDecoder.decode(heap.u8.slice(start, start + length));
+                    break;
+                }
+                case MpvFormat.Flag:
+                case MpvFormat.Int64:
+                    value = Number(heap.i64[valueOffset >> 3]);
+                    break;
+                case MpvFormat.Double:
+                    value = heap.f64[valueOffset >> 3];
+                    break;
+            }
+
+            switch (type) {
+                case EventRingType.Idle:
+                    this.proxy.idle = true;
+                    this.proxy.shaderCount = value as number;
+                    break;
+                case EventRingType.FileStart:
+                    this.proxy.fileEnd = false;
+                    break;
+                case EventRingType.FileEnd:
+                    this.proxy.fileEnd = true;
+                    break;
+                case EventRingType.LibraryUpdate:
+                    this.updateLibrary(!!value);
+                    break;
+                case EventRingType.PropertyChange:
+                    this.eventProperties[property] ??= this.module.eventRingPropertyName(property) as string;
+                    this.onPropertyChange(this.eventProperties[property], value);
+                    break;
+                case EventRingType.CommandReply: {
+                    const reply = this.pendingReplies.get(property);
+                    if (!reply) break;
+
+                    this.pendingReplies.delete(property);
+                    if (value === 0)
+                        reply.resolve();
+                    else
+                        reply.reject(this.mpvError(value as number));
+                    break;
+                }
+                case EventRingType.ShaderPreset:
+                    this.proxy.shaderTier = property;
+                    this.proxy.shaderPreset = value as string;
+                    break;
+            }
+        }
+
+        Atomics.store(heap.i32, ring.tail >> 2, tail);
+    }
+
+    onPropertyChange(name: string, value: any) {
+        switch (name) {
+            case 'pause':
+                this.proxy.isPlaying = !value;
+                break;
+            case 'duration':
+                this.proxy.duration = value;
+                break;
+            case 'playlist-current-pos':
+                if (this.vm && value === -1)
+                    this.applyVmActions(this.vm.playlistEnd());
+                break;
+            case 'playback-time':
+                if (this.isSeeking) break;
+
+                if (this.blurayDiscInfo && ![0, 0xFFFF].includes(this.blurayTitle)) {
+                    const chapterIdx = this.blurayDiscInfo.findChapter(this.playlistId, value);
+                    const currentChapter = Math.min(chapterIdx, Math.max(this.chapters.length - 1, 0));
+                    if (currentChapter !== this.currentChapter)
+                        this.proxy.currentChapter = currentChapter;
+
+                    const playItemId = this.blurayDiscInfo.findPlayItem(this.playlistId, value);
+                    if (playItemId !== this.playItemId) {
+                        this.proxy.playItemId = playItemId;
+                        this.updateVmPosition();
+                        this.prefetchBluray();
+                    }
+                }
+
+                this.proxy.elapsed = value;
+                break;
+            case 'demuxer-cache-duration':
+                this.proxy.cacheDuration = value;
+                break;
+            case 'vid':
+                this.proxy.videoStream = value;
+                break;
+            case 'aid':
+                this.proxy.audioStream = value;
+                if (this.vm && this.blurayDiscInfo) {
+                    const stream = this.blurayDiscInfo.findAudioStream(this.playlistId, this.playItemId, this.audioStream);
+                    if (stream) this.vm.setAudioStream(stream);
+                }
+                break;
+            case 'sid':
+                this.proxy.subtitleStream = value;
+                if (this.vm && this.blurayDiscInfo) {
+                    const stream = this.blurayDiscInfo.findPgStream(this.playlistId, this.playItemId, this.subtitleStream);
+                    this.vm.setPgStream(stream || (this.vm.getPsr(2) & 0xFFF), !!stream);
+                }
+                break;
+            case 'chapter':
+                this.proxy.currentChapter = value;
+                break;
+            case 'shaderCount':
+                this.proxy.shaderCount = value;
+                break;
+            case 'metadata/by-key/title':
+                this.proxy.title = value;
+                break;
+            case 'user-data/event-storm':
+                break;
+            default:
+                console.log(`event: property-change -> { name: ${name}, value: ${value} }`);
+        }
+    }
+
+    // Structured properties, already parsed from a single JSON message.
+    onNodeProperty(name: string, value: any) {
+        switch (name) {
+            case 'track-list':
+                const bigIntKeys = [
+                    'id', 'srcId', 'mainSelection', 'ffIndex', 
+                    'demuxW', 'demuxH', 'demuxChannelCount', 'demuxSamplerate'
+                ];
+                
+                const tracks: Track[] = value
+                    .map((track: any) => _.mapKeys(track, (__, k) => _.camelCase(k)))
+                    .map((track: any) => _.mapValues(track, (v, k) => bigIntKeys.includes(k) ? BigInt(v) : v ));
+                    
+                const audioTrackSrcIds: bigint[] = [];
+
+                const { videoTracks, audioTracks, subtitleTracks } = tracks.reduce(
+                    (map: { 
+                        videoTracks: VideoTrack[], 
+                        audioTracks: AudioTrack[], 
+                        subtitleTracks: Track[]
+                    }, track) => {
+                        if (isVideoTrack(track))
+                            map.videoTracks.push(track);
+                        else if (isAudioTrack(track) && !audioTrackSrcIds.includes(track.srcId)) {
+                            map.audioTracks.push(track);
+                            audioTrackSrcIds.push(track.srcId);
+                        } else
+                            map.subtitleTracks.push(track);
+
+                        return map;
+                    }, {
+                        videoTracks: [], 
+                        audioTracks: [], 
+                        subtitleTracks: []
+                    }
+                );
+                
+                this.proxy.videoTracks = videoTracks;
+                this.proxy.audioTracks = audioTracks;
+                this.proxy.subtitleTracks = subtitleTracks;
+                break;
+            case 'chapter-list':
+                if (!this.blurayDiscInfo)
+                    this.proxy.chapters = value;
+                break;
+            default:
+                console.log(`event: property-node -> { name: ${name} }`, value);
+        }
     }
 
     getDirectories = (): Promise<FileSystemDirectoryHandle[]> => 
@@ -338,795 +509,488 @@ export default class MpvPlayer {
         return { [name]: directoryHandle };
     }
 
-    getMemoryValue(addr: number) {
-        if (addr < 0x80000000)
-            return this.memory[addr] ?? 0;
-
-        addr -= 0x80000000;
-
-        switch (addr) {
-            case 1:
-                return this.nextAudioTrack 
-                    ? this.nextAudioTrack + 1
-                    : this.audioStream;
-            case 2:
-                const dispFlag = this.subtitleDispFlag ? 0x80000000 : 0;
-                return Number(BigInt(this.subtitleStream) | BigInt(dispFlag));
-            case 4:
-            case 36:
-                return this.blurayTitle;
-            case 5:
-            case 37:
-                return this.currentChapter + 1;
-            case 6:
-                return this.playlistId;
-            case 7:
-                return this.playItemId;
-            case 10:
-                return this.menuSelected;
-            case 11:
-                return this.menuPageId > -1 ? this.menuPageId : 0;
-            default:
-                console.log('Unknown PSR address:', addr);
-                return 0;
-        }
+    getCurrentObject() {
+        if (!this.blurayDiscInfo) return;
+
+        const objectId = this.blurayDiscInfo.getTitleObject(this.blurayTitle);
+        if (objectId >= this.blurayDiscInfo.numObjects) return;
+
+        const object = this.blurayDiscInfo.getObject(objectId);
+        object.cmds.delete();
+
+        return { objectId, ...object };
     }
 
-    setMemoryValue(addr: number, val: number) {
-        if (addr < 0x80000000) {
-            this.memory[addr] = val;
-            return;
-        }
+    getPlaylistClips(playlistId: number): BlurayClipInfo[] {
+        if (!this.blurayDiscInfo) return [];
+        return MpvPlayer.takeVector(this.blurayDiscInfo.getClips(playlistId));
+    }
 
-        addr -= 0x80000000;
-
-        switch (addr) {
-            case 1:
-                this.module.setAudioTrack(this.audioTracks[val - 1].id);
-                return;
-            case 2:
-                this.module.setSubtitleTrack(BigInt(val));
-                return;
-            case 4:
-            case 36:
-                this.proxy.blurayTitle = val;
-                return;
-            case 5:
-            case 37:
-                this.proxy.currentChapter = val - 1;
-                return;
-            case 6:
-                this.proxy.playlistId = val;
-                return;
-            case 7:
-                this.proxy.playItemId = val;
-                return;
-            case 10:
-                this.proxy.menuSelected = val;
-                return;
-            case 11:
-                this.proxy.menuPageId = val;
-                return;
-            default:
-                console.log('Unknown PSR address:', addr);
-                return;
-        }
+    // Snaps to the I-frame at or before time using the playlist's EP map.
+    seekBluray(time: number) {
+        const request = this.seekBlurayRequest(time);
+        if (request) this.module.setPlaybackTime(request.value);
     }
 
-    async nextObjectCommand(): Promise<void> {
-        if (!this.blurayDiscInfo) return;
+    seekBlurayRequest(time: number) {
+        if (!this.blurayDiscInfo || this.loadedPlaylistId === null) return null;
+        const entry = this.blurayDiscInfo.findTimeEntry(this.loadedPlaylistId, time);
+        return { property: 'playback-time', value: entry.time };
+    }
 
-        const object = this.blurayDiscInfo.mobjObjects.objects.get(
-            this.blurayTitle === 0xFFFF
-                ? this.blurayDiscInfo.firstPlayIdx
-                : Number(this.blurayDiscInfo.titleMap.get(this.blurayTitle))
-        );
+    // Lands on the keyframe nearest to time, found in the file's stored
+    // keyframe index once it has been built, so nothing before it is decoded.
+    seekKeyframe(time: number) {
+        if (this.blurayDiscInfo && this.loadedPlaylistId !== null)
+            this.seekBluray(time);
+        else
+            this.module.seekKeyframe(time);
+    }
 
-        if (!object) throw new Error('Object not found');
+    // Exact seek, for when the seek bar is released. Seeks are coalesced
+    // natively, so only the newest target waits behind one in flight. Discs
+    // aren't snapped to the EP map here, so a scrub still ends on time.
+    setPlaybackTime(time: number) {
+        this.module.setPlaybackTime(time);
+    }
+
+    // Keyframe seek for every step of a seek bar drag, followed by one
+    // setPlaybackTime on release.
+    scrub(time: number) {
+        const request = this.seekBlurayRequest(time);
+        this.module.scrubPlaybackTime(request ? request.value : time);
+    }
 
-        if (this.menuCallAllow !== !object.menuCallMask)
-            this.proxy.menuCallAllow = !object.menuCallMask;
+    // Seek latency so far, in milliseconds from issuing to playback restarting.
+    getSeekStats() {
+        return this.module.getSeekStats();
+    }
 
-        if (object.cmds.size() === this.objectIdx)
-            return console.log('End of object commands');
+    // Presets from shaders/presets.conf. Unavailable ones are missing some
+    // of their shaders.
+    getShaderPresets() {
+        return MpvPlayer.takeVector(this.module.getShaderPresets()).map(({ shaders, ...preset }) => ({
+            ...preset,
+            shaders: MpvPlayer.takeVector(shaders)
+        }));
+    }
 
-        const command = object.cmds.get(this.objectIdx);
-        if (!command) throw new Error('Object command not found');
+    // An empty name clears the shaders. Compiled programs are kept in the
+    // OPFS cache, so a preset used before comes up faster after a reload.
+    // Picking one turns off adaptive tiers.
+    applyShaderPreset(name: string) {
+        return this.module.applyShaderPreset(name);
+    }
 
-        const ret = await this.executeCommand(command);
-        
-        if (this.blurayTitle !== 0xFFFF)
-            object.cmds.delete();
-        
-        if (ret === 2) {
-            if (!this.blurayTitle && !this.menuInitiated) {
-                this.menuInitiated = true;
-                return this.nextMenuCommand();
-            } else if (this.blurayTitle) {
-                this.menuInitiated = false;
+    // Steps through tiers, best first, when frames take too long or mpv
+    // drops them, and back up after a stretch of headroom. No shaders is
+    // always the last tier. Empty tiers means the default Anime4K chain,
+    // which is on from startup; turning it off keeps the current preset.
+    setAdaptiveShaders(enabled: boolean, tiers: string[] = []) {
+        this.module.setAdaptiveShaders(enabled, tiers);
+    }
+
+    // The active preset, and how long it took from applying it to the first
+    // frame rendered with it in milliseconds (-1 until that frame).
+    getShaderState() {
+        return this.module.getShaderState();
+    }
+
+    // Renders on every animation frame and lets mpv resample video to the
+    // display (video-sync=display-resample), so 24p doesn't judder at 60 Hz.
+    // Returns false if it's unavailable because GL is software rendered.
+    setFramePacing(displaySync: boolean) {
+        return this.module.setFramePacing(displaySync);
+    }
+
+    // Sizes the render target to the canvas as it's displayed, in device
+    // pixels and no larger than the video unless shaders upscale it, rather
+    // than to the screen. With budget, the scale also drops while frames
+    // take longer than a vsync and recovers once they're quick again.
+    setRenderSize(adaptive: boolean, budget = false) {
+        this.resizeObserver?.disconnect();
+        this.resizeObserver = null;
+
+        if (adaptive) {
+            this.resizeObserver = new ResizeObserver(([entry]) => {
+                const size = entry.devicePixelContentBoxSize?.[0];
+                this.module.setDisplaySize(
+                    Math.round(size ? size.inlineSize : entry.contentRect.width * devicePixelRatio),
+                    Math.round(size ? size.blockSize : entry.contentRect.height * devicePixelRatio)
+                );
+            });
+
+            try {
+                this.resizeObserver.observe(this.canvas, { box: 'device-pixel-content-box' });
+            } catch {
+                this.resizeObserver.observe(this.canvas);
             }
-            
-            return;
         }
 
-        if (ret) return this.nextObjectCommand();
+        this.module.setRenderSize(adaptive, budget);
     }
 
-    menuActivate() {
-        this.proxy.menuActivated = true;
-        this.menuIdx = 0;
+    // Time spent rendering and swapping each frame, with a histogram in
+    // 1 ms buckets whose last bucket holds everything slower. While paced
+    // to the display, also the measured vsync interval and missed frames.
+    getFrameStats() {
+        const { histogram, ...stats } = this.module.getFrameStats();
+        return { ...stats, histogram: MpvPlayer.takeVector(histogram) };
     }
 
-    setPageButtons() {
-        const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-        if (!playlist) throw new Error('Playlist not found');
-        
-        const menu = playlist.igs.menu.pages.get(this.menuPageId);
-        if (!menu) throw new Error('Menu not found');
+    resetFrameStats() {
+        this.module.resetFrameStats();
+    }
 
-        this.buttonState = MpvPlayer.vectorToArray(menu.bogs)
-            .map(bog => bog.defButton);
-        MpvPlayer.destructPlaylist(playlist);
+    // Clip transitions of disc playlists since the last call, with the wall
+    // time each took beyond the playlist time it covered, in milliseconds.
+    // Play through a few seamless transitions, then take them.
+    takeClipGaps() {
+        return MpvPlayer.takeVector(this.module.bdTakeClipGaps());
     }
 
-    async nextMenuCommand(): Promise<void> {
-        if (this.menuPageId < 0) {
-            this.proxy.menuPageId = 0;
-            this.setPageButtons();
-        }
-        
-        const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-        if (!playlist) throw new Error('Playlist not found');
-        
-        const menu = playlist.igs.menu.pages.get(this.menuPageId);
-        if (!menu) throw new Error('Menu not found');
+    // Frame stats over two windows of the given length while something
+    // plays: one idle, then one with rate property changes a second
+    // flooding the event thread. Render times should barely differ.
+    async measureEventStorm(seconds = 5, rate = 5000) {
+        const wait = () => new Promise(resolve => setTimeout(resolve, seconds * 1000));
 
-        const button = menu.buttons.get(this.menuSelected.toString());
-        if (!button) throw new Error('Button not found');
-            
-        const command = button?.commands.get(this.menuIdx);
-        
-        if (!command)
-            throw new Error('Menu command not found');
-        
-        const run = (button?.autoAction || this.menuActivated) && await this.executeCommand(command, true);
+        this.resetFrameStats();
+        await wait();
+        const calm = this.getFrameStats();
 
-        MpvPlayer.destructPlaylist(playlist);
+        this.resetFrameStats();
+        this.module.startEventStorm(rate, seconds);
+        await wait();
+        const storm = this.getFrameStats();
 
-        if (run === 1) return this.nextMenuCommand();
+        return { calm, storm };
     }
 
-    resetMenu() {
-        this.proxy.menuPageId = -1;
-        this.proxy.menuSelected = 0;
-        this.menuIdx = 0;
-        this.buttonState = [];
-        this.proxy.menuActivated = false;
+    // Tracks come from the pre-indexed STN table, so the streams selected by
+    // PSR1/PSR2 are active from the first frame.
+    getBlurayTrackOptions(playlistId: number, playItemId: number) {
+        if (!this.vm || !this.blurayDiscInfo) return 'aid=auto';
+
+        const audioTrack = this.blurayDiscInfo.getAudioTrack(playlistId, playItemId, this.vm.getPsr(1));
+        const pgStream = this.vm.getPsr(2);
+        const pgTrack = (pgStream & 0x80000000) 
+            ? this.blurayDiscInfo.getPgTrack(playlistId, playItemId, pgStream & 0xFFF) 
+            : 0;
+
+        return `aid=${audioTrack || 'auto'},sid=${pgTrack || 'no'}`;
+    }
+
+    // The whole playlist is served as one stream, so play items are
+    // addressed by their offset into the playlist timeline.
+    loadBlurayPlaylist(playlistId: number, playItemId: number, start: number) {
+        const request = this.blurayPlaylistRequest(playlistId, playItemId, start);
+        if (request) this.submit([request])[0].catch(err => console.error(err));
     }
 
-    generateResumeInfo() {  
-        this.resumeInfo = {
-            blurayTitle: this.blurayTitle,
-            objectIdx: this.objectIdx,
-            playlistId: this.playlistId,
-            playItemId: this.playItemId,
-            resumeTime: this.elapsed
+    blurayPlaylistRequest(playlistId: number, playItemId: number, start: number): MpvRequest | null {
+        if (!this.blurayDiscInfo) return null;
+        const time = this.blurayDiscInfo.getPlayItemTime(playlistId, playItemId) + start;
+
+        if (this.loadedPlaylistId === playlistId && !this.fileEnd)
+            return this.seekBlurayRequest(time);
+
+        this.loadedPlaylistId = playlistId;
+        return {
+            command: [
+                'loadfile', this.module.bdPlaylistUri(playlistId) as string, 'replace', '0',
+                (time ? `start=${this.blurayDiscInfo.findTimeEntry(playlistId, time).time},` : '') +
+                this.getBlurayTrackOptions(playlistId, playItemId)
+            ]
         };
     }
 
+    // The VM runs whole command sequences natively; only the resulting
+    // playback and menu changes come back here. The mpv side of them goes
+    // out as one batch, and the returned promise settles once it's done.
+    applyVmActions(vector: Vector<HdmvAction>) {
+        if (!this.vm) return Promise.resolve();
+
+        const { HdmvActionType } = this.module;
+        const actions = MpvPlayer.takeVector(vector);
+        const playing = actions.some(action => action.type === HdmvActionType.PLAY_PL);
+        const requests: MpvRequest[] = [];
+        let delay = 0;
+
+        actions.forEach(action => {
+            switch (action.type) {
+                case HdmvActionType.PLAY_PL: {
+                    const request = this.blurayPlaylistRequest(action.playlist, action.playItem, action.start);
+                    if (request) requests.push(request);
+                    break;
+                }
+                case HdmvActionType.STOP:
+                    this.loadedPlaylistId = null;
+                    requests.push({ command: ['stop'] });
+                    break;
+                case HdmvActionType.SET_STREAM:
+                    // A playlist load in the same batch picks the streams up from its options.
+                    if (playing || !this.blurayDiscInfo) break;
+
+                    if (action.audioFlag) {
+                        const trackId = this.blurayDiscInfo.getAudioTrack(this.playlistId, this.playItemId, action.audioStream);
+                        if (trackId) requests.push({ property: 'aid', value: BigInt(trackId) });
+                    }
+
+                    if (action.pgFlag) {
+                        const trackId = action.pgDisplay
+                            ? this.blurayDiscInfo.getPgTrack(this.playlistId, this.playItemId, action.pgStream)
+                            : 0;
+                        requests.push({ property: 'sid', value: BigInt(trackId) });
+                    }
+                    break;
+                case HdmvActionType.MENU_PAGE:
+                    delay = Math.max(delay, action.delay);
+                    break;
+                case HdmvActionType.BUTTON_STATE:
+                case HdmvActionType.POPUP_OFF:
+                    break;
+                default:
+                    console.log('Unknown HDMV action:', action.type);
+            }
+        });
+
+        const replies = Promise.all(this.submit(requests))
+            .then(() => {})
+            .catch(err => console.error('HDMV actions failed:', err));
+
+        if (delay)
+            setTimeout(() => this.syncVmState(), delay);
+        else
+            this.syncVmState();
+
+        return replies;
+    }
+
+    syncVmState() {
+        if (!this.vm) return;
+
+        const state = this.vm.getState();
+        const playlistChanged = state.playlist !== this.playlistId;
+
+        this.buttonState = MpvPlayer.takeVector(this.vm.getButtonState());
+        this.hasResume = state.hasResume;
+
+        this.proxy.blurayTitle = state.title;
+        this.proxy.objectIdx = state.objectPc;
+        this.proxy.playlistId = state.playlist;
+        this.proxy.playItemId = state.playItem;
+        this.proxy.menuCallAllow = state.menuCallAllow;
+        this.proxy.hasPopupMenu = state.hasPopupMenu;
+        this.proxy.menuSelected = state.menuSelected;
+        this.proxy.menuActivated = state.menuActivated;
+        this.proxy.menuPageId = state.menuPage;
+
+        if (playlistChanged || !this.chapters.length)
+            this.getBlurayChapters();
+
+        this.prefetchBluray();
+    }
+
+    // Warms the next clip and the playlists the navigation graph predicts.
+    prefetchBluray() {
+        if (!this.vm) return;
+
+        const playlists = this.vm.getLikelyPlaylists();
+        this.module.bdPrefetch(this.playlistId, this.playItemId, playlists);
+        playlists.delete();
+    }
+
+    updateVmPosition() {
+        const clipStart = this.blurayDiscInfo?.getPlayItemTime(this.playlistId, this.playItemId) ?? 0;
+        this.vm?.setPlaybackPosition(this.playItemId, this.currentChapter + 1, this.elapsed - clipStart);
+    }
+
+    executeCommand(cmd: MobjCmd, menu = false) {
+        if (!this.vm) return;
+        this.updateVmPosition();
+        this.applyVmActions(this.vm.runCommand(cmd, menu));
+    }
+
     openTopMenu() {
-        if (!this.blurayDiscInfo?.topMenuSupported) return;
+        if (!this.vm || !this.blurayDiscInfo?.topMenuSupported) return;
+        this.updateVmPosition();
+        this.applyVmActions(this.vm.topMenu());
+    }
 
-        const object = this.blurayDiscInfo.mobjObjects.objects.get(
-            this.blurayTitle === 0xFFFF
-                ? this.blurayDiscInfo.firstPlayIdx
-                : Number(this.blurayDiscInfo.titleMap.get(this.blurayTitle))
-        );
+    resumePlayback() {
+        if (!this.vm) return;
+        this.applyVmActions(this.vm.resume());
+    }
 
-        if (!object) throw new Error('Object not found');
+    playMark(markIdx: number) {
+        if (!this.vm) return;
+        this.updateVmPosition();
+        this.applyVmActions(this.vm.playMark(this.playlistId, markIdx));
+    }
 
-        if (object.resumeIntentionFlag)
-            this.generateResumeInfo();
+    popupOn() {
+        if (!this.vm) return;
+        this.updateVmPosition();
+        this.applyVmActions(this.vm.popupOn());
+    }
 
-        object.cmds.delete();
+    popupOff() {
+        if (!this.vm) return;
+        this.applyVmActions(this.vm.popupOff());
+    }
 
-        this.proxy.blurayTitle = 0;
-        this.objectIdx = 0;
-        this.resetMenu();
-        this.nextObjectCommand();
+    moveSelection(direction: HdmvDirection) {
+        if (!this.vm) return;
+        this.applyVmActions(this.vm.moveSelection(direction));
     }
 
-    async executeCommand(cmd: MobjCmd, menu = false) {
-        // console.log(menu ? {
-        //     memory: { ...this.memory },
-        //     playlistId: this.playlistId,
-        //     menuPageId: this.menuPageId, 
-        //     menuSelected: this.menuSelected, 
-        //     menuIdx: this.menuIdx, 
-        //     insn: cmd.insn,
-        //     dst: cmd.dst.toString(16).padStart(8, '0'),
-        //     src: cmd.src.toString(16).padStart(8, '0')
-        // } : {
-        //     memory: { ...this.memory },
-        //     blurayTitle: this.blurayTitle,
-        //     objectIdx: this.objectIdx, 
-        //     insn: cmd.insn,
-        //     dst: cmd.dst.toString(16).padStart(8, '0'),
-        //     src: cmd.src.toString(16).padStart(8, '0')
-        // });
-        switch (cmd.insn.grp) {
-            case HDMV_INSN_GRP.INSN_GROUP_BRANCH:
-                switch (cmd.insn.subGrp) {
-                    case HDMV_INSN_GRP_BRANCH.BRANCH_GOTO:
-                        switch (cmd.insn.branchOpt) {
-                            case HDMV_INSN_GOTO.INSN_NOP:
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_GOTO.INSN_GOTO:
-                                if (menu) this.menuIdx = cmd.dst;
-                                else this.proxy.objectIdx = cmd.dst;
-                                return 1;
-                            case HDMV_INSN_GOTO.INSN_BREAK:
-                                this.proxy.objectIdx++;
-                                return 0;
-                            default:
-                                console.log('Unknown BRANCH_GOTO:', cmd.insn.branchOpt.toString(16));
-                        }
-                        return 0;
-                    case HDMV_INSN_GRP_BRANCH.BRANCH_JUMP:
-                        switch (cmd.insn.branchOpt) {
-                            case HDMV_INSN_JUMP.INSN_CALL_OBJECT:
-                            case HDMV_INSN_JUMP.INSN_CALL_TITLE:
-                                this.generateResumeInfo();
-                            case HDMV_INSN_JUMP.INSN_JUMP_OBJECT:
-                            case HDMV_INSN_JUMP.INSN_JUMP_TITLE:
-                                this.proxy.blurayTitle = cmd.insn.immOp1 
-                                    ? cmd.dst : this.getMemoryValue(cmd.dst);
-
-                                this.proxy.objectIdx = 0;
-
-                                if (menu) {
-                                    this.resetMenu();
-                                    this.nextObjectCommand();
-                                    return 0;
-                                } else return 1;
-                            case HDMV_INSN_JUMP.INSN_RESUME:
-                                if (!this.resumeInfo) throw new Error('No resume info found');
-
-                                const { blurayTitle, objectIdx, playlistId, playItemId, resumeTime } = this.resumeInfo;
-                                this.proxy.blurayTitle = blurayTitle;
-                                this.proxy.objectIdx = objectIdx;
-
-                                const playlist = this.blurayDiscInfo?.playlists.get(playlistId.toString());
-                                if (!playlist) throw new Error('Playlist not found');
-
-                                const vector = new this.module.StringVector();
-                                MpvPlayer.vectorToArray(playlist.clips).slice(playItemId)
-                                    .forEach((clip, i) => i 
-                                        ? vector.push_back(`/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`)
-                                        : this.module.loadFile(
-                                            `/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`, 
-                                            `start=${resumeTime},` +
-                                            'aid=' + (this.nextAudioTrack !== null
-                                                ? this.audioTracks[this.nextAudioTrack].id
-                                                : this.audioStream
-                                                    ? this.audioStream
-                                                    : 'auto'
-                                            )
-                                        ));
-
-                                this.module.loadFiles(vector);
-
-                                vector.delete();
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                const object = this.blurayDiscInfo?.mobjObjects.objects.get(
-                                    this.blurayTitle === 0xFFFF
-                                        ? this.blurayDiscInfo.firstPlayIdx
-                                        : Number(this.blurayDiscInfo.titleMap.get(this.blurayTitle))
-                                );
-                        
-                                if (!object) throw new Error('Object not found');
-
-                                this.proxy.menuCallAllow = !object.menuCallMask;
-
-                                object.cmds.delete();
-
-                                this.proxy.playlistId = playlistId;
-                                this.proxy.playItemId = playItemId;
-                                this.proxy.hasPopupMenu = Boolean(playlist.igs.menu.pageCount && this.blurayTitle !== 0);
-                                this.getBlurayChapters();
-                                
-                                if (menu) this.resetMenu();
-                                this.menuInitiated = false;
-
-                                this.resumeInfo = null;
-
-                                return 0;
-                            default:
-                                console.log('Unknown BRANCH_JUMP:', cmd.insn.branchOpt.toString(16));
-                        }
-                        return 0;
-                    case HDMV_INSN_GRP_BRANCH.BRANCH_PLAY:
-                        const dstVal = cmd.insn.immOp1 ? cmd.dst : this.getMemoryValue(cmd.dst);
-                        const srcVal = cmd.insn.immOp2 ? cmd.src : this.getMemoryValue(cmd.src);
-                        switch (cmd.insn.branchOpt) {
-                            case HDMV_INSN_PLAY.INSN_PLAY_PL:
-                            case HDMV_INSN_PLAY.INSN_PLAY_PL_PI: {
-                                const playlist = this.blurayDiscInfo?.playlists.get(dstVal.toString());
-                                if (!playlist) throw new Error('Playlist not found');
-                                
-                                const src = cmd.insn.branchOpt === HDMV_INSN_PLAY.INSN_PLAY_PL ? cmd.src : srcVal;
-
-                                const vector = new this.module.StringVector();
-                                MpvPlayer.vectorToArray(playlist.clips).slice(src)
-                                    .forEach((clip, i) => i 
-                                        ? vector.push_back(
-                                            `/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`
-                                        ) : this.module.loadFile(
-                                            `/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`, 
-                                            'aid=' + (this.nextAudioTrack !== null
-                                                ? this.audioTracks[this.nextAudioTrack]?.id
-                                                : this.audioStream
-                                                    ? this.audioStream
-                                                    : 'auto'
-                                            )
-                                        )
-                                    );
-
-                                this.module.loadFiles(vector);
-
-                                vector.delete();
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                this.proxy.playlistId = dstVal;
-                                this.proxy.playItemId = src;
-                                this.proxy.hasPopupMenu = Boolean(playlist.igs.menu.pageCount && this.blurayTitle !== 0);
-                                this.getBlurayChapters();
-                                
-                                if (menu) this.resetMenu();
-                                else this.proxy.objectIdx++;
-
-                                return 2;
-                            }
-                            case HDMV_INSN_PLAY.INSN_PLAY_PL_PM: {
-                                const playlist = this.blurayDiscInfo?.playlists.get(dstVal.toString());
-                                if (!playlist) throw new Error('Playlist not found');
-
-                                const playMark = playlist.marks.get(srcVal);
-                                if (!playMark) throw new Error('Play mark not found');
-
-                                const vector = new this.module.StringVector();
-                                const clips = MpvPlayer.vectorToArray(playlist.clips);
-                                const duration = clips.slice(0, playMark.clipRef)
-                                    .reduce((duration, clip) => duration + clip.outTime - clip.inTime, 0n);
-                                clips.slice(playMark.clipRef)
-                                    .forEach((clip, i) => i
-                                        ? vector.push_back(`/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`)
-                                        : this.module.loadFile(
-                                            `/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`, 
-                                            `start=${(playMark.start - duration) / 90000n},` +
-                                            'aid=' + (this.nextAudioTrack !== null
-                                                ? this.audioTracks[this.nextAudioTrack].id
-                                                : this.audioStream
-                                                    ? this.audioStream
-                                                    : 'auto'
-                                            )
-                                        ));
-
-                                this.module.loadFiles(vector);
-
-                                this.proxy.playlistId = dstVal;
-                                this.proxy.playItemId = playMark.clipRef;
-                                this.proxy.hasPopupMenu = Boolean(playlist.igs.menu.pageCount && this.blurayTitle !== 0);
-                                this.getBlurayChapters();
-
-                                vector.delete();
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                if (menu) this.resetMenu();
-                                else this.proxy.objectIdx++;
-
-                                return 2;
-                            }
-                            case HDMV_INSN_PLAY.INSN_TERMINATE_PL:
-                                this.module.stop();
-                                this.proxy.objectIdx++;
-                                return 0;
-                            case HDMV_INSN_PLAY.INSN_LINK_PI: {
-                                const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-                                if (!playlist) throw new Error('Playlist not found');
-
-                                const vector = new this.module.StringVector();
-                                MpvPlayer.vectorToArray(playlist.clips).slice(dstVal)
-                                    .forEach((clip, i) => i 
-                                        ? vector.push_back(`/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`) 
-                                        : this.module.loadFile(
-                                            `/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`, 
-                                            'aid=' + (this.nextAudioTrack !== null
-                                                ? this.audioTracks[this.nextAudioTrack].id
-                                                : this.audioStream
-                                                    ? this.audioStream
-                                                    : 'auto'
-                                            )
-                                        ));
-
-                                this.module.loadFiles(vector);
-
-                                vector.delete();
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                this.proxy.playItemId = dstVal;
-                                this.proxy.hasPopupMenu = Boolean(playlist.igs.menu.pageCount && this.blurayTitle !== 0);
-                                this.getBlurayChapters();
-                                
-                                if (menu) this.resetMenu();
-                                else this.proxy.objectIdx++;
-
-                                return 2;
-                            }
-                            case HDMV_INSN_PLAY.INSN_LINK_MK:
-                                const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-                                if (!playlist) throw new Error('Playlist not found');
-
-                                const playMark = playlist.marks.get(dstVal);
-                                if (!playMark) throw new Error('Play mark not found');
-
-                                const vector = new this.module.StringVector();
-                                const clips = MpvPlayer.vectorToArray(playlist.clips);
-                                const duration = clips.slice(0, playMark.clipRef)
-                                    .reduce((duration, clip) => duration + clip.outTime - clip.inTime, 0n);
-                                clips.slice(playMark.clipRef)
-                                    .forEach((clip, i) => i
-                                        ? vector.push_back(`/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`)
-                                        : this.module.loadFile(
-                                            `/${this.blurayDiscPath}/BDMV/STREAM/${clip.clipId}.m2ts`, 
-                                            `start=${(playMark.start - duration) / 90000n},` +
-                                            'aid=' + (this.nextAudioTrack !== null
-                                                ? this.audioTracks[this.nextAudioTrack].id
-                                                : this.audioStream
-                                                    ? this.audioStream
-                                                    : 'auto'
-                                            )
-                                        ));
-
-                                this.module.loadFiles(vector);
-
-                                vector.delete();
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                this.proxy.playItemId = playMark.clipRef;
-                                this.proxy.hasPopupMenu = Boolean(playlist.igs.menu.pageCount && this.blurayTitle !== 0);
-                                this.getBlurayChapters();
-                                
-                                if (menu) this.resetMenu();
-                                else this.proxy.objectIdx++;
-
-                                return 2; 
-                            default:
-                                console.log('Unknown BRANCH_PLAY:', cmd.insn.branchOpt.toString(16));
-                        }
-                        return 0;
-                    default:
-                        console.log('Unknown HDMV_INSN_GRP_BRANCH:', cmd.insn.subGrp.toString(16));
-                }
-                return 0;
-            case HDMV_INSN_GRP.INSN_GROUP_CMP:
-                const dstVal = cmd.insn.immOp1 ? cmd.dst : this.getMemoryValue(cmd.dst);
-                const srcVal = cmd.insn.immOp2 ? cmd.src : this.getMemoryValue(cmd.src);
-                switch (cmd.insn.cmpOpt) {
-                    case HDMV_INSN_CMP.INSN_BC:
-                        console.log('INSN_BC not yet implemented');
-                        return 0;
-                    case HDMV_INSN_CMP.INSN_EQ:
-                        if (menu) (dstVal === srcVal ? this.menuIdx++ : (this.menuIdx += 2))
-                        else (dstVal === srcVal ? this.objectIdx++ : (this.objectIdx += 2));
-                        return 1;
-                    case HDMV_INSN_CMP.INSN_NE:
-                        if (menu) dstVal !== srcVal ? this.menuIdx++ : (this.menuIdx += 2)
-                        else dstVal !== srcVal ? this.objectIdx++ : (this.objectIdx += 2);
-                        return 1;
-                    case HDMV_INSN_CMP.INSN_GE:
-                        if (menu) dstVal >= srcVal ? this.menuIdx++ : (this.menuIdx += 2)
-                        else dstVal >= srcVal ? this.objectIdx++ : (this.objectIdx += 2);
-                        return 1;
-                    case HDMV_INSN_CMP.INSN_GT:
-                        if (menu) dstVal > srcVal ? this.menuIdx++ : (this.menuIdx += 2)
-                        else dstVal > srcVal ? this.objectIdx++ : (this.objectIdx += 2);
-                        return 1;
-                    case HDMV_INSN_CMP.INSN_LE:
-                        if (menu) dstVal <= srcVal ? this.menuIdx++ : (this.menuIdx += 2)
-                        else dstVal <= srcVal ? this.objectIdx++ : (this.objectIdx += 2);
-                        return 1;
-                    case HDMV_INSN_CMP.INSN_LT:
-                        if (menu) dstVal < srcVal ? this.menuIdx++ : (this.menuIdx += 2)
-                        else dstVal < srcVal ? this.objectIdx++ : (this.objectIdx += 2);
-                        return 1;
-                    default:
-                        console.log('Unknown HDMV_INSN_CMP:', cmd.insn.subGrp.toString(16));
-                }
-                return 0;
-            case HDMV_INSN_GRP.INSN_GROUP_SET:
-                switch (cmd.insn.subGrp) {
-                    case HDMV_INSN_GRP_SET.SET_SET:
-                        const dstVal = cmd.insn.immOp1 ? cmd.dst : this.getMemoryValue(cmd.dst);
-                        const srcVal = cmd.insn.immOp2 ? cmd.src : this.getMemoryValue(cmd.src);
-                        switch (cmd.insn.setOpt) {
-                            case HDMV_INSN_SET.INSN_MOVE:
-                                this.setMemoryValue(cmd.dst, srcVal);
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_SWAP:
-                                this.setMemoryValue(cmd.dst, srcVal);
-                                this.setMemoryValue(cmd.src, dstVal);
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_ADD:
-                                this.setMemoryValue(cmd.dst, dstVal + srcVal);
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_SUB:
-                                if (dstVal > srcVal)
-                                    this.setMemoryValue(cmd.dst, dstVal - srcVal);
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_MUL:
-                                this.setMemoryValue(cmd.dst, dstVal * srcVal);
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_DIV:
-                                this.setMemoryValue(cmd.dst, dstVal / srcVal);
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_MOD:
-                                this.setMemoryValue(cmd.dst, dstVal % srcVal);
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_RND:
-                                this.setMemoryValue(cmd.dst, getRandom(1, srcVal));
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_AND:
-                                this.setMemoryValue(cmd.dst, Number(BigInt(srcVal) & BigInt(dstVal)));
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_OR:
-                                this.setMemoryValue(cmd.dst, Number(BigInt(srcVal) | BigInt(dstVal)));
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_XOR:
-                                this.setMemoryValue(cmd.dst, Number(BigInt(srcVal) ^ BigInt(dstVal)));
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SET.INSN_BITSET:
-                                this.setMemoryValue(cmd.dst, Number(BigInt(2**srcVal) | BigInt(dstVal)));
-                                return 1;
-                            case HDMV_INSN_SET.INSN_BITCLR:
-                                this.setMemoryValue(cmd.dst, Number(BigInt(2**srcVal) ^ BigInt(dstVal)));
-                                return 1;
-                            case HDMV_INSN_SET.INSN_SHL:
-                                this.setMemoryValue(cmd.dst, Number(BigInt(dstVal) << BigInt(srcVal)));
-                                return 0;
-                            case HDMV_INSN_SET.INSN_SHR:
-                                this.setMemoryValue(cmd.dst, Number(BigInt(dstVal) >> BigInt(srcVal)));
-                                return 0;
-                            default:
-                                console.log('Unknown HDMV_INSN_SET:', cmd.insn.subGrp.toString(16));
-                        }
-                        return 0;
-                    case HDMV_INSN_GRP_SET.SET_SETSYSTEM:
-                        switch (cmd.insn.setOpt) {
-                            case HDMV_INSN_SETSYSTEM.INSN_SET_STREAM:
-                                const audioFlag = (BigInt(cmd.dst) & 0x80000000n) >> 31n;
-                                const pgFlag = (BigInt(cmd.dst) & 0x8000n) >> 15n;
-                                const dispFlag = (BigInt(cmd.dst) & 0x4000n) >> 14n;
-                                // const igFlag = (BigInt(cmd.src) & 0x80000000n) >> 31n;
-                                // const angleFlag = (BigInt(cmd.src) & 0x8000n) >> 15n;
-                                
-                                const newAudioStream = Number((BigInt(cmd.dst) & 0xFF0000n) >> 16n);
-                                const trackIdx = (cmd.insn.immOp1 
-                                    ? newAudioStream 
-                                    : this.getMemoryValue(newAudioStream)
-                                ) - 1;
-                                if (audioFlag) this.audioTracks[trackIdx]
-                                    ? this.module.setAudioTrack(this.audioTracks[trackIdx].id)
-                                    : (this.nextAudioTrack = trackIdx);
-
-                                const newSubtitleStream = BigInt(cmd.dst) & 0xFFn;
-                                if (pgFlag) {
-                                    this.subtitleDispFlag = !!(dispFlag);
-                                    this.module.setSubtitleTrack(dispFlag
-                                        ? cmd.insn.immOp1 
-                                            ? newSubtitleStream 
-                                            : BigInt(this.getMemoryValue(Number(newSubtitleStream)))
-                                        : 0n);
-                                }
-                                
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            case HDMV_INSN_SETSYSTEM.INSN_SET_NV_TIMER:
-                                console.log('SET_NV_TIMER not yet implemented');
-                                return 0;
-                            case HDMV_INSN_SETSYSTEM.INSN_SET_BUTTON_PAGE:
-                                if (!menu) return 0;
-
-                                const dstVal = cmd.insn.immOp1 
-                                    ? Number(BigInt(cmd.dst) & 0xFFFn)
-                                    : this.getMemoryValue(Number(BigInt(cmd.dst) & 0xFFFFn));
-                                const srcVal = cmd.insn.immOp2 
-                                    ? Number(BigInt(cmd.src) & 0xFFFn)
-                                    : this.getMemoryValue(Number(BigInt(cmd.src) & 0xFFn));
-
-                                if (cmd.src >= 0x80000000) this.menuPageId = srcVal;
-
-                                const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-                                if (!playlist) return 0;
-
-                                const page = playlist.igs.menu.pages.get(this.menuPageId);
-                                if (!page) return 0;
-                                
-                                const duration = MpvPlayer.vectorToArray(page.inEffects.effects)
-                                    .reduce((duration, effect) => duration + effect.duration, 0) / 90;
-
-                                await new Promise(resolve => setTimeout(resolve, duration));
-
-                                if (cmd.src >= 0x80000000) {
-                                    this.setPageButtons();
-                                    this.proxy.menuPageId = srcVal
-                                };
-
-                                const newMenuSelected = cmd.dst >= 0x80000000 ? dstVal : page.defButton;
-                                const bogIdx = MpvPlayer.vectorToArray(page.bogs)
-                                    .findIndex(bog => MpvPlayer.vectorToArray(bog.buttonIds)
-                                        .includes(newMenuSelected));
-                                this.buttonState[bogIdx] = newMenuSelected;
-
-                                this.proxy.menuSelected = newMenuSelected;
-                                this.proxy.menuActivated = false;
-                                this.menuIdx = 0;
-
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                return 1;
-                            case HDMV_INSN_SETSYSTEM.INSN_ENABLE_BUTTON: {
-                                const dstVal = cmd.insn.immOp1 ? cmd.dst : this.getMemoryValue(cmd.dst);
-                                
-                                const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-                                if (!playlist) return 0;
-
-                                const page = playlist.igs.menu.pages.get(this.menuPageId);
-                                if (!page) return 0;
-
-                                const bogIdx = MpvPlayer.vectorToArray(page.bogs)
-                                    .findIndex(bog => MpvPlayer.vectorToArray(bog.buttonIds)
-                                        .includes(dstVal));
-
-                                this.buttonState[bogIdx] = dstVal;
-
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            }
-                            case HDMV_INSN_SETSYSTEM.INSN_DISABLE_BUTTON: {
-                                const dstVal = cmd.insn.immOp1 ? cmd.dst : this.getMemoryValue(cmd.dst);
-                                
-                                const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-                                if (!playlist) return 0;
-
-                                const page = playlist.igs.menu.pages.get(this.menuPageId);
-                                if (!page) return 0;
-
-                                const bogs = MpvPlayer.vectorToArray(page.bogs);
-                                const bogIdx = bogs.findIndex(bog => 
-                                    MpvPlayer.vectorToArray(bog.buttonIds).includes(dstVal));
-
-                                this.buttonState[bogIdx] = bogs[bogIdx].defButton;
-
-                                MpvPlayer.destructPlaylist(playlist);
-
-                                if (menu) this.menuIdx++;
-                                else this.proxy.objectIdx++;
-                                return 1;
-                            }
-                            case HDMV_INSN_SETSYSTEM.INSN_SET_SEC_STREAM:
-                                console.log('SET_SEC_STREAM not yet implemented');
-                                return 0;
-                            case HDMV_INSN_SETSYSTEM.INSN_POPUP_OFF:
-                                this.resetMenu();
-                                return 0;
-                            case HDMV_INSN_SETSYSTEM.INSN_STILL_ON:
-                                console.log('STILL_ON not yet implemented');
-                                return 0;
-                            case HDMV_INSN_SETSYSTEM.INSN_STILL_OFF:
-                                console.log('STILL_OFF not yet implemented');
-                                return 0;
-                            case HDMV_INSN_SETSYSTEM.INSN_SET_OUTPUT_MODE:
-                                console.log('SET_OUTPUT_MODE not yet implemented');
-                                return 0;
-                            case HDMV_INSN_SETSYSTEM.INSN_SET_STREAM_SS:
-                                console.log('SET_STREAM_SS not yet implemented');
-                                return 0;
-                            case HDMV_INSN_SETSYSTEM.INSN_SETSYSTEM_0x10:
-                                console.log('SETSYSTEM_0x10 not yet implemented');
-                                return 0;
-                            default:
-                                console.log('SET_SETSYSTEM not yet implemented');
-                        }
-                        return 0;
-                    
-                    default:
-                        console.log('Unknown HDMV_INSN_CMP:', cmd.insn.subGrp.toString(16));
-                }
-                return 0;
-            default:
-                console.log('Unknown instruction group:', cmd.insn.grp.toString(16));
-        }
+    menuActivate() {
+        if (!this.vm) return;
+        this.updateVmPosition();
+        this.applyVmActions(this.vm.activateButton());
     }
 
+
     getBlurayChapters() {
-        const playlist = this.blurayDiscInfo?.playlists.get(this.playlistId.toString());
-        if (!playlist) return;
-
-        const clipTimes = MpvPlayer.vectorToArray(playlist.clips).reduce((timeArr: bigint[], clip) => {
-            const diff = clip.outTime - clip.inTime;
-            timeArr.push(diff + timeArr[timeArr.length - 1]);
-            return timeArr;
-        }, [0n]);
-
-        const chapters = MpvPlayer.vectorToArray(playlist.marks).slice(0, -1).map((mark, i) => ({
-            title: `Chapter ${i + 1} (Clip ${mark.clipRef + 1})`,
-            time: Number((mark.start - clipTimes[mark.clipRef]) / 90000n)
-        }));
+        if (!this.blurayDiscInfo?.hasPlaylist(this.playlistId)) return;
+
+        const chapters: Chapter[] = [];
+        const markCount = this.blurayDiscInfo.getMarkCount(this.playlistId);
+        for (let i = 0; i < markCount - 1; i++) {
+            const mark = this.blurayDiscInfo.getMark(this.playlistId, i);
+            chapters.push({
+                title: `Chapter ${i + 1}`,
+                time: Number(mark.start) / 90000
+            });
+        }
 
         this.proxy.chapters = chapters;
-
-        MpvPlayer.destructPlaylist(playlist);
     }
 
     resetBluray() {
-        this.memory = {};
-
+        this.vm?.delete();
+        this.vm = null;
+        this.blurayDiscInfo?.delete();
         this.blurayDiscInfo = null;
         this.blurayDiscPath = '/';
         this.objectIdx = 0;
-        this.menuIdx = 0;
 
         this.videoStream = 1;
         this.audioStream = 1;
-        this.nextAudioTrack = null;
         this.currentChapter = 0;
         this.subtitleStream = 1;
-        this.subtitleDispFlag = false;
         
         this.blurayTitle = 0;
         this.playlistId = 0;
         this.playItemId = 0;
+        this.loadedPlaylistId = null;
 
         this.menuPictures = {};
+        this.menuBackgrounds = {};
         this.menuActivated = false;
         this.menuSelected = 0;
         this.menuPageId = -1;
         this.buttonState = [];
         this.menuCallAllow = false;
         this.hasPopupMenu = false;
-        this.menuInitiated = false;
+        this.hasResume = false;
+    }
 
-        this.resumeInfo = null;
+    // Sprite sheet of count keyframe tiles spread over the file.
+    async createStoryboard(path: string, count = 100, tileWidth = 160, columns = 10) {
+        await this.module.getPromise(this.module.createStoryboard(path, count, tileWidth, columns));
+
+        const { times, sprite, ...layout } = this.module.getStoryboard(path);
+        return {
+            ...layout,
+            times: MpvPlayer.takeVector(times),
+            image: sprite ? await loadImage('data:image/png;base64,' + sprite) : null
+        };
+    }
+
+    // Times createStoryboard against one linear decode of the whole file
+    // making the same tiles, in milliseconds. Use a long 1080p file.
+    async benchmarkStoryboard(path: string, count = 100, tileWidth = 160) {
+        await this.module.getPromise(this.module.benchmarkStoryboard(path, count, tileWidth));
+        return this.module.getStoryboardBenchmark();
+    }
+
+    // Peak and RMS per bucket over the whole file, plus short-term loudness
+    // in LUFS if asked for. audioTrack follows mpv's aid, 0 for the default.
+    async getWaveform(path: string, buckets = 1000, audioTrack = 0, loudness = false) {
+        await this.module.getPromise(this.module.createWaveform(path, audioTrack, buckets, loudness));
+
+        const waveform = this.module.getWaveform(path, audioTrack, buckets, loudness);
+        if (!waveform) return null;
+
+        return {
+            buckets: waveform.buckets as number,
+            bucketDuration: waveform.bucketDuration as number,
+            peaks: new Float32Array(waveform.peaks),
+            rms: new Float32Array(waveform.rms),
+            loudness: loudness ? new Float32Array(waveform.loudness) : null
+        };
+    }
+
+    // Entry mark thumbnails for a playlist of the open disc. Generated once
+    // per playlist and width, so reopening a chapter menu resolves at once.
+    async getChapterThumbnails(playlistId: number, width = 240) {
+        await this.module.getPromise(this.module.createChapterThumbnails(playlistId, width));
+
+        return Promise.all(
+            MpvPlayer.takeVector(this.module.getChapterThumbnails(playlistId, width)).map(async ({ image, ...chapter }) => ({
+                ...chapter,
+                image: image ? await loadImage('data:image/png;base64,' + image) : null
+            }))
+        );
+    }
+
+    // Preview for a hover position on the seek bar. Calls made while one is
+    // still decoding replace each other, so the result may be for a later
+    // time than asked; time says which request it answers.
+    async getScrubPreview(time: number, width = 256) {
+        await this.module.getPromise(this.module.requestScrubPreview(time, width));
+
+        const preview = this.module.getScrubPreview();
+        if (!preview) return null;
+
+        return {
+            time: preview.time as number,
+            keyframeTime: preview.keyframeTime as number,
+            image: new ImageData(new Uint8ClampedArray(preview.data), preview.width, preview.height)
+        };
+    }
+
+    // Tile showing the last keyframe at or before time, skipping tiles that failed to decode.
+    static getStoryboardTile(times: number[], time: number) {
+        let tile = -1;
+        times.forEach((tileTime, i) => {
+            if (tileTime >= 0 && tileTime <= time) tile = i;
+        });
+        return tile;
+    }
+
+    // Indexes every file, BDMV tree and ISO under path. Entries arrive
+    // through libraryEntries as workers finish probing them.
+    scanLibrary(path: string) {
+        this.module.libraryScan(path);
+    }
+
+    updateLibrary(scanning: boolean) {
+        const updates = MpvPlayer.takeVector(this.module.libraryTakeUpdates());
+
+        if (updates.length) {
+            const entries = new Map(this.libraryEntries.map(entry => [entry.path, entry]));
+            updates.forEach(entry => entry.removed
+                ? entries.delete(entry.path)
+                : entries.set(entry.path, entry)
+            );
+            this.proxy.libraryEntries = [...entries.values()];
+        }
+
+        if (scanning !== this.libraryScanning)
+            this.proxy.libraryScanning = scanning;
     }
 
     async loadBluray(path: string) {
@@ -1137,24 +1001,21 @@ export default class MpvPlayer {
         this.proxy.blurayDiscPath = path;
         this.proxy.title = typeof this.proxy.blurayDiscInfo.discName === 'string' ? this.proxy.blurayDiscInfo.discName : "Bluray Disc";
 
-        if (this.proxy.blurayDiscInfo.firstPlaySupported)
-            this.proxy.blurayTitle = 0xFFFF;
-
+        const discInfo = this.proxy.blurayDiscInfo;
         const menuPictures: Record<string, Record<string, Record<string, HTMLImageElement>>>= {};
         await Promise.all(
-            MpvPlayer.vectorToArray(this.proxy.blurayDiscInfo.playlists.keys()).map(async playlistId => {
-                const playlist = this.proxy.blurayDiscInfo!.playlists.get(playlistId);
-                if (!playlist || typeof playlistId !== 'string') return;
+            MpvPlayer.takeVector(discInfo.getPlaylistIds()).map(async playlistId => {
                 const playlistImages: Record<string, Record<string, HTMLImageElement>> = {};
                 await Promise.all(
-                    MpvPlayer.vectorToArray(playlist.igs.pictures.keys()).map(async pictureId => {
-                        const picture = playlist.igs.pictures.get(pictureId);
+                    MpvPlayer.takeVector(discInfo.getPictureIds(playlistId)).map(async pictureId => {
+                        const picture = discInfo.getPicture(playlistId, pictureId);
                         const images: Record<string, HTMLImageElement> = {};
-                        if (!picture || typeof pictureId !== 'string') return;
+                        const paletteIds = MpvPlayer.takeVector(picture.data.keys());
+                        const pictureData = paletteIds.map(paletteId => [paletteId, picture.data.get(paletteId)]);
+                        picture.data.delete();
                         
                         await Promise.all(
-                            MpvPlayer.vectorToArray(picture.data.keys()).map(async paletteId => {
-                                const base64 = picture.data.get(paletteId);
+                            pictureData.map(async ([paletteId, base64]) => {
                                 if (typeof paletteId !== 'string' || typeof base64 !== 'string') 
                                     return;
             
@@ -1172,6 +1033,27 @@ export default class MpvPlayer {
         
         this.proxy.menuPictures = menuPictures;
 
-        this.nextObjectCommand();
+        this.vm = new this.module.HdmvVm(discInfo);
+        this.applyVmActions(this.vm.start());
+        this.loadMenuBackgrounds(path);
+    }
+
+    // Stills under each menu are decoded in the background after the disc
+    // opens, and show up in menuBackgrounds once they're all done.
+    async loadMenuBackgrounds(path: string) {
+        await this.module.getPromise(this.module.createMenuBackgrounds());
+        if (this.blurayDiscPath !== path || !this.blurayDiscInfo) return;
+
+        const menuBackgrounds: Record<string, HTMLImageElement> = {};
+        await Promise.all(
+            MpvPlayer.takeVector(this.blurayDiscInfo.getPlaylistIds()).map(async playlistId => {
+                const background = this.module.getMenuBackground(playlistId);
+                if (background)
+                    menuBackgrounds[playlistId] = await loadImage('data:image/png;base64,' + background);
+            })
+        );
+
+        if (this.blurayDiscPath === path)
+            this.proxy.menuBackgrounds = menuBackgrounds;
     }
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
 import MpvPlayer from './MpvPlayer';
 
-export default MpvPlayer;
\ No newline at end of file
+export { MpvFormat } from './MpvPlayer';
+export type { MpvRequest } from './MpvPlayer';
+export default MpvPlayer;
@@ -0,0 +1,148 @@
+#include "bd_chapters.h"
+
+typedef tuple<string, uint32_t, int> chapter_key_t;
+
+typedef struct chapter_job_t {
+    string clip_path;
+    uint64_t clip_time;
+    size_t thumbnail_idx;
+} chapter_job_t;
+
+typedef struct chapter_batch_t {
+    vector<chapter_job_t> jobs;
+    vector<bd_chapter_thumbnail_t> *thumbnails;
+    size_t next_job;
+    int width;
+    pthread_mutex_t lock;
+} chapter_batch_t;
+
+static map<chapter_key_t, vector<bd_chapter_thumbnail_t>> cache;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// clip_time is a PTS in the clip at 90kHz, like the CLPI in/out times.
+static string get_chapter_image(video_decoder_t *decoder, uint64_t clip_time, int width) {
+    AVStream *stream = decoder->format->streams[decoder->stream_index];
+    int64_t start_time = stream->start_time != AV_NOPTS_VALUE
+        ? av_rescale_q(stream->start_time, stream->time_base, { 1, 90000 })
+        : 0;
+
+    AVFrame *frame = decode_frame_at(decoder, ((int64_t)clip_time - start_time) / 90000.0);
+    if (!frame)
+        return "";
+
+    string image = encode_frame_png(frame, width);
+    av_frame_free(&frame);
+
+    return image;
+}
+
+// Jobs are sorted by clip, so a worker keeps its decoder while it takes
+// marks from the same clip.
+static void *chapter_worker(void *args) {
+    chapter_batch_t *batch = (chapter_batch_t *)args;
+    video_decoder_t decoder = { NULL, NULL, -1, NULL };
+    string decoder_path;
+
+    while (true) {
+        pthread_mutex_lock(&batch->lock);
+        size_t job_idx = batch->next_job++;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (job_idx >= batch->jobs.size())
+            break;
+
+        const chapter_job_t &job = batch->jobs[job_idx];
+        if (job.clip_path != decoder_path) {
+            if (decoder.format)
+                close_video_decoder(&decoder);
+            decoder_path = job.clip_path;
+
+            if (open_video_decoder(&decoder, decoder_path.c_str(), 0, 0) && decoder.codec)
+                decoder.codec->skip_frame = AVDISCARD_NONKEY;
+        }
+
+        if (decoder.codec)
+            (*batch->thumbnails)[job.thumbnail_idx].image = get_chapter_image(&decoder, job.clip_time, batch->width);
+    }
+
+    if (decoder.format)
+        close_video_decoder(&decoder);
+
+    return NULL;
+}
+
+vector<bd_chapter_thumbnail_t> bd_chapter_thumbnails(DiscInfo disc, string disc_path, uint32_t playlist_id, int width) {
+    chapter_key_t key = { disc_path, playlist_id, width };
+
+    pthread_mutex_lock(&cache_lock);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        vector<bd_chapter_thumbnail_t> thumbnails = it->second;
+        pthread_mutex_unlock(&cache_lock);
+        return thumbnails;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    vector<bd_chapter_thumbnail_t> thumbnails;
+    const bluray_playlist_info_t *playlist = disc.find_playlist(playlist_id);
+    if (!playlist)
+        return thumbnails;
+
+    chapter_batch_t batch;
+    batch.thumbnails = &thumbnails;
+    batch.next_job = 0;
+    batch.width = width;
+    pthread_mutex_init(&batch.lock, NULL);
+
+    const vector<uint64_t> &play_item_starts = playlist->time_index.play_item_starts;
+    bool has_clips = !bd_image_is_iso(disc_path);
+
+    for (uint32_t mark_idx = 0; mark_idx < playlist->marks.size(); mark_idx++) {
+        const BLURAY_TITLE_MARK &mark = playlist->marks[mark_idx];
+        if (mark.type != BLURAY_MARK_ENTRY)
+            continue;
+
+        thumbnails.push_back({ mark_idx, mark.start / 90000.0, "" });
+
+        if (!has_clips || mark.clip_ref >= playlist->clips.size() || mark.clip_ref >= play_item_starts.size())
+            continue;
+
+        const bluray_clip_info_t &clip = playlist->clips[mark.clip_ref];
+        uint64_t play_item_start = play_item_starts[mark.clip_ref];
+        uint64_t offset = mark.start > play_item_start ? mark.start - play_item_start : 0;
+
+        batch.jobs.push_back({
+            disc_path + "/BDMV/STREAM/" + clip.clip_id + ".m2ts",
+            clip.in_time + offset,
+            thumbnails.size() - 1
+        });
+    }
+
+    sort(batch.jobs.begin(), batch.jobs.end(), [](const chapter_job_t &a, const chapter_job_t &b) {
+        return a.clip_path != b.clip_path ? a.clip_path < b.clip_path : a.clip_time < b.clip_time;
+    });
+
+    uint32_t worker_count = min<size_t>(BD_CHAPTER_WORKERS, batch.jobs.size());
+    vector<pthread_t> workers(worker_count);
+    for (pthread_t &worker : workers)
+        pthread_create(&worker, NULL, chapter_worker, &batch);
+    for (pthread_t &worker : workers)
+        pthread_join(worker, NULL);
+
+    pthread_mutex_destroy(&batch.lock);
+
+    pthread_mutex_lock(&cache_lock);
+    cache[key] = thumbnails;
+    pthread_mutex_unlock(&cache_lock);
+
+    return thumbnails;
+}
+
+vector<bd_chapter_thumbnail_t> bd_get_chapter_thumbnails(string disc_path, uint32_t playlist_id, int width) {
+    pthread_mutex_lock(&cache_lock);
+    auto it = cache.find({ disc_path, playlist_id, width });
+    vector<bd_chapter_thumbnail_t> thumbnails = it != cache.end() ? it->second : vector<bd_chapter_thumbnail_t>();
+    pthread_mutex_unlock(&cache_lock);
+
+    return thumbnails;
+}
@@ -0,0 +1,318 @@
+#include "bd_image.h"
+
+typedef struct image_block_t {
+    shared_ptr<const vector<uint8_t>> data;
+    list<uint32_t>::iterator lru;
+} image_block_t;
+
+// One open image. The block cache is shared by every libbluray handle on
+// it; files_bd only serves path based reads and is guarded by files_lock
+// since libbluray's UDF reader isn't thread safe.
+typedef struct bd_image_t {
+    string path;
+    int fd;
+    map<uint32_t, image_block_t> blocks;
+    list<uint32_t> lru;
+    int64_t cache_size;
+    pthread_mutex_t cache_lock;
+    BLURAY *files_bd;
+    pthread_mutex_t files_lock;
+} bd_image_t;
+
+typedef struct image_file_t {
+    BD_FILE_H *file;
+    shared_ptr<bd_image_t> image;
+} image_file_t;
+
+static shared_ptr<bd_image_t> current_image;
+static map<BLURAY *, shared_ptr<bd_image_t>> open_images;
+static BD_FILE_OPEN default_file_open = NULL;
+static pthread_mutex_t image_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const int64_t BLOCK_SIZE = (int64_t)BD_IMAGE_SECTOR_SIZE * BD_IMAGE_BLOCK_SECTORS;
+
+static shared_ptr<const vector<uint8_t>> get_block(bd_image_t *image, uint32_t block_idx) {
+    pthread_mutex_lock(&image->cache_lock);
+    auto it = image->blocks.find(block_idx);
+    if (it != image->blocks.end()) {
+        image->lru.splice(image->lru.begin(), image->lru, it->second.lru);
+        shared_ptr<const vector<uint8_t>> data = it->second.data;
+        pthread_mutex_unlock(&image->cache_lock);
+        return data;
+    }
+    pthread_mutex_unlock(&image->cache_lock);
+
+    shared_ptr<vector<uint8_t>> data = make_shared<vector<uint8_t>>(BLOCK_SIZE);
+    ssize_t len = pread(image->fd, data->data(), BLOCK_SIZE, (off_t)block_idx * BLOCK_SIZE);
+    if (len <= 0) {
+        if (len < 0) fprintf(stderr, "Couldn't read block %u of %s\n", block_idx, image->path.c_str());
+        return NULL;
+    }
+    data->resize(len - len % BD_IMAGE_SECTOR_SIZE);
+
+    pthread_mutex_lock(&image->cache_lock);
+    if (!image->blocks.count(block_idx)) {
+        while (image->cache_size + (int64_t)data->size() > BD_IMAGE_CACHE_SIZE && !image->lru.empty()) {
+            auto oldest = image->blocks.find(image->lru.back());
+            image->cache_size -= oldest->second.data->size();
+            image->blocks.erase(oldest);
+            image->lru.pop_back();
+        }
+
+        image->lru.push_front(block_idx);
+        image->blocks[block_idx] = { data, image->lru.begin() };
+        image->cache_size += data->size();
+    }
+    pthread_mutex_unlock(&image->cache_lock);
+
+    return data;
+}
+
+// libbluray read_blocks callback. Returns the number of sectors read.
+static int read_blocks(void *handle, void *buf, int lba, int num_blocks) {
+    bd_image_t *image = (bd_image_t *)handle;
+    uint8_t *out = (uint8_t *)buf;
+    int done = 0;
+
+    while (done < num_blocks) {
+        uint32_t sector = lba + done;
+        uint32_t block_sector = sector % BD_IMAGE_BLOCK_SECTORS;
+        shared_ptr<const vector<uint8_t>> block = get_block(image, sector / BD_IMAGE_BLOCK_SECTORS);
+        if (!block) break;
+
+        int available = (int)(block->size() / BD_IMAGE_SECTOR_SIZE) - (int)block_sector;
+        if (available <= 0) break;
+
+        int count = min(available, num_blocks - done);
+        memcpy(out + (int64_t)done * BD_IMAGE_SECTOR_SIZE, block->data() + (int64_t)block_sector * BD_IMAGE_SECTOR_SIZE, (int64_t)count * BD_IMAGE_SECTOR_SIZE);
+        done += count;
+    }
+
+    return done;
+}
+
+static void free_image(bd_image_t *image) {
+    if (image->files_bd) bd_close(image->files_bd);
+    close(image->fd);
+    pthread_mutex_destroy(&image->cache_lock);
+    pthread_mutex_destroy(&image->files_lock);
+    delete image;
+}
+
+static void file_close(BD_FILE_H *file) {
+    image_file_t *internal = (image_file_t *)file->internal;
+    pthread_mutex_lock(&internal->image->files_lock);
+    internal->file->close(internal->file);
+    pthread_mutex_unlock(&internal->image->files_lock);
+    delete internal;
+    delete file;
+}
+
+static int64_t file_seek(BD_FILE_H *file, int64_t offset, int32_t origin) {
+    image_file_t *internal = (image_file_t *)file->internal;
+    pthread_mutex_lock(&internal->image->files_lock);
+    int64_t pos = internal->file->seek(internal->file, offset, origin);
+    pthread_mutex_unlock(&internal->image->files_lock);
+    return pos;
+}
+
+static int64_t file_tell(BD_FILE_H *file) {
+    image_file_t *internal = (image_file_t *)file->internal;
+    return internal->file->tell(internal->file);
+}
+
+static int file_eof(BD_FILE_H *file) {
+    image_file_t *internal = (image_file_t *)file->internal;
+    return internal->file->eof(internal->file);
+}
+
+static int64_t file_read(BD_FILE_H *file, uint8_t *buf, int64_t size) {
+    image_file_t *internal = (image_file_t *)file->internal;
+    pthread_mutex_lock(&internal->image->files_lock);
+    int64_t len = internal->file->read(internal->file, buf, size);
+    pthread_mutex_unlock(&internal->image->files_lock);
+    return len;
+}
+
+// Opens path from the current image, or returns false if it isn't inside one.
+static bool open_image_file(string path, BD_FILE_H **file) {
+    pthread_mutex_lock(&image_lock);
+    shared_ptr<bd_image_t> image = current_image;
+    pthread_mutex_unlock(&image_lock);
+
+    string prefix = image ? image->path + "/" : "";
+    if (!image || path.compare(0, prefix.size(), prefix) != 0)
+        return false;
+
+    string rel_path = path.substr(prefix.size());
+
+    pthread_mutex_lock(&image->files_lock);
+    BD_FILE_H *inner = bd_open_file_dec(image->files_bd, rel_path.c_str());
+    pthread_mutex_unlock(&image->files_lock);
+
+    *file = NULL;
+    if (!inner) {
+        fprintf(stderr, "Couldn't find %s in %s\n", rel_path.c_str(), image->path.c_str());
+        return true;
+    }
+
+    *file = new BD_FILE_H {};
+    (*file)->internal = new image_file_t { inner, image };
+    (*file)->close = file_close;
+    (*file)->seek = file_seek;
+    (*file)->tell = file_tell;
+    (*file)->eof = file_eof;
+    (*file)->read = file_read;
+
+    return true;
+}
+
+// Replaces libbluray's file_open, which bd_read_mpls, bd_read_clpi and
+// bd_read_mobj go through.
+static BD_FILE_H *image_file_open(const char *filename, const char *mode) {
+    BD_FILE_H *file;
+    if (!strchr(mode, 'w') && open_image_file(filename, &file))
+        return file;
+
+    return default_file_open(filename, mode);
+}
+
+static shared_ptr<bd_image_t> get_image(string path) {
+    pthread_mutex_lock(&image_lock);
+
+    if (current_image && current_image->path == path) {
+        shared_ptr<bd_image_t> image = current_image;
+        pthread_mutex_unlock(&image_lock);
+        return image;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Couldn't open image %s\n", path.c_str());
+        pthread_mutex_unlock(&image_lock);
+        return NULL;
+    }
+
+    shared_ptr<bd_image_t> image(new bd_image_t { path, fd, {}, {}, 0 }, free_image);
+    pthread_mutex_init(&image->cache_lock, NULL);
+    pthread_mutex_init(&image->files_lock, NULL);
+
+    image->files_bd = bd_init();
+    if (!image->files_bd || !bd_open_stream(image->files_bd, image.get(), read_blocks)) {
+        fprintf(stderr, "Couldn't read UDF filesystem from %s\n", path.c_str());
+        pthread_mutex_unlock(&image_lock);
+        return NULL;
+    }
+
+    if (!default_file_open)
+        default_file_open = bd_register_file(image_file_open);
+
+    current_image = image;
+    pthread_mutex_unlock(&image_lock);
+
+    return image;
+}
+
+bool bd_image_is_iso(string path) {
+    if (path.size() < 4)
+        return false;
+
+    return strcasecmp(path.c_str() + path.size() - 4, ".iso") == 0;
+}
+
+BLURAY *bd_image_open(string path) {
+    shared_ptr<bd_image_t> image = get_image(path);
+    if (!image)
+        return NULL;
+
+    BLURAY *bd = bd_init();
+    if (!bd || !bd_open_stream(bd, image.get(), read_blocks)) {
+        fprintf(stderr, "Couldn't open disc in %s\n", path.c_str());
+        if (bd) bd_close(bd);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&image_lock);
+    open_images[bd] = image;
+    pthread_mutex_unlock(&image_lock);
+
+    return bd;
+}
+
+// The entry is taken out before bd_close, since an open racing with this
+// one can get the same address back and register its own image under it.
+void bd_image_close(BLURAY *bd) {
+    pthread_mutex_lock(&image_lock);
+    shared_ptr<bd_image_t> image;
+    auto it = open_images.find(bd);
+    if (it != open_images.end()) {
+        image = it->second;
+        open_images.erase(it);
+    }
+    pthread_mutex_unlock(&image_lock);
+
+    bd_close(bd);
+    image.reset();
+}
+
+class image_file_buf : public streambuf {
+public:
+    image_file_buf(BD_FILE_H *file) : file(file) {}
+    ~image_file_buf() { if (file) file->close(file); }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        int64_t len = file ? file->read(file, (uint8_t *)buffer, sizeof(buffer)) : 0;
+        if (len <= 0)
+            return traits_type::eof();
+
+        setg(buffer, buffer, buffer + len);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    // The file position is ahead of the stream by whatever is still
+    // buffered, so relative seeks are corrected for it.
+    pos_type seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode which) override {
+        if (!file)
+            return pos_type(off_type(-1));
+
+        if (dir == ios_base::cur)
+            off -= egptr() - gptr();
+
+        int32_t origin = dir == ios_base::beg ? SEEK_SET : dir == ios_base::cur ? SEEK_CUR : SEEK_END;
+        int64_t pos = file->seek(file, off, origin);
+        setg(buffer, buffer, buffer);
+
+        return pos < 0 ? pos_type(off_type(-1)) : pos_type(pos);
+    }
+
+    pos_type seekpos(pos_type pos, ios_base::openmode which) override {
+        return seekoff(off_type(pos), ios_base::beg, which);
+    }
+
+private:
+    BD_FILE_H *file;
+    char buffer[BLOCK_SIZE];
+};
+
+class image_file_stream : public istream {
+public:
+    image_file_stream(BD_FILE_H *file) : istream(NULL), buf(file) {
+        rdbuf(&buf);
+        if (!file) setstate(ios::failbit);
+    }
+
+private:
+    image_file_buf buf;
+};
+
+unique_ptr<istream> bd_image_open_stream(string path) {
+    BD_FILE_H *file;
+    if (open_image_file(path, &file))
+        return make_unique<image_file_stream>(file);
+
+    return make_unique<ifstream>(path, ios::binary);
+}
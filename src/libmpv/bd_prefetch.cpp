@@ -0,0 +1,237 @@
+#include "bd_prefetch.h"
+
+typedef struct prefetch_entry_t {
+    shared_ptr<const vector<uint8_t>> data;
+    uint64_t last_use;
+} prefetch_entry_t;
+
+typedef struct prefetch_file_t {
+    FILE *fp;
+    int64_t pos;
+    int64_t size;
+    int64_t fp_pos;
+    shared_ptr<const vector<uint8_t>> head;
+} prefetch_file_t;
+
+static string disc_path;
+static map<string, prefetch_entry_t> cache;
+static int64_t cache_size = 0;
+static uint64_t use_counter = 0;
+static deque<string> queue;
+static bool worker_running = false;
+static pthread_t worker_thread;
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+
+static string clip_rel_path(string clip_id) {
+    return "BDMV/STREAM/" + clip_id + ".m2ts";
+}
+
+// Caller holds prefetch_lock.
+static void evict(int64_t needed) {
+    while (cache_size + needed > BD_PREFETCH_CACHE_SIZE && !cache.empty()) {
+        auto oldest = cache.begin();
+        for (auto it = cache.begin(); it != cache.end(); it++)
+            if (it->second.last_use < oldest->second.last_use)
+                oldest = it;
+
+        cache_size -= oldest->second.data->size();
+        cache.erase(oldest);
+    }
+}
+
+static void *prefetch_worker(void *args) {
+    pthread_mutex_lock(&prefetch_lock);
+
+    while (true) {
+        while (queue.empty())
+            pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+
+        string rel_path = queue.front();
+        queue.pop_front();
+        string path = disc_path + "/" + rel_path;
+
+        if (cache.count(rel_path))
+            continue;
+
+        pthread_mutex_unlock(&prefetch_lock);
+
+        shared_ptr<vector<uint8_t>> data = make_shared<vector<uint8_t>>(BD_PREFETCH_SIZE);
+        FILE *fp = fopen(path.c_str(), "rb");
+        size_t len = fp ? fread(data->data(), 1, data->size(), fp) : 0;
+        if (fp) fclose(fp);
+        else fprintf(stderr, "Couldn't prefetch %s\n", path.c_str());
+        data->resize(len);
+
+        pthread_mutex_lock(&prefetch_lock);
+
+        // The disc may have changed while the read was in flight.
+        if (!len || path != disc_path + "/" + rel_path)
+            continue;
+
+        evict(len);
+        cache[rel_path] = { data, ++use_counter };
+        cache_size += len;
+        printf("Prefetched %zu bytes of %s\n", len, rel_path.c_str());
+    }
+
+    return NULL;
+}
+
+void bd_prefetch_set_disc(string path) {
+    pthread_mutex_lock(&prefetch_lock);
+    disc_path = path;
+    cache.clear();
+    queue.clear();
+    cache_size = 0;
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+void bd_prefetch_clip(string clip_id) {
+    string rel_path = clip_rel_path(clip_id);
+
+    pthread_mutex_lock(&prefetch_lock);
+
+    if (disc_path.empty() || cache.count(rel_path) || find(queue.begin(), queue.end(), rel_path) != queue.end()) {
+        pthread_mutex_unlock(&prefetch_lock);
+        return;
+    }
+
+    if (!worker_running) {
+        pthread_create(&worker_thread, NULL, prefetch_worker, NULL);
+        worker_running = true;
+    }
+
+    queue.push_back(rel_path);
+    pthread_cond_signal(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+void bd_prefetch_next(DiscInfo disc, uint32_t playlist_id, uint32_t play_item, vector<uint32_t> playlist_ids) {
+    const bluray_playlist_info_t *playlist = disc.find_playlist(playlist_id);
+    if (playlist && play_item + 1 < playlist->clips.size())
+        bd_prefetch_clip(playlist->clips[play_item + 1].clip_id);
+
+    uint32_t queued = 0;
+    for (uint32_t next_id : playlist_ids) {
+        if (next_id == playlist_id) continue;
+        if (queued++ >= BD_PREFETCH_MAX_PLAYLISTS) break;
+
+        const bluray_playlist_info_t *next = disc.find_playlist(next_id);
+        if (next && !next->clips.empty())
+            bd_prefetch_clip(next->clips[0].clip_id);
+    }
+}
+
+static void file_close(BD_FILE_H *file) {
+    prefetch_file_t *internal = (prefetch_file_t *)file->internal;
+    fclose(internal->fp);
+    delete internal;
+    delete file;
+}
+
+static int64_t file_seek(BD_FILE_H *file, int64_t offset, int32_t origin) {
+    prefetch_file_t *internal = (prefetch_file_t *)file->internal;
+
+    switch (origin) {
+        case SEEK_SET: internal->pos = offset; break;
+        case SEEK_CUR: internal->pos += offset; break;
+        case SEEK_END: internal->pos = internal->size + offset; break;
+        default: return -1;
+    }
+
+    return internal->pos;
+}
+
+static int64_t file_tell(BD_FILE_H *file) {
+    return ((prefetch_file_t *)file->internal)->pos;
+}
+
+static int file_eof(BD_FILE_H *file) {
+    prefetch_file_t *internal = (prefetch_file_t *)file->internal;
+    return internal->pos >= internal->size;
+}
+
+static int64_t file_read(BD_FILE_H *file, uint8_t *buf, int64_t size) {
+    prefetch_file_t *internal = (prefetch_file_t *)file->internal;
+    int64_t total = 0;
+
+    if (internal->head && internal->pos < (int64_t)internal->head->size()) {
+        int64_t len = min(size, (int64_t)internal->head->size() - internal->pos);
+        memcpy(buf, internal->head->data() + internal->pos, len);
+        internal->pos += len;
+        total += len;
+    }
+
+    if (total == size)
+        return total;
+
+    if (internal->fp_pos != internal->pos) {
+        if (fseeko(internal->fp, internal->pos, SEEK_SET) < 0)
+            return total ? total : -1;
+        internal->fp_pos = internal->pos;
+    }
+
+    size_t len = fread(buf + total, 1, size - total, internal->fp);
+    internal->pos += len;
+    internal->fp_pos = internal->pos;
+
+    return total + len;
+}
+
+BD_FILE_H *bd_prefetch_file_open(void *handle, const char *rel_path) {
+    string path = *(string *)handle + "/" + rel_path;
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) return NULL;
+
+    fseeko(fp, 0, SEEK_END);
+    int64_t size = ftello(fp);
+    fseeko(fp, 0, SEEK_SET);
+
+    prefetch_file_t *internal = new prefetch_file_t { fp, 0, size, 0, NULL };
+
+    pthread_mutex_lock(&prefetch_lock);
+    auto it = cache.find(rel_path);
+    if (it != cache.end() && disc_path == *(string *)handle) {
+        internal->head = it->second.data;
+        it->second.last_use = ++use_counter;
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+
+    BD_FILE_H *file = new BD_FILE_H {};
+    file->internal = internal;
+    file->close = file_close;
+    file->seek = file_seek;
+    file->tell = file_tell;
+    file->eof = file_eof;
+    file->read = file_read;
+
+    return file;
+}
+
+static void dir_close(BD_DIR_H *dir) {
+    closedir((DIR *)dir->internal);
+    delete dir;
+}
+
+static int dir_read(BD_DIR_H *dir, BD_DIRENT *entry) {
+    struct dirent *ent = readdir((DIR *)dir->internal);
+    if (!ent) return 1;
+
+    strncpy(entry->d_name, ent->d_name, sizeof(entry->d_name) - 1);
+    entry->d_name[sizeof(entry->d_name) - 1] = 0;
+    return 0;
+}
+
+BD_DIR_H *bd_prefetch_dir_open(void *handle, const char *rel_path) {
+    string path = *(string *)handle + "/" + rel_path;
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return NULL;
+
+    BD_DIR_H *dir_h = new BD_DIR_H {};
+    dir_h->internal = dir;
+    dir_h->close = dir_close;
+    dir_h->read = dir_read;
+
+    return dir_h;
+}
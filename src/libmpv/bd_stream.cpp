@@ -0,0 +1,344 @@
+#include "bd_stream.h"
+
+// Byte range of a clip in the playlist stream and what's added to its
+// timestamps, in 90kHz ticks modulo 2^33.
+typedef struct bd_clip_span_t {
+    uint64_t end;
+    int64_t pts_offset;
+} bd_clip_span_t;
+
+// Serves a whole playlist through libbluray, so clip boundaries are
+// resolved by bd_read and mpv sees a single continuous m2ts stream.
+// buffer[0, ready) is rebased and starts at buffer_pos in the stream,
+// buffer[ready, filled) is a partial packet still waiting for the rest.
+typedef struct bd_stream_t {
+    BLURAY *bd;
+    uint32_t playlist_id;
+    string *disc_path;
+    vector<bd_clip_span_t> clips;
+    vector<uint8_t> buffer;
+    uint64_t buffer_pos;
+    uint32_t ready;
+    uint32_t filled;
+    uint32_t next;
+} bd_stream_t;
+
+typedef chrono::steady_clock::time_point wall_time_t;
+
+static string disc_path;
+static mutex disc_path_lock;
+
+// Play item start times of the playlist opened last, for measuring gaps.
+static uint32_t timed_playlist = 0;
+static vector<double> play_item_starts;
+static bool has_last_time = false;
+static double last_time = 0;
+static wall_time_t last_wall_time;
+static vector<bd_clip_gap_t> gaps;
+static mutex timing_lock;
+
+const uint64_t PTS_MASK = (1ull << 33) - 1;
+
+static uint64_t read_pes_timestamp(const uint8_t *p) {
+    return ((uint64_t)(p[0] >> 1) & 0x07) << 30 | (uint64_t)p[1] << 22
+        | (uint64_t)(p[2] >> 1) << 15 | (uint64_t)p[3] << 7 | p[4] >> 1;
+}
+
+// Keeps the prefix and marker bits around the 33 bit value.
+static void write_pes_timestamp(uint8_t *p, uint64_t value) {
+    p[0] = (p[0] & 0xF1) | ((value >> 29) & 0x0E);
+    p[1] = value >> 22;
+    p[2] = ((value >> 14) & 0xFE) | (p[2] & 0x01);
+    p[3] = value >> 7;
+    p[4] = ((value << 1) & 0xFE) | (p[4] & 0x01);
+}
+
+static void rebase_pes_timestamp(uint8_t *p, int64_t offset) {
+    write_pes_timestamp(p, (read_pes_timestamp(p) + (uint64_t)offset) & PTS_MASK);
+}
+
+// Only the 33 bit base of the PCR is moved; the extension stays.
+static void rebase_pcr(uint8_t *p, int64_t offset) {
+    uint64_t base = (uint64_t)p[0] << 25 | (uint64_t)p[1] << 17 | (uint64_t)p[2] << 9 | (uint64_t)p[3] << 1 | p[4] >> 7;
+    base = (base + (uint64_t)offset) & PTS_MASK;
+
+    p[0] = base >> 25;
+    p[1] = base >> 17;
+    p[2] = base >> 9;
+    p[3] = base >> 1;
+    p[4] = ((base & 0x01) << 7) | (p[4] & 0x7F);
+}
+
+static void rebase_packet(uint8_t *ts, int64_t offset) {
+    if (ts[0] != 0x47)
+        return;
+
+    bool unit_start = ts[1] & 0x40;
+    uint8_t adaptation = (ts[3] >> 4) & 0x03;
+    uint32_t payload = 4;
+
+    if (adaptation & 0x02) {
+        uint8_t length = ts[4];
+        if (length >= 7 && (ts[5] & 0x10))
+            rebase_pcr(ts + 6, offset);
+        payload = 5 + length;
+    }
+
+    // PES headers on BD always fit in the packet that starts them.
+    if (!(adaptation & 0x01) || !unit_start || payload + 19 > 188)
+        return;
+
+    uint8_t *pes = ts + payload;
+    if (pes[0] || pes[1] || pes[2] != 0x01)
+        return;
+
+    switch (pes[3]) {
+        case 0xBC: case 0xBE: case 0xBF: case 0xF0: case 0xF1: case 0xF2: case 0xF8: case 0xFF:
+            return;
+    }
+
+    if ((pes[6] & 0xC0) != 0x80)
+        return;
+
+    uint8_t pts_dts = pes[7] >> 6;
+    if (pts_dts & 0x02)
+        rebase_pes_timestamp(pes + 9, offset);
+    if (pts_dts == 0x03)
+        rebase_pes_timestamp(pes + 14, offset);
+}
+
+// Rebases the whole packets at the front of the buffer.
+static void rebase_buffer(bd_stream_t *stream) {
+    uint64_t pos = stream->buffer_pos;
+    auto clip = upper_bound(stream->clips.begin(), stream->clips.end(), pos, [](uint64_t pos, const bd_clip_span_t &span) {
+        return pos < span.end;
+    });
+
+    for (uint32_t i = 0; i + BD_SOURCE_PACKET <= stream->ready; i += BD_SOURCE_PACKET, pos += BD_SOURCE_PACKET) {
+        while (clip != stream->clips.end() && pos >= clip->end)
+            clip++;
+        if (clip == stream->clips.end())
+            break;
+
+        if (clip->pts_offset)
+            rebase_packet(stream->buffer.data() + i + 4, clip->pts_offset);
+    }
+}
+
+// Moves past what was handed out and reads until there's at least one
+// whole packet. Returns the number of bytes ready, 0 at the end, or -1.
+static int64_t fill_buffer(bd_stream_t *stream) {
+    uint32_t leftover = stream->filled - stream->ready;
+    memmove(stream->buffer.data(), stream->buffer.data() + stream->ready, leftover);
+    stream->buffer_pos += stream->ready;
+    stream->filled = leftover;
+    stream->ready = 0;
+    stream->next = 0;
+
+    while (stream->filled < BD_SOURCE_PACKET) {
+        int len = bd_read(stream->bd, stream->buffer.data() + stream->filled, (int)(stream->buffer.size() - stream->filled));
+        if (len < 0) {
+            fprintf(stderr, "Failed to read playlist %u\n", stream->playlist_id);
+            return -1;
+        }
+        if (len == 0)
+            break;
+        stream->filled += len;
+    }
+
+    // A truncated last packet goes out as it is.
+    stream->ready = stream->filled >= BD_SOURCE_PACKET ? stream->filled - stream->filled % BD_SOURCE_PACKET : stream->filled;
+    rebase_buffer(stream);
+
+    return stream->ready;
+}
+
+static int64_t bd_stream_read(void *cookie, char *buf, uint64_t nbytes) {
+    bd_stream_t *stream = (bd_stream_t *)cookie;
+
+    if (stream->next == stream->ready) {
+        int64_t ready = fill_buffer(stream);
+        if (ready <= 0)
+            return ready;
+    }
+
+    uint32_t len = (uint32_t)min(nbytes, (uint64_t)(stream->ready - stream->next));
+    memcpy(buf, stream->buffer.data() + stream->next, len);
+    stream->next += len;
+
+    return len;
+}
+
+static int64_t bd_stream_seek(void *cookie, int64_t offset) {
+    bd_stream_t *stream = (bd_stream_t *)cookie;
+    uint64_t packet_start = offset - offset % BD_SOURCE_PACKET;
+
+    int64_t pos = bd_seek(stream->bd, packet_start);
+    if (pos < 0 || (uint64_t)pos > packet_start)
+        return MPV_ERROR_GENERIC;
+
+    // bd_seek lands on an aligned unit, so skip ahead to the packet.
+    while ((uint64_t)pos < packet_start) {
+        int len = bd_read(stream->bd, stream->buffer.data(), (int)min<uint64_t>(stream->buffer.size(), packet_start - pos));
+        if (len <= 0)
+            return MPV_ERROR_GENERIC;
+        pos += len;
+    }
+
+    stream->buffer_pos = packet_start;
+    stream->ready = stream->filled = stream->next = 0;
+    if (fill_buffer(stream) < 0)
+        return MPV_ERROR_GENERIC;
+
+    stream->next = min<uint32_t>(offset - packet_start, stream->ready);
+    return offset;
+}
+
+static int64_t bd_stream_size(void *cookie) {
+    bd_stream_t *stream = (bd_stream_t *)cookie;
+    return bd_get_title_size(stream->bd);
+}
+
+static void bd_stream_close(void *cookie) {
+    bd_stream_t *stream = (bd_stream_t *)cookie;
+    bd_image_close(stream->bd);
+    delete stream->disc_path;
+    delete stream;
+}
+
+// Clip byte spans follow libbluray's title layout, pkt_count packets each.
+static vector<bd_clip_span_t> get_clip_spans(BLURAY *bd, uint32_t playlist_id, vector<double> *starts) {
+    vector<bd_clip_span_t> spans;
+    BLURAY_TITLE_INFO *title = bd_get_playlist_info(bd, playlist_id, 0);
+    if (!title)
+        return spans;
+
+    uint64_t end = 0;
+    for (uint32_t i = 0; i < title->clip_count; i++) {
+        const BLURAY_CLIP_INFO &clip = title->clips[i];
+        end += (uint64_t)clip.pkt_count * BD_SOURCE_PACKET;
+        spans.push_back({ end, (int64_t)(clip.start_time + title->clips[0].in_time) - (int64_t)clip.in_time });
+        starts->push_back(clip.start_time / 90000.0);
+    }
+
+    bd_free_title_info(title);
+    return spans;
+}
+
+static int bd_stream_open(void *user_data, char *uri, mpv_stream_cb_info *info) {
+    string uri_str = uri;
+    size_t id_pos = uri_str.find("://");
+    if (id_pos == string::npos)
+        return MPV_ERROR_LOADING_FAILED;
+
+    uint32_t playlist_id = strtoul(uri_str.c_str() + id_pos + 3, NULL, 10);
+
+    string path;
+    {
+        lock_guard<mutex> lock(disc_path_lock);
+        path = disc_path;
+    }
+
+    if (path.empty()) {
+        fprintf(stderr, "No disc opened for %s\n", uri);
+        return MPV_ERROR_LOADING_FAILED;
+    }
+
+    // Each stream gets its own handle so reads never contend with the
+    // handle used for disc info. Files go through the prefetch cache, or
+    // the image's block cache when the disc is an ISO.
+    string *disc_path = NULL;
+    BLURAY *bd = NULL;
+    if (bd_image_is_iso(path)) {
+        bd = bd_image_open(path);
+    } else {
+        disc_path = new string(path);
+        bd = bd_init();
+        if (bd && !bd_open_files(bd, disc_path, bd_prefetch_dir_open, bd_prefetch_file_open)) {
+            bd_close(bd);
+            bd = NULL;
+        }
+    }
+
+    if (!bd) {
+        fprintf(stderr, "Couldn't open disc at %s\n", path.c_str());
+        delete disc_path;
+        return MPV_ERROR_LOADING_FAILED;
+    }
+
+    if (!bd_select_playlist(bd, playlist_id)) {
+        fprintf(stderr, "Couldn't select playlist %u\n", playlist_id);
+        bd_image_close(bd);
+        delete disc_path;
+        return MPV_ERROR_LOADING_FAILED;
+    }
+
+    vector<double> starts;
+    bd_stream_t *stream = new bd_stream_t {
+        bd, playlist_id, disc_path, get_clip_spans(bd, playlist_id, &starts),
+        vector<uint8_t>(BD_STREAM_BUFFER), 0, 0, 0, 0
+    };
+
+    {
+        lock_guard<mutex> lock(timing_lock);
+        timed_playlist = playlist_id;
+        play_item_starts = starts;
+        has_last_time = false;
+    }
+
+    info->cookie = stream;
+    info->read_fn = bd_stream_read;
+    info->seek_fn = bd_stream_seek;
+    info->size_fn = bd_stream_size;
+    info->close_fn = bd_stream_close;
+
+    return 0;
+}
+
+int bd_stream_register(mpv_handle *mpv) {
+    return mpv_stream_cb_add_ro(mpv, BD_STREAM_PROTOCOL, NULL, bd_stream_open);
+}
+
+void bd_stream_set_disc(string path) {
+    lock_guard<mutex> lock(disc_path_lock);
+    disc_path = path;
+}
+
+string bd_stream_uri(uint32_t playlist_id) {
+    return string(BD_STREAM_PROTOCOL) + "://" + to_string(playlist_id);
+}
+
+void bd_stream_on_playback_time(double time) {
+    wall_time_t now = chrono::steady_clock::now();
+    lock_guard<mutex> lock(timing_lock);
+
+    if (has_last_time && time > last_time) {
+        for (uint32_t play_item = 1; play_item < play_item_starts.size(); play_item++) {
+            double start = play_item_starts[play_item];
+            if (last_time >= start || time < start)
+                continue;
+
+            double wall = chrono::duration<double, milli>(now - last_wall_time).count();
+            double gap = max(0.0, wall - (time - last_time) * 1000);
+            gaps.push_back({ timed_playlist, play_item, gap });
+            printf("Play item %u of playlist %u started after a %.1f ms gap\n", play_item, timed_playlist, gap);
+        }
+    }
+
+    has_last_time = true;
+    last_time = time;
+    last_wall_time = now;
+}
+
+void bd_stream_reset_timing() {
+    lock_guard<mutex> lock(timing_lock);
+    has_last_time = false;
+}
+
+vector<bd_clip_gap_t> bd_stream_take_gaps() {
+    lock_guard<mutex> lock(timing_lock);
+    vector<bd_clip_gap_t> taken;
+    taken.swap(gaps);
+
+    return taken;
+}
@@ -0,0 +1,79 @@
+#include "event_ring.h"
+
+static_assert((EVENT_RING_CAPACITY & (EVENT_RING_CAPACITY - 1)) == 0, "EVENT_RING_CAPACITY must be a power of two");
+static_assert(sizeof(event_record_t) == 24, "event_record_t is read by a fixed layout in JS");
+
+alignas(8) static event_record_t records[EVENT_RING_CAPACITY];
+static string strings[EVENT_RING_CAPACITY];
+static atomic<uint32_t> head(0);
+static atomic<uint32_t> tail(0);
+
+static vector<string> property_names;
+static map<string, int32_t> property_ids;
+static pthread_mutex_t property_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int64_t event_ring_push(event_ring_type type, int32_t property, mpv_format format, void *data) {
+    uint32_t write = head.load(memory_order_relaxed);
+    uint32_t waiting = write - tail.load(memory_order_acquire);
+    if (waiting >= EVENT_RING_CAPACITY)
+        return -1;
+
+    uint32_t slot = write & (EVENT_RING_CAPACITY - 1);
+    event_record_t &record = records[slot];
+    record = { (uint32_t)type, property, (uint32_t)format, 0 };
+    record.value.i = 0;
+
+    switch (format) {
+        case MPV_FORMAT_STRING:
+            strings[slot] = *(const char **)data;
+            record.length = strings[slot].size();
+            record.value.str = (uint32_t)(uintptr_t)strings[slot].data();
+            break;
+        case MPV_FORMAT_FLAG:
+            record.value.i = *(int *)data;
+            break;
+        case MPV_FORMAT_INT64:
+            record.value.i = *(int64_t *)data;
+            break;
+        case MPV_FORMAT_DOUBLE:
+            record.value.f = *(double *)data;
+            break;
+        default:
+            break;
+    }
+
+    head.store(write + 1, memory_order_release);
+    return waiting + 1;
+}
+
+int32_t event_ring_property_id(const char *name) {
+    pthread_mutex_lock(&property_lock);
+
+    auto it = property_ids.find(name);
+    int32_t property = it != property_ids.end() ? it->second : (int32_t)property_names.size();
+    if (it == property_ids.end()) {
+        property_ids[name] = property;
+        property_names.push_back(name);
+    }
+
+    pthread_mutex_unlock(&property_lock);
+    return property;
+}
+
+string event_ring_property_name(int32_t property) {
+    pthread_mutex_lock(&property_lock);
+    string name = property >= 0 && property < (int32_t)property_names.size() ? property_names[property] : "";
+    pthread_mutex_unlock(&property_lock);
+
+    return name;
+}
+
+event_ring_info_t event_ring_get_info() {
+    return {
+        (uint32_t)(uintptr_t)records,
+        (uint32_t)(uintptr_t)&head,
+        (uint32_t)(uintptr_t)&tail,
+        EVENT_RING_CAPACITY,
+        sizeof(event_record_t)
+    };
+}
@@ -0,0 +1,70 @@
+#include "frame_stats.h"
+
+static frame_stats_t stats = { 0, 0, 0, vector<uint32_t>(FRAME_STATS_BUCKETS), false, 0, 0, 0, 0, 1 };
+static double last_vsync = 0;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void frame_stats_record(double time) {
+    uint32_t bucket = min((uint32_t)max(time, 0.0), FRAME_STATS_BUCKETS - 1);
+
+    pthread_mutex_lock(&stats_lock);
+    stats.frames++;
+    stats.average_time += (time - stats.average_time) / stats.frames;
+    stats.max_time = max(stats.max_time, time);
+    stats.histogram[bucket]++;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+double frame_stats_vsync(double now) {
+    pthread_mutex_lock(&stats_lock);
+
+    if (last_vsync > 0) {
+        double delta = now - last_vsync;
+
+        if (stats.vsync_interval <= 0)
+            stats.vsync_interval = delta;
+        else if (delta < stats.vsync_interval * FRAME_STATS_LATE_TICK)
+            stats.vsync_interval += (delta - stats.vsync_interval) * FRAME_STATS_VSYNC_SMOOTHING;
+        else
+            stats.missed_frames += (uint32_t)(delta / stats.vsync_interval + 0.5) - 1;
+    }
+
+    last_vsync = now;
+    double interval = stats.vsync_interval;
+    pthread_mutex_unlock(&stats_lock);
+
+    return interval;
+}
+
+void frame_stats_set_display_sync(bool display_sync) {
+    pthread_mutex_lock(&stats_lock);
+    stats.display_sync = display_sync;
+    last_vsync = 0;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void frame_stats_set_render_size(uint32_t width, uint32_t height, double scale) {
+    pthread_mutex_lock(&stats_lock);
+    stats.render_width = width;
+    stats.render_height = height;
+    stats.render_scale = scale;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+frame_stats_t frame_stats_get() {
+    pthread_mutex_lock(&stats_lock);
+    frame_stats_t current = stats;
+    pthread_mutex_unlock(&stats_lock);
+
+    return current;
+}
+
+// The vsync interval and render size are kept, since neither changed.
+void frame_stats_reset() {
+    pthread_mutex_lock(&stats_lock);
+    stats = {
+        0, 0, 0, vector<uint32_t>(FRAME_STATS_BUCKETS), stats.display_sync, stats.vsync_interval, 0,
+        stats.render_width, stats.render_height, stats.render_scale
+    };
+    pthread_mutex_unlock(&stats_lock);
+}
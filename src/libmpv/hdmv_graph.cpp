@@ -0,0 +1,114 @@
+#include "hdmv_graph.h"
+
+static void add_unique(vector<uint32_t> &ids, uint32_t id) {
+    if (find(ids.begin(), ids.end(), id) == ids.end())
+        ids.push_back(id);
+}
+
+// Only immediate operands are followed; register targets depend on
+// runtime state and are left to the VM.
+nav_targets_t decode_nav_targets(const vector<bluray_mobj_cmd_t> &cmds) {
+    nav_targets_t targets;
+
+    for (auto const& cmd : cmds) {
+        if (cmd.insn.grp != INSN_GROUP_BRANCH || !cmd.insn.imm_op1)
+            continue;
+
+        switch (cmd.insn.sub_grp) {
+            case BRANCH_JUMP:
+                switch (cmd.insn.branch_opt) {
+                    case INSN_JUMP_OBJECT:
+                    case INSN_CALL_OBJECT:
+                        add_unique(targets.objects, cmd.dst);
+                        break;
+                    case INSN_JUMP_TITLE:
+                    case INSN_CALL_TITLE:
+                        add_unique(targets.titles, cmd.dst);
+                        break;
+                }
+                break;
+            case BRANCH_PLAY:
+                switch (cmd.insn.branch_opt) {
+                    case INSN_PLAY_PL:
+                    case INSN_PLAY_PL_PI:
+                    case INSN_PLAY_PL_PM:
+                        add_unique(targets.playlists, cmd.dst);
+                        break;
+                }
+                break;
+        }
+    }
+
+    return targets;
+}
+
+static vector<uint32_t> jump_objects(const bluray_disc_info_t &info, const nav_targets_t &targets) {
+    vector<uint32_t> objects = targets.objects;
+
+    for (uint32_t title : targets.titles)
+        if (title < info.title_map.size())
+            add_unique(objects, info.title_map[title]);
+
+    return objects;
+}
+
+// Breadth-first from the given targets, so nearer playlists come first.
+static vector<uint32_t> reachable_playlists(const bluray_disc_info_t &info, const bluray_nav_graph_t &graph, const nav_targets_t &start) {
+    vector<uint32_t> playlists = start.playlists;
+    vector<uint32_t> visited;
+    deque<pair<uint32_t, uint32_t>> queue;
+
+    for (uint32_t object_idx : jump_objects(info, start))
+        queue.push_back({ object_idx, 1 });
+
+    while (!queue.empty()) {
+        auto [object_idx, depth] = queue.front();
+        queue.pop_front();
+
+        if (object_idx >= graph.objects.size() || find(visited.begin(), visited.end(), object_idx) != visited.end())
+            continue;
+        visited.push_back(object_idx);
+
+        const nav_targets_t &targets = graph.objects[object_idx];
+        for (uint32_t playlist_id : targets.playlists)
+            add_unique(playlists, playlist_id);
+
+        if (depth < HDMV_GRAPH_DEPTH)
+            for (uint32_t next_idx : jump_objects(info, targets))
+                queue.push_back({ next_idx, depth + 1 });
+    }
+
+    return playlists;
+}
+
+bluray_nav_graph_t build_nav_graph(const bluray_disc_info_t &info) {
+    bluray_nav_graph_t graph;
+
+    for (auto const& object : info.mobj.objects)
+        graph.objects.push_back(decode_nav_targets(object.cmds));
+
+    for (auto const& object : graph.objects)
+        graph.object_playlists.push_back(reachable_playlists(info, graph, object));
+
+    for (auto const& [playlist_id, playlist] : info.playlists) {
+        vector<vector<uint32_t>> pages;
+
+        for (auto const& page : playlist.igs.menu.pages) {
+            nav_targets_t page_targets;
+
+            for (auto const& [button_id, button] : page.buttons) {
+                nav_targets_t targets = decode_nav_targets(button.commands);
+                for (uint32_t id : targets.objects) add_unique(page_targets.objects, id);
+                for (uint32_t id : targets.titles) add_unique(page_targets.titles, id);
+                for (uint32_t id : targets.playlists) add_unique(page_targets.playlists, id);
+            }
+
+            pages.push_back(reachable_playlists(info, graph, page_targets));
+        }
+
+        if (!pages.empty())
+            graph.page_playlists.insert({ playlist_id, pages });
+    }
+
+    return graph;
+}
@@ -0,0 +1,695 @@
+#include "hdmv_vm.h"
+
+HdmvVm::HdmvVm(DiscInfo disc) : disc(disc) {
+    title = 0;
+    object = 0;
+    object_pc = 0;
+    menu_page = -1;
+    menu_pc = 0;
+    menu_activated = false;
+    menu_initiated = false;
+    resume_info = hdmv_resume_t { false };
+
+    fill(gpr, gpr + HDMV_GPR_COUNT, 0);
+    fill(psr, psr + HDMV_PSR_COUNT, 0);
+
+    psr[PSR_PRIMARY_AUDIO_ID] = 1;
+    psr[PSR_PG_STREAM] = 1;
+    psr[PSR_ANGLE_NUMBER] = 1;
+    psr[PSR_PARENTAL] = 0xFF;
+    psr[PSR_AUDIO_CAP] = 0xFFFF;
+    psr[PSR_AUDIO_LANG] = 0x656E67;
+    psr[PSR_PG_AND_SUB_LANG] = 0x656E67;
+    psr[PSR_MENU_LANG] = 0x656E67;
+    psr[PSR_COUNTRY] = 0x7573;
+    psr[PSR_REGION] = 0x01;
+}
+
+vector<hdmv_action_t> HdmvVm::take_actions() {
+    vector<hdmv_action_t> taken;
+    taken.swap(actions);
+    return taken;
+}
+
+vector<hdmv_action_t> HdmvVm::start() {
+    jump_title(disc.first_play_supported() ? HDMV_FIRST_PLAY : 0);
+    run_object();
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::playlist_end() {
+    run_object();
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::run_command(bluray_mobj_cmd_t cmd, bool menu) {
+    switch (execute(cmd, menu)) {
+        case STEP_NEXT:
+            if (menu) run_menu();
+            break;
+        case STEP_JUMP:
+            run_object();
+            break;
+        default:
+            break;
+    }
+
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::top_menu() {
+    if (!disc.top_menu_supported())
+        return take_actions();
+
+    const bluray_mobj_object_t *current = disc.find_object(object);
+    if (current && current->resume_intention_flag)
+        save_resume(object_pc);
+
+    reset_menu();
+    jump_title(0);
+    run_object();
+
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::resume() {
+    resume_internal();
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::play_mark(uint32_t playlist_id, uint32_t mark_idx) {
+    play_mark_internal(playlist_id, mark_idx, true);
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::popup_on() {
+    if (get_state().has_popup_menu && menu_page < 0)
+        run_menu();
+
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::popup_off() {
+    reset_menu();
+    actions.push_back(hdmv_action_t { HDMV_ACTION_POPUP_OFF });
+
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::select_button(uint16_t button_id) {
+    if (menu_page < 0 || !disc.has_button(psr[PSR_PLAYLIST], menu_page, button_id))
+        return take_actions();
+
+    psr[PSR_SELECTED_BUTTON_ID] = button_id;
+    menu_activated = false;
+    menu_pc = 0;
+    run_menu();
+
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::move_selection(hdmv_direction direction) {
+    const button_t *button = disc.find_button(psr[PSR_PLAYLIST], menu_page, psr[PSR_SELECTED_BUTTON_ID]);
+    if (menu_page < 0 || !button)
+        return take_actions();
+
+    switch (direction) {
+        case HDMV_DIRECTION_UP:
+            return select_button(button->navigation.up);
+        case HDMV_DIRECTION_DOWN:
+            return select_button(button->navigation.down);
+        case HDMV_DIRECTION_LEFT:
+            return select_button(button->navigation.left);
+        case HDMV_DIRECTION_RIGHT:
+            return select_button(button->navigation.right);
+    }
+
+    return take_actions();
+}
+
+vector<hdmv_action_t> HdmvVm::activate_button() {
+    if (menu_page < 0)
+        return take_actions();
+
+    menu_activated = true;
+    menu_pc = 0;
+    run_menu();
+
+    return take_actions();
+}
+
+void HdmvVm::set_playback_position(uint32_t play_item, uint32_t chapter, double time) {
+    psr[PSR_PLAYITEM] = play_item;
+    psr[PSR_CHAPTER] = chapter;
+    psr[PSR_CHAPTER_ALT] = chapter;
+    psr[PSR_TIME] = time * 45000;
+}
+
+void HdmvVm::set_audio_stream(uint32_t stream) {
+    psr[PSR_PRIMARY_AUDIO_ID] = stream;
+}
+
+void HdmvVm::set_pg_stream(uint32_t stream, bool display) {
+    psr[PSR_PG_STREAM] = (stream & 0xFFF) | (display ? 0x80000000 : 0);
+}
+
+uint32_t HdmvVm::get_psr(uint32_t idx) const {
+    return idx < HDMV_PSR_COUNT ? psr[idx] : 0;
+}
+
+uint32_t HdmvVm::get_gpr(uint32_t idx) const {
+    return idx < HDMV_GPR_COUNT ? gpr[idx] : 0;
+}
+
+hdmv_state_t HdmvVm::get_state() const {
+    const bluray_mobj_object_t *current = disc.find_object(object);
+
+    return hdmv_state_t {
+        title,
+        object,
+        object_pc,
+        psr[PSR_PLAYLIST],
+        psr[PSR_PLAYITEM],
+        menu_page,
+        static_cast<uint16_t>(psr[PSR_SELECTED_BUTTON_ID]),
+        menu_activated,
+        current && !current->menu_call_mask,
+        title != 0 && title != HDMV_FIRST_PLAY && disc.get_menu_info(psr[PSR_PLAYLIST]).page_count > 0,
+        resume_info.valid
+    };
+}
+
+vector<uint16_t> HdmvVm::get_button_state() const {
+    return button_state;
+}
+
+// Playlists the current object or menu page can reach, nearest first.
+vector<uint32_t> HdmvVm::get_likely_playlists() const {
+    return disc.get_likely_playlists(object, psr[PSR_PLAYLIST], menu_page);
+}
+
+void HdmvVm::run_object() {
+    for (uint32_t step = 0; step < HDMV_MAX_STEPS; step++) {
+        const bluray_mobj_object_t *current = disc.find_object(object);
+        if (!current) {
+            fprintf(stderr, "Movie object %u not found\n", object);
+            return;
+        }
+
+        if (object_pc >= current->cmds.size()) {
+            printf("End of object commands\n");
+            return;
+        }
+
+        switch (execute(current->cmds[object_pc], false)) {
+            case STEP_NEXT:
+            case STEP_JUMP:
+                continue;
+            case STEP_PLAY:
+                if (title == 0 && !menu_initiated) {
+                    menu_initiated = true;
+                    run_menu();
+                } else if (title != 0) {
+                    menu_initiated = false;
+                }
+                return;
+            case STEP_BREAK:
+                return;
+        }
+    }
+
+    fprintf(stderr, "Movie object %u exceeded %u steps\n", object, HDMV_MAX_STEPS);
+}
+
+void HdmvVm::run_menu() {
+    if (menu_page < 0) {
+        const page_t *page = disc.find_page(psr[PSR_PLAYLIST], 0);
+        if (!page) return;
+
+        init_menu_page(0, page->def_button);
+        actions.push_back(hdmv_action_t { .type = HDMV_ACTION_MENU_PAGE, .page = 0, .button = page->def_button });
+    }
+
+    for (uint32_t step = 0; step < HDMV_MAX_STEPS; step++) {
+        const button_t *button = disc.find_button(psr[PSR_PLAYLIST], menu_page, psr[PSR_SELECTED_BUTTON_ID]);
+        if (!button || !(button->auto_action || menu_activated))
+            return;
+
+        if (menu_pc >= button->commands.size()) {
+            menu_activated = false;
+            menu_pc = 0;
+            return;
+        }
+
+        switch (execute(button->commands[menu_pc], true)) {
+            case STEP_NEXT:
+                continue;
+            case STEP_JUMP:
+                run_object();
+                return;
+            case STEP_PLAY:
+            case STEP_BREAK:
+                return;
+        }
+    }
+
+    fprintf(stderr, "Button %u exceeded %u steps\n", psr[PSR_SELECTED_BUTTON_ID], HDMV_MAX_STEPS);
+}
+
+void HdmvVm::advance(bool menu) {
+    if (menu) menu_pc++;
+    else object_pc++;
+}
+
+uint32_t HdmvVm::read_reg(uint32_t reg) const {
+    if (reg & 0x80000000)
+        return psr[reg & 0x7F];
+
+    return gpr[reg & 0xFFF];
+}
+
+void HdmvVm::write_reg(uint32_t reg, uint32_t value) {
+    if (!(reg & 0x80000000)) {
+        gpr[reg & 0xFFF] = value;
+        return;
+    }
+
+    reg &= 0x7F;
+    psr[reg] = value;
+
+    switch (reg) {
+        case PSR_PRIMARY_AUDIO_ID:
+            actions.push_back(hdmv_action_t { .type = HDMV_ACTION_SET_STREAM, .audio_flag = 1, .audio_stream = value });
+            break;
+        case PSR_PG_STREAM:
+            actions.push_back(hdmv_action_t {
+                .type = HDMV_ACTION_SET_STREAM,
+                .pg_flag = 1,
+                .pg_display = static_cast<uint8_t>(value >> 31),
+                .pg_stream = value & 0xFFF
+            });
+            break;
+        case PSR_TITLE_NUMBER_ALT:
+            psr[PSR_TITLE_NUMBER] = value;
+            break;
+        case PSR_CHAPTER_ALT:
+            psr[PSR_CHAPTER] = value;
+            break;
+        default:
+            break;
+    }
+}
+
+void HdmvVm::jump_title(uint32_t new_title) {
+    title = new_title;
+    psr[PSR_TITLE_NUMBER] = new_title;
+    psr[PSR_TITLE_NUMBER_ALT] = new_title;
+    jump_object(disc.get_title_object(new_title));
+}
+
+void HdmvVm::jump_object(uint32_t new_object) {
+    object = new_object;
+    object_pc = 0;
+}
+
+void HdmvVm::save_resume(uint32_t pc) {
+    resume_info = hdmv_resume_t {
+        true,
+        title,
+        object,
+        pc,
+        psr[PSR_PLAYLIST],
+        psr[PSR_PLAYITEM],
+        psr[PSR_TIME]
+    };
+}
+
+HdmvVm::step_result HdmvVm::play(uint32_t playlist_id, uint32_t play_item, double start, bool menu) {
+    if (!disc.has_playlist(playlist_id)) {
+        fprintf(stderr, "Playlist %u not found\n", playlist_id);
+        return STEP_BREAK;
+    }
+
+    psr[PSR_PLAYLIST] = playlist_id;
+    psr[PSR_PLAYITEM] = play_item;
+    psr[PSR_TIME] = start * 45000;
+
+    actions.push_back(hdmv_action_t {
+        .type = HDMV_ACTION_PLAY_PL,
+        .playlist = playlist_id,
+        .play_item = play_item,
+        .start = start
+    });
+
+    if (menu) reset_menu();
+    else object_pc++;
+
+    return STEP_PLAY;
+}
+
+HdmvVm::step_result HdmvVm::play_mark_internal(uint32_t playlist_id, uint32_t mark_idx, bool menu) {
+    if (mark_idx >= disc.get_mark_count(playlist_id)) {
+        fprintf(stderr, "Play mark %u not found in playlist %u\n", mark_idx, playlist_id);
+        return STEP_BREAK;
+    }
+
+    BLURAY_TITLE_MARK mark = disc.get_mark(playlist_id, mark_idx);
+    const bluray_playlist_info_t *playlist = disc.find_playlist(playlist_id);
+
+    uint64_t duration = 0;
+    for (uint32_t clip_idx = 0; clip_idx < mark.clip_ref && clip_idx < playlist->clips.size(); clip_idx++)
+        duration += playlist->clips[clip_idx].out_time - playlist->clips[clip_idx].in_time;
+
+    return play(playlist_id, mark.clip_ref, (double)(mark.start - duration) / 90000, menu);
+}
+
+HdmvVm::step_result HdmvVm::resume_internal() {
+    if (!resume_info.valid) {
+        fprintf(stderr, "No resume info found\n");
+        return STEP_BREAK;
+    }
+
+    hdmv_resume_t info = resume_info;
+    resume_info.valid = false;
+
+    reset_menu();
+    menu_initiated = false;
+
+    title = info.title;
+    psr[PSR_TITLE_NUMBER] = info.title;
+    psr[PSR_TITLE_NUMBER_ALT] = info.title;
+    object = info.object;
+    object_pc = info.object_pc;
+
+    play(info.playlist, info.play_item, (double)info.time / 45000, true);
+    return STEP_BREAK;
+}
+
+void HdmvVm::reset_menu() {
+    menu_page = -1;
+    menu_pc = 0;
+    menu_activated = false;
+    psr[PSR_SELECTED_BUTTON_ID] = 0;
+    psr[PSR_MENU_PAGE_ID] = 0;
+    button_state.clear();
+}
+
+void HdmvVm::init_menu_page(uint32_t page_id, uint16_t selected) {
+    menu_page = page_id;
+    menu_pc = 0;
+    menu_activated = false;
+    button_state = disc.get_page_default_buttons(psr[PSR_PLAYLIST], page_id);
+
+    if (selected == HDMV_NO_BUTTON && !button_state.empty())
+        selected = button_state[0];
+
+    psr[PSR_MENU_PAGE_ID] = page_id;
+    psr[PSR_SELECTED_BUTTON_ID] = selected;
+}
+
+void HdmvVm::set_stream(const bluray_mobj_cmd_t &cmd) {
+    uint8_t audio_flag = (cmd.dst & 0x80000000) >> 31;
+    uint8_t pg_flag = (cmd.dst & 0x8000) >> 15;
+    uint8_t display_flag = (cmd.dst & 0x4000) >> 14;
+
+    uint32_t audio_stream = (cmd.dst >> 16) & 0xFFF;
+    uint32_t pg_stream = cmd.dst & 0xFFF;
+
+    if (!cmd.insn.imm_op1) {
+        audio_stream = read_reg(audio_stream);
+        pg_stream = read_reg(pg_stream);
+    }
+
+    if (audio_flag)
+        psr[PSR_PRIMARY_AUDIO_ID] = audio_stream;
+    if (pg_flag)
+        psr[PSR_PG_STREAM] = (pg_stream & 0xFFF) | (display_flag ? 0x80000000 : 0);
+
+    if (audio_flag || pg_flag) {
+        actions.push_back(hdmv_action_t {
+            .type = HDMV_ACTION_SET_STREAM,
+            .audio_flag = audio_flag,
+            .audio_stream = audio_stream,
+            .pg_flag = pg_flag,
+            .pg_display = display_flag,
+            .pg_stream = pg_stream & 0xFFF
+        });
+    }
+}
+
+bool HdmvVm::set_button_page(const bluray_mobj_cmd_t &cmd) {
+    if (menu_page < 0)
+        return false;
+
+    uint8_t button_flag = (cmd.dst & 0x80000000) >> 31;
+    uint8_t page_flag = (cmd.src & 0x80000000) >> 31;
+
+    uint16_t button_id = cmd.insn.imm_op1 ? cmd.dst & 0xFFFF : read_reg(cmd.dst & 0xFFFF) & 0xFFFF;
+    uint8_t page_id = cmd.insn.imm_op2 ? cmd.src & 0xFF : read_reg(cmd.src & 0xFF) & 0xFF;
+
+    uint32_t delay = 0;
+
+    if (page_flag && page_id != menu_page) {
+        const page_t *page = disc.find_page(psr[PSR_PLAYLIST], page_id);
+        if (!page) {
+            fprintf(stderr, "Menu page %u not found\n", page_id);
+            return false;
+        }
+
+        delay = disc.get_page(psr[PSR_PLAYLIST], page_id).in_effects_duration / 90;
+        init_menu_page(page_id, button_flag ? button_id : page->def_button);
+    } else if (button_flag) {
+        int bog_idx = disc.get_button_group(psr[PSR_PLAYLIST], menu_page, button_id);
+        if (bog_idx >= 0) button_state[bog_idx] = button_id;
+
+        psr[PSR_SELECTED_BUTTON_ID] = button_id;
+    }
+
+    menu_activated = false;
+    menu_pc = 0;
+
+    actions.push_back(hdmv_action_t {
+        .type = HDMV_ACTION_MENU_PAGE,
+        .page = menu_page,
+        .button = static_cast<uint16_t>(psr[PSR_SELECTED_BUTTON_ID]),
+        .delay = delay
+    });
+
+    return true;
+}
+
+void HdmvVm::enable_button(uint16_t button_id, bool enable) {
+    int bog_idx = disc.get_button_group(psr[PSR_PLAYLIST], menu_page, button_id);
+    if (bog_idx < 0 || (size_t)bog_idx >= button_state.size())
+        return;
+
+    if (enable)
+        button_state[bog_idx] = button_id;
+    else if (button_state[bog_idx] == button_id)
+        button_state[bog_idx] = HDMV_NO_BUTTON;
+
+    actions.push_back(hdmv_action_t { .type = HDMV_ACTION_BUTTON_STATE, .page = menu_page, .button = button_id });
+}
+
+HdmvVm::step_result HdmvVm::execute(const bluray_mobj_cmd_t &cmd, bool menu) {
+    uint32_t dst = cmd.insn.imm_op1 ? cmd.dst : read_reg(cmd.dst);
+    uint32_t src = cmd.insn.imm_op2 ? cmd.src : read_reg(cmd.src);
+
+    switch (cmd.insn.grp) {
+        case INSN_GROUP_BRANCH:
+            switch (cmd.insn.sub_grp) {
+                case BRANCH_GOTO:
+                    switch (cmd.insn.branch_opt) {
+                        case INSN_NOP:
+                            advance(menu);
+                            return STEP_NEXT;
+                        case INSN_GOTO:
+                            if (menu) menu_pc = dst;
+                            else object_pc = dst;
+                            return STEP_NEXT;
+                        case INSN_BREAK:
+                            if (menu) {
+                                menu_pc = 0;
+                                menu_activated = false;
+                            } else object_pc++;
+                            return STEP_BREAK;
+                        default:
+                            fprintf(stderr, "Unknown BRANCH_GOTO: %x\n", cmd.insn.branch_opt);
+                    }
+                    return STEP_BREAK;
+                case BRANCH_JUMP:
+                    switch (cmd.insn.branch_opt) {
+                        case INSN_CALL_OBJECT:
+                        case INSN_CALL_TITLE:
+                            save_resume(menu ? object_pc : object_pc + 1);
+                            if (cmd.insn.branch_opt == INSN_CALL_OBJECT)
+                                jump_object(dst);
+                            else
+                                jump_title(dst);
+                            reset_menu();
+                            menu_initiated = false;
+                            return STEP_JUMP;
+                        case INSN_JUMP_OBJECT:
+                            jump_object(dst);
+                            reset_menu();
+                            menu_initiated = false;
+                            return STEP_JUMP;
+                        case INSN_JUMP_TITLE:
+                            jump_title(dst);
+                            reset_menu();
+                            menu_initiated = false;
+                            return STEP_JUMP;
+                        case INSN_RESUME:
+                            return resume_internal();
+                        default:
+                            fprintf(stderr, "Unknown BRANCH_JUMP: %x\n", cmd.insn.branch_opt);
+                    }
+                    return STEP_BREAK;
+                case BRANCH_PLAY:
+                    switch (cmd.insn.branch_opt) {
+                        case INSN_PLAY_PL:
+                            return play(dst, 0, 0, menu);
+                        case INSN_PLAY_PL_PI:
+                            return play(dst, src, 0, menu);
+                        case INSN_PLAY_PL_PM:
+                            return play_mark_internal(dst, src, menu);
+                        case INSN_TERMINATE_PL:
+                            actions.push_back(hdmv_action_t { HDMV_ACTION_STOP });
+                            advance(menu);
+                            return STEP_BREAK;
+                        case INSN_LINK_PI:
+                            return play(psr[PSR_PLAYLIST], dst, 0, menu);
+                        case INSN_LINK_MK:
+                            return play_mark_internal(psr[PSR_PLAYLIST], dst, menu);
+                        default:
+                            fprintf(stderr, "Unknown BRANCH_PLAY: %x\n", cmd.insn.branch_opt);
+                    }
+                    return STEP_BREAK;
+                default:
+                    fprintf(stderr, "Unknown HDMV_INSN_GRP_BRANCH: %x\n", cmd.insn.sub_grp);
+            }
+            return STEP_BREAK;
+        case INSN_GROUP_CMP: {
+            bool result;
+            switch (cmd.insn.cmp_opt) {
+                case INSN_BC: result = !(dst & ~src); break;
+                case INSN_EQ: result = dst == src; break;
+                case INSN_NE: result = dst != src; break;
+                case INSN_GE: result = dst >= src; break;
+                case INSN_GT: result = dst > src; break;
+                case INSN_LE: result = dst <= src; break;
+                case INSN_LT: result = dst < src; break;
+                default:
+                    fprintf(stderr, "Unknown HDMV_INSN_CMP: %x\n", cmd.insn.cmp_opt);
+                    return STEP_BREAK;
+            }
+
+            if (menu) menu_pc += result ? 1 : 2;
+            else object_pc += result ? 1 : 2;
+            return STEP_NEXT;
+        }
+        case INSN_GROUP_SET:
+            switch (cmd.insn.sub_grp) {
+                case SET_SET: {
+                    uint32_t dst_val = read_reg(cmd.dst);
+
+                    switch (cmd.insn.set_opt) {
+                        case INSN_MOVE:
+                            write_reg(cmd.dst, src);
+                            break;
+                        case INSN_SWAP:
+                            write_reg(cmd.dst, src);
+                            write_reg(cmd.src, dst_val);
+                            break;
+                        case INSN_ADD:
+                            write_reg(cmd.dst, (uint64_t)dst_val + src > 0xFFFFFFFF ? 0xFFFFFFFF : dst_val + src);
+                            break;
+                        case INSN_SUB:
+                            write_reg(cmd.dst, dst_val > src ? dst_val - src : 0);
+                            break;
+                        case INSN_MUL:
+                            write_reg(cmd.dst, dst_val * src);
+                            break;
+                        case INSN_DIV:
+                            if (src) write_reg(cmd.dst, dst_val / src);
+                            break;
+                        case INSN_MOD:
+                            if (src) write_reg(cmd.dst, dst_val % src);
+                            break;
+                        case INSN_RND:
+                            write_reg(cmd.dst, src ? rand() % src + 1 : 1);
+                            break;
+                        case INSN_AND:
+                            write_reg(cmd.dst, dst_val & src);
+                            break;
+                        case INSN_OR:
+                            write_reg(cmd.dst, dst_val | src);
+                            break;
+                        case INSN_XOR:
+                            write_reg(cmd.dst, dst_val ^ src);
+                            break;
+                        case INSN_BITSET:
+                            write_reg(cmd.dst, dst_val | (1u << (src & 31)));
+                            break;
+                        case INSN_BITCLR:
+                            write_reg(cmd.dst, dst_val & ~(1u << (src & 31)));
+                            break;
+                        case INSN_SHL:
+                            write_reg(cmd.dst, src < 32 ? dst_val << src : 0);
+                            break;
+                        case INSN_SHR:
+                            write_reg(cmd.dst, src < 32 ? dst_val >> src : 0);
+                            break;
+                        default:
+                            fprintf(stderr, "Unknown HDMV_INSN_SET: %x\n", cmd.insn.set_opt);
+                            return STEP_BREAK;
+                    }
+
+                    advance(menu);
+                    return STEP_NEXT;
+                }
+                case SET_SETSYSTEM:
+                    switch (cmd.insn.set_opt) {
+                        case INSN_SET_STREAM:
+                            set_stream(cmd);
+                            advance(menu);
+                            return STEP_NEXT;
+                        case INSN_SET_BUTTON_PAGE:
+                            // Only button programs can change the page.
+                            if (!menu)
+                                return STEP_BREAK;
+                            if (!set_button_page(cmd))
+                                advance(menu);
+                            return STEP_NEXT;
+                        case INSN_ENABLE_BUTTON:
+                        case INSN_DISABLE_BUTTON:
+                            enable_button(dst & 0xFFFF, cmd.insn.set_opt == INSN_ENABLE_BUTTON);
+                            advance(menu);
+                            return STEP_NEXT;
+                        case INSN_POPUP_OFF:
+                            reset_menu();
+                            actions.push_back(hdmv_action_t { HDMV_ACTION_POPUP_OFF });
+                            return STEP_BREAK;
+                        case INSN_SET_NV_TIMER:
+                        case INSN_SET_SEC_STREAM:
+                        case INSN_STILL_ON:
+                        case INSN_STILL_OFF:
+                        case INSN_SET_OUTPUT_MODE:
+                        case INSN_SET_STREAM_SS:
+                        case INSN_SETSYSTEM_0x10:
+                            fprintf(stderr, "Unsupported SET_SETSYSTEM: %x\n", cmd.insn.set_opt);
+                            return STEP_BREAK;
+                        default:
+                            fprintf(stderr, "Unknown SET_SETSYSTEM: %x\n", cmd.insn.set_opt);
+                    }
+                    return STEP_BREAK;
+                default:
+                    fprintf(stderr, "Unknown HDMV_INSN_GRP_SET: %x\n", cmd.insn.sub_grp);
+            }
+            return STEP_BREAK;
+        default:
+            fprintf(stderr, "Unknown instruction group: %x\n", cmd.insn.grp);
+    }
+
+    return STEP_BREAK;
+}
@@ -360,9 +360,7 @@ string get_button_picture_base64(vector<color_t> palette, picture_t picture) {
     return base64_encode(buffer.data(), buffer.size());
 }
 
-igs_t extract_menu(char const *filename) {
-    ifstream stream(filename, ios::binary);
-
+igs_t extract_menu(istream &stream) {
     vector<uint8_t> packet(PACKET_SIZE - 1);
     int count = 0; 
     int skipped_bytes = 0;
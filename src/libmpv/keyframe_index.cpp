@@ -0,0 +1,354 @@
+#include "keyframe_index.h"
+
+static const char KEYFRAME_INDEX_MAGIC[4] = { 'K', 'F', 'I', '1' };
+
+static string index_dir;
+static map<string, shared_ptr<const keyframe_index_t>> memory;
+static deque<string> remembered;
+static deque<string> queue;
+static set<string> queued;
+static bool worker_running = false;
+static pthread_t worker_thread;
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+// Entries are stored as zigzag varint deltas from the previous one, which
+// takes a few bytes per keyframe instead of sixteen.
+static void write_varint(string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+static void write_signed(string &out, int64_t value) {
+    write_varint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static bool read_varint(const string &in, size_t &at, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && at < in.size(); shift += 7) {
+        uint8_t byte = in[at++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static bool read_signed(const string &in, size_t &at, int64_t *value) {
+    uint64_t raw;
+    if (!read_varint(in, at, &raw))
+        return false;
+    *value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
+static string get_index_path(string dir, string path) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016zx.kfi", hash<string>()(path));
+    return dir + "/" + name;
+}
+
+static bool stat_file(string path, int64_t *size, int64_t *mtime) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+
+    *size = info.st_size;
+    *mtime = info.st_mtime;
+    return true;
+}
+
+static string encode_index(string path, const keyframe_index_t &index) {
+    string out(KEYFRAME_INDEX_MAGIC, sizeof(KEYFRAME_INDEX_MAGIC));
+    write_varint(out, path.size());
+    out += path;
+    write_signed(out, index.size);
+    write_signed(out, index.mtime);
+    write_varint(out, index.stream_index);
+    write_signed(out, index.time_base.num);
+    write_signed(out, index.time_base.den);
+    write_signed(out, index.start_time);
+    write_varint(out, index.pts.size());
+
+    int64_t last_pts = 0, last_pos = 0;
+    for (size_t i = 0; i < index.pts.size(); i++) {
+        write_signed(out, index.pts[i] - last_pts);
+        write_signed(out, index.pos[i] - last_pos);
+        last_pts = index.pts[i];
+        last_pos = index.pos[i];
+    }
+
+    return out;
+}
+
+static bool decode_index(const string &in, string path, keyframe_index_t *index) {
+    if (in.compare(0, sizeof(KEYFRAME_INDEX_MAGIC), KEYFRAME_INDEX_MAGIC, sizeof(KEYFRAME_INDEX_MAGIC)) != 0)
+        return false;
+
+    size_t at = sizeof(KEYFRAME_INDEX_MAGIC);
+    uint64_t path_size, stream_index, count;
+    int64_t num, den;
+
+    // The name is only a hash, so the stored path settles collisions.
+    if (!read_varint(in, at, &path_size) || path_size > in.size() - at || in.compare(at, path_size, path) != 0)
+        return false;
+    at += path_size;
+
+    if (!read_signed(in, at, &index->size)
+        || !read_signed(in, at, &index->mtime)
+        || !read_varint(in, at, &stream_index)
+        || !read_signed(in, at, &num)
+        || !read_signed(in, at, &den)
+        || !read_signed(in, at, &index->start_time)
+        || !read_varint(in, at, &count)
+        || count > in.size() - at
+    )
+        return false;
+
+    index->stream_index = (int)stream_index;
+    index->time_base = { (int)num, (int)den };
+    index->pts.resize(count);
+    index->pos.resize(count);
+
+    int64_t pts = 0, pos = 0, delta;
+    for (uint64_t i = 0; i < count; i++) {
+        if (!read_signed(in, at, &delta)) return false;
+        index->pts[i] = pts += delta;
+        if (!read_signed(in, at, &delta)) return false;
+        index->pos[i] = pos += delta;
+    }
+
+    return true;
+}
+
+static shared_ptr<const keyframe_index_t> load_index(string dir, string path) {
+    ifstream file(get_index_path(dir, path), ios::binary);
+    if (!file)
+        return NULL;
+
+    string in((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    shared_ptr<keyframe_index_t> index = make_shared<keyframe_index_t>();
+    if (!decode_index(in, path, index.get()))
+        return NULL;
+
+    return index;
+}
+
+// Written to a temporary file first so readers never see half an index.
+static void save_index(string dir, string path, const keyframe_index_t &index) {
+    error_code err;
+    filesystem::create_directories(dir, err);
+
+    string index_path = get_index_path(dir, path);
+    string temp_path = index_path + ".tmp";
+    string out = encode_index(path, index);
+
+    ofstream file(temp_path, ios::binary | ios::trunc);
+    if (!file || !file.write(out.data(), out.size())) {
+        fprintf(stderr, "Couldn't write keyframe index to %s\n", temp_path.c_str());
+        return;
+    }
+    file.close();
+
+    filesystem::rename(temp_path, index_path, err);
+    if (err)
+        fprintf(stderr, "Couldn't write keyframe index to %s: %s\n", index_path.c_str(), err.message().c_str());
+}
+
+// Only the video stream is demuxed, and no packet reaches a decoder.
+static bool build_index(string path, keyframe_index_t *index) {
+    if (!stat_file(path, &index->size, &index->mtime))
+        return false;
+
+    AVFormatContext *format = NULL;
+    if (avformat_open_input(&format, path.c_str(), NULL, NULL) < 0) {
+        fprintf(stderr, "Couldn't open %s to index it\n", path.c_str());
+        return false;
+    }
+
+    int stream_index = format && avformat_find_stream_info(format, NULL) >= 0
+        ? av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0)
+        : -1;
+    if (stream_index < 0) {
+        avformat_close_input(&format);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < format->nb_streams; i++)
+        if ((int)i != stream_index)
+            format->streams[i]->discard = AVDISCARD_ALL;
+
+    AVStream *stream = format->streams[stream_index];
+    index->stream_index = stream_index;
+    index->time_base = stream->time_base;
+    index->start_time = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+    vector<pair<int64_t, int64_t>> keyframes;
+    AVPacket *packet = av_packet_alloc();
+
+    while (av_read_frame(format, packet) >= 0) {
+        int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        if (packet->stream_index == stream_index && (packet->flags & AV_PKT_FLAG_KEY) && pts != AV_NOPTS_VALUE && packet->pos >= 0)
+            keyframes.push_back({ pts, packet->pos });
+        av_packet_unref(packet);
+    }
+
+    av_packet_free(&packet);
+    avformat_close_input(&format);
+
+    sort(keyframes.begin(), keyframes.end());
+    for (const auto &[pts, pos] : keyframes) {
+        index->pts.push_back(pts);
+        index->pos.push_back(pos);
+    }
+
+    return !keyframes.empty();
+}
+
+// Caller holds index_lock.
+static void remember(string path, shared_ptr<const keyframe_index_t> index) {
+    if (!memory.count(path))
+        remembered.push_back(path);
+    memory[path] = index;
+
+    while (remembered.size() > KEYFRAME_INDEX_MEMORY) {
+        memory.erase(remembered.front());
+        remembered.pop_front();
+    }
+}
+
+static void *index_worker(void *args) {
+    pthread_mutex_lock(&index_lock);
+
+    while (true) {
+        while (queue.empty())
+            pthread_cond_wait(&queue_cond, &index_lock);
+
+        string path = queue.front();
+        queue.pop_front();
+        string dir = index_dir;
+        pthread_mutex_unlock(&index_lock);
+
+        shared_ptr<keyframe_index_t> index;
+        if (!keyframe_index_get(path)) {
+            index = make_shared<keyframe_index_t>();
+            if (build_index(path, index.get())) {
+                save_index(dir, path, *index);
+                printf("Indexed %zu keyframes in %s\n", index->pts.size(), path.c_str());
+            } else {
+                index = NULL;
+            }
+        }
+
+        pthread_mutex_lock(&index_lock);
+        if (index)
+            remember(path, index);
+        queued.erase(path);
+    }
+
+    return NULL;
+}
+
+void keyframe_index_set_dir(string dir) {
+    pthread_mutex_lock(&index_lock);
+    index_dir = dir;
+    pthread_mutex_unlock(&index_lock);
+}
+
+void keyframe_index_request(string path) {
+    if (path.empty() || path.find("://") != string::npos)
+        return;
+
+    pthread_mutex_lock(&index_lock);
+
+    if (!index_dir.empty() && !queued.count(path)) {
+        if (!worker_running) {
+            pthread_create(&worker_thread, NULL, index_worker, NULL);
+            worker_running = true;
+        }
+
+        queued.insert(path);
+        queue.push_back(path);
+        pthread_cond_signal(&queue_cond);
+    }
+
+    pthread_mutex_unlock(&index_lock);
+}
+
+shared_ptr<const keyframe_index_t> keyframe_index_get(string path) {
+    int64_t size, mtime;
+    if (!stat_file(path, &size, &mtime))
+        return NULL;
+
+    pthread_mutex_lock(&index_lock);
+    string dir = index_dir;
+    auto it = memory.find(path);
+    shared_ptr<const keyframe_index_t> index = it != memory.end() ? it->second : NULL;
+    pthread_mutex_unlock(&index_lock);
+
+    if (!index && !dir.empty()) {
+        index = load_index(dir, path);
+        if (index) {
+            pthread_mutex_lock(&index_lock);
+            remember(path, index);
+            pthread_mutex_unlock(&index_lock);
+        }
+    }
+
+    if (!index || index->size != size || index->mtime != mtime)
+        return NULL;
+
+    return index;
+}
+
+// Position of the last keyframe at or before timestamp, or the first one.
+static size_t find_before(const keyframe_index_t &index, int64_t timestamp) {
+    auto it = upper_bound(index.pts.begin(), index.pts.end(), timestamp);
+    return it == index.pts.begin() ? 0 : it - index.pts.begin() - 1;
+}
+
+static int64_t to_timestamp(const keyframe_index_t &index, double time) {
+    return av_rescale_q((int64_t)(time * AV_TIME_BASE), AV_TIME_BASE_Q, index.time_base) + index.start_time;
+}
+
+bool keyframe_index_find(string path, double time, bool before, double *keyframe_time) {
+    shared_ptr<const keyframe_index_t> index = keyframe_index_get(path);
+    if (!index || index->pts.empty())
+        return false;
+
+    int64_t timestamp = to_timestamp(*index, time);
+    size_t i = find_before(*index, timestamp);
+    if (!before && i + 1 < index->pts.size() && index->pts[i + 1] - timestamp < timestamp - index->pts[i])
+        i++;
+
+    *keyframe_time = (index->pts[i] - index->start_time) * av_q2d(index->time_base);
+    return true;
+}
+
+bool keyframe_index_seek(AVFormatContext *format, int stream_index, double time) {
+    if (!format->url)
+        return false;
+
+    shared_ptr<const keyframe_index_t> index = keyframe_index_get(format->url);
+    if (!index || index->pts.empty() || index->stream_index != stream_index)
+        return false;
+
+    AVStream *stream = format->streams[stream_index];
+    if (av_cmp_q(stream->time_base, index->time_base) != 0)
+        return false;
+
+    size_t i = find_before(*index, to_timestamp(*index, time));
+
+    // MPEG TS and PS resync on the next packet header, so they can jump
+    // straight to the keyframe's offset. Other demuxers (Matroska, AVI)
+    // keep parse state that a raw byte seek would leave wrong, so they get
+    // the keyframe's exact timestamp as the upper bound instead.
+    const char *name = format->iformat->name;
+    if (strcmp(name, "mpegts") == 0 || strcmp(name, "mpeg") == 0)
+        return av_seek_frame(format, stream_index, index->pos[i], AVSEEK_FLAG_BYTE) >= 0;
+
+    return avformat_seek_file(format, stream_index, INT64_MIN, index->pts[i], index->pts[i], 0) >= 0;
+}
@@ -1,7 +1,11 @@
 #include "libbluray.h"
+#include "hdmv_graph.h"
 
 BLURAY* bd = NULL;
 
+static map<string, map<uint32_t, string>> menu_backgrounds;
+static pthread_mutex_t menu_backgrounds_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static bluray_mobj_objects_t read_mobj(string path) {
     mobj_objects* mobj_objects = bd_read_mobj(path.c_str());
     vector<bluray_mobj_object_t> objects(mobj_objects->num_objects);
@@ -46,6 +50,34 @@ static bluray_mobj_objects_t read_mobj(string path) {
     };
 }
 
+// First keyframe of the menu's background video, which is usually muxed
+// with the IGS stream and otherwise sits in the playlist's first clip.
+static string get_menu_background(string path, vector<string> clip_ids) {
+    for (const string &clip_id : clip_ids) {
+        string clip_path = path + "/BDMV/STREAM/" + clip_id + ".m2ts";
+        video_decoder_t decoder;
+        if (!open_video_decoder_stream(&decoder, bd_image_open_stream(clip_path), clip_path.c_str()))
+            continue;
+
+        if (!decoder.codec) {
+            close_video_decoder(&decoder);
+            continue;
+        }
+
+        decoder.codec->skip_frame = AVDISCARD_NONKEY;
+        AVFrame *frame = decode_frame_at(&decoder, 0);
+        string background = frame ? encode_frame_png(frame, MENU_BACKGROUND_WIDTH) : "";
+
+        av_frame_free(&frame);
+        close_video_decoder(&decoder);
+
+        if (!background.empty())
+            return background;
+    }
+
+    return "";
+}
+
 static igs_t get_menu(uint32_t playlist_id, string path) {
     string mpls_name = to_string(playlist_id);
     mpls_name.insert(mpls_name.begin(), 5 - mpls_name.length(), '0');
@@ -58,23 +90,138 @@ static igs_t get_menu(uint32_t playlist_id, string path) {
     string clip_id(mpls->sub_path[0].sub_play_item[0].clip[0].clip_id);
 
     string menu_path = path + "/BDMV/STREAM/" + clip_id + ".m2ts";
-    igs_t igs = extract_menu(menu_path.c_str());
+    unique_ptr<istream> stream = bd_image_open_stream(menu_path);
+    igs_t igs = extract_menu(*stream);
+
+    if (igs.menu.page_count) {
+        igs.background_clips = { clip_id };
+        if (mpls->list_count && mpls->play_item[0].clip && clip_id != mpls->play_item[0].clip[0].clip_id)
+            igs.background_clips.push_back(mpls->play_item[0].clip[0].clip_id);
+    }
 
     return igs;
 }
 
+static bluray_time_index_t get_time_index(const BLURAY_TITLE_INFO *title, const vector<CLPI_CL *> &clpis) {
+    bluray_time_index_t index;
+    uint64_t title_time = 0;
+
+    for (uint32_t clip_idx = 0; clip_idx < title->clip_count; clip_idx++) {
+        const BLURAY_CLIP_INFO &clip = title->clips[clip_idx];
+        index.play_item_starts.push_back(title_time);
+
+        const CLPI_CL *clpi = clpis[clip_idx];
+
+        if (!clpi || !clpi->cpi.num_stream_pid) {
+            fprintf(stderr, "No EP map for clip %s\n", clip.clip_id);
+            title_time += clip.out_time - clip.in_time;
+            continue;
+        }
+
+        // Coarse entries hold the high bits, fine entries the low bits
+        // of each I-frame's PTS (90kHz) and source packet number.
+        const CLPI_EP_MAP_ENTRY &ep_map = clpi->cpi.entry[0];
+        vector<pair<uint64_t, uint32_t>> points;
+        for (int coarse_idx = 0; coarse_idx < ep_map.num_ep_coarse; coarse_idx++) {
+            const CLPI_EP_COARSE &coarse = ep_map.coarse[coarse_idx];
+            int fine_end = coarse_idx + 1 < ep_map.num_ep_coarse
+                ? ep_map.coarse[coarse_idx + 1].ref_ep_fine_id
+                : ep_map.num_ep_fine;
+
+            for (int fine_idx = coarse.ref_ep_fine_id; fine_idx < fine_end; fine_idx++) {
+                const CLPI_EP_FINE &fine = ep_map.fine[fine_idx];
+                uint64_t pts = ((uint64_t)(coarse.pts_ep & ~0x01) << 19) + ((uint64_t)fine.pts_ep << 9);
+                uint32_t spn = (coarse.spn_ep & ~0x1FFFF) + fine.spn_ep;
+                points.push_back({ pts, spn });
+            }
+        }
+
+        uint32_t start_spn = 0;
+        for (auto const& [pts, spn] : points)
+            if (pts <= clip.in_time) start_spn = spn;
+
+        for (auto const& [pts, spn] : points)
+            if (pts >= clip.in_time && pts < clip.out_time && spn >= start_spn)
+                index.entries.push_back({ title_time + pts - clip.in_time, clip_idx });
+
+        title_time += clip.out_time - clip.in_time;
+    }
+
+    for (uint32_t mark_idx = 0; mark_idx < title->mark_count; mark_idx++)
+        index.mark_starts.push_back(title->marks[mark_idx].start);
+
+    sort(index.entries.begin(), index.entries.end(), [](const bluray_ep_entry_t &a, const bluray_ep_entry_t &b) {
+        return a.time < b.time;
+    });
+
+    return index;
+}
+
+static bool is_audio_coding_type(uint8_t coding_type) {
+    return (coding_type >= 0x80 && coding_type <= 0x87) || coding_type == 0xA1 || coding_type == 0xA2;
+}
+
+// mpv numbers tracks per type in PMT order, which the CLPI program info
+// mirrors. TrueHD carries an AC-3 core that the demuxer exposes as a
+// second track on the same PID.
+static vector<bluray_stream_attr_t> get_stream_attrs(const BLURAY_STREAM_INFO *streams, uint8_t count, const CLPI_CL *clpi, bool audio) {
+    vector<bluray_stream_attr_t> attrs;
+
+    for (uint8_t stream_idx = 0; stream_idx < count; stream_idx++) {
+        const BLURAY_STREAM_INFO &stream = streams[stream_idx];
+        uint32_t track_id = 0;
+
+        if (clpi && clpi->program.num_prog) {
+            const CLPI_PROG &prog = clpi->program.progs[0];
+            uint32_t type_count = 0;
+
+            for (uint8_t prog_idx = 0; prog_idx < prog.num_streams; prog_idx++) {
+                uint8_t coding_type = prog.streams[prog_idx].coding_type;
+                bool matches = audio ? is_audio_coding_type(coding_type) : coding_type == 0x90;
+                if (!matches) continue;
+
+                if (prog.streams[prog_idx].pid == stream.pid) {
+                    track_id = type_count + 1;
+                    break;
+                }
+
+                type_count += audio && coding_type == 0x83 ? 2 : 1;
+            }
+        }
+
+        attrs.push_back({ stream.pid, stream.coding_type, string((const char *)stream.lang), track_id });
+    }
+
+    return attrs;
+}
+
 static bluray_playlist_info_t get_playlist_info(const BLURAY_TITLE_INFO *title, string path) {
     vector<bluray_clip_info_t> clips(title->clip_count);
     vector<BLURAY_TITLE_MARK> marks(title->marks, title->marks + title->mark_count);
+    vector<CLPI_CL *> clpis(title->clip_count);
     
-    for (uint32_t clip_idx = 0; clip_idx < title->clip_count; clip_idx++)
+    for (uint32_t clip_idx = 0; clip_idx < title->clip_count; clip_idx++) {
+        const BLURAY_CLIP_INFO &clip = title->clips[clip_idx];
+        string clpi_path = path + "/BDMV/CLIPINF/" + clip.clip_id + ".clpi";
+        clpis[clip_idx] = bd_read_clpi(clpi_path.c_str());
+        if (!clpis[clip_idx])
+            fprintf(stderr, "Couldn't read clip info from %s\n", clpi_path.c_str());
+
         clips[clip_idx] = {
-            title->clips[clip_idx].clip_id,
-            title->clips[clip_idx].in_time,
-            title->clips[clip_idx].out_time
+            clip.clip_id,
+            clip.in_time,
+            clip.out_time,
+            get_stream_attrs(clip.audio_streams, clip.audio_stream_count, clpis[clip_idx], true),
+            get_stream_attrs(clip.pg_streams, clip.pg_stream_count, clpis[clip_idx], false)
         };
+    }
+
+    bluray_time_index_t time_index = get_time_index(title, clpis);
 
-    return { title->playlist, clips, marks, get_menu(title->playlist, path) };
+    for (CLPI_CL *clpi : clpis)
+        if (clpi) bd_free_clpi(clpi);
+
+    return { title->playlist, clips, marks, get_menu(title->playlist, path), time_index };
 }
 
 typedef struct bd_pl_thread_args_t {
@@ -100,13 +247,17 @@ void* get_playlist_thread(void* args) {
 
 bluray_disc_info_t open_bd_disc(string path) {
     if (bd != NULL)
-        bd_close(bd);
+        bd_image_close(bd);
 
-    bd = bd_open(path.c_str(), NULL);
+    bd = bd_image_is_iso(path) ? bd_image_open(path) : bd_open(path.c_str(), NULL);
+    if (bd == NULL) {
+        fprintf(stderr, "Couldn't open disc at %s\n", path.c_str());
+        return bluray_disc_info_t {};
+    }
 
     const BLURAY_DISC_INFO *info = bd_get_disc_info(bd);
     uint32_t num_playlists = bd_get_titles(bd, 0, 0);
-    map<string, bluray_playlist_info_t> playlists;
+    map<uint32_t, bluray_playlist_info_t> playlists;
 
     printf("%u playlists detected\n", num_playlists);
 
@@ -124,7 +275,7 @@ bluray_disc_info_t open_bd_disc(string path) {
         for (uint32_t thread_idx = 0; thread_idx < min((uint32_t)MAX_THREADS, num_playlists - (group_idx * MAX_THREADS)); thread_idx++) {
             pthread_join(threads[thread_idx], NULL);
             bluray_playlist_info_t playlist = thread_args[thread_idx].playlist;
-            playlists.insert({ to_string(playlist.playlist_id), playlist });
+            playlists.insert({ playlist.playlist_id, playlist });
         }
     }
     
@@ -139,7 +290,7 @@ bluray_disc_info_t open_bd_disc(string path) {
     for (uint32_t title_idx = 1; title_idx <= info->num_titles; title_idx++) 
         title_map.push_back(info->titles[title_idx]->id_ref);
 
-    return bluray_disc_info_t {
+    bluray_disc_info_t disc_info = {
         info->disc_name,
         num_playlists,
         playlists,
@@ -149,4 +300,419 @@ bluray_disc_info_t open_bd_disc(string path) {
         title_map,
         mobj
     };
-}
\ No newline at end of file
+
+    disc_info.nav_graph = build_nav_graph(disc_info);
+
+    return disc_info;
+}
+
+bool probe_bd_disc(string path, bluray_disc_summary_t *summary) {
+    // Separate handle from the global one so scans never touch the open disc.
+    BLURAY *probe = bd_open(path.c_str(), NULL);
+    if (probe == NULL)
+        return false;
+
+    const BLURAY_DISC_INFO *info = bd_get_disc_info(probe);
+    if (!info || !info->bluray_detected) {
+        bd_close(probe);
+        return false;
+    }
+
+    *summary = bluray_disc_summary_t { info->disc_name ? info->disc_name : "" };
+    summary->num_titles = bd_get_titles(probe, TITLES_RELEVANT, 0);
+
+    uint64_t longest = 0;
+    for (uint32_t title_idx = 0; title_idx < summary->num_titles; title_idx++) {
+        BLURAY_TITLE_INFO *title = bd_get_title_info(probe, title_idx, 0);
+        if (!title) continue;
+
+        if (title->duration > longest && title->clip_count) {
+            const BLURAY_CLIP_INFO &clip = title->clips[0];
+            longest = title->duration;
+            summary->main_playlist = title->playlist;
+            summary->duration = (double)title->duration / 90000;
+            summary->main_clip_id = clip.clip_id;
+            summary->video_coding_type = clip.video_stream_count ? clip.video_streams[0].coding_type : 0;
+            summary->video_format = clip.video_stream_count ? clip.video_streams[0].format : 0;
+            summary->audio_coding_type = clip.audio_stream_count ? clip.audio_streams[0].coding_type : 0;
+        }
+
+        bd_free_title_info(title);
+    }
+
+    bd_close(probe);
+    return true;
+}
+
+static uint32_t get_effects_duration(const window_effect_t &window_effect) {
+    uint32_t duration = 0;
+    for (auto const& effect : window_effect.effects)
+        duration += effect.duration;
+
+    return duration;
+}
+
+const bluray_mobj_object_t *DiscInfo::find_object(uint32_t object_idx) const {
+    if (!info || object_idx >= info->mobj.objects.size())
+        return NULL;
+
+    return &info->mobj.objects[object_idx];
+}
+
+const bluray_playlist_info_t *DiscInfo::find_playlist(uint32_t playlist_id) const {
+    if (!info) return NULL;
+
+    auto it = info->playlists.find(playlist_id);
+    return it == info->playlists.end() ? NULL : &it->second;
+}
+
+const page_t *DiscInfo::find_page(uint32_t playlist_id, uint32_t page_id) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist || page_id >= playlist->igs.menu.pages.size())
+        return NULL;
+
+    return &playlist->igs.menu.pages[page_id];
+}
+
+const button_t *DiscInfo::find_button(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const {
+    const page_t *page = find_page(playlist_id, page_id);
+    if (!page) return NULL;
+
+    auto it = page->buttons.find(to_string(button_id));
+    return it == page->buttons.end() ? NULL : &it->second;
+}
+
+string DiscInfo::disc_name() const {
+    return info ? info->disc_name : "";
+}
+
+uint32_t DiscInfo::num_playlists() const {
+    return info ? info->num_playlists : 0;
+}
+
+bool DiscInfo::first_play_supported() const {
+    return info && info->first_play_supported;
+}
+
+uint32_t DiscInfo::first_play_idx() const {
+    return info ? info->first_play_idx : 0xFFFFFFFF;
+}
+
+bool DiscInfo::top_menu_supported() const {
+    return info && info->top_menu_supported;
+}
+
+uint32_t DiscInfo::num_titles() const {
+    return info ? info->title_map.size() : 0;
+}
+
+uint32_t DiscInfo::get_title_object(uint32_t title) const {
+    if (!info) return 0xFFFFFFFF;
+    if (title == 0xFFFF) return info->first_play_idx;
+
+    return title < info->title_map.size() ? info->title_map[title] : 0xFFFFFFFF;
+}
+
+uint16_t DiscInfo::num_objects() const {
+    return info ? info->mobj.objects.size() : 0;
+}
+
+bluray_mobj_object_t DiscInfo::get_object(uint32_t object_idx) const {
+    const bluray_mobj_object_t *object = find_object(object_idx);
+    return object ? *object : bluray_mobj_object_t {};
+}
+
+uint16_t DiscInfo::get_object_command_count(uint32_t object_idx) const {
+    const bluray_mobj_object_t *object = find_object(object_idx);
+    return object ? object->cmds.size() : 0;
+}
+
+bluray_mobj_cmd_t DiscInfo::get_object_command(uint32_t object_idx, uint32_t cmd_idx) const {
+    if (cmd_idx >= get_object_command_count(object_idx))
+        return bluray_mobj_cmd_t {};
+
+    return find_object(object_idx)->cmds[cmd_idx];
+}
+
+vector<uint32_t> DiscInfo::get_playlist_ids() const {
+    vector<uint32_t> ids;
+    if (!info) return ids;
+
+    for (auto const& [playlist_id, playlist] : info->playlists)
+        ids.push_back(playlist_id);
+
+    return ids;
+}
+
+bool DiscInfo::has_playlist(uint32_t playlist_id) const {
+    return find_playlist(playlist_id) != NULL;
+}
+
+uint32_t DiscInfo::get_clip_count(uint32_t playlist_id) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    return playlist ? playlist->clips.size() : 0;
+}
+
+bluray_clip_info_t DiscInfo::get_clip(uint32_t playlist_id, uint32_t clip_idx) const {
+    if (clip_idx >= get_clip_count(playlist_id))
+        return bluray_clip_info_t {};
+
+    return find_playlist(playlist_id)->clips[clip_idx];
+}
+
+vector<bluray_clip_info_t> DiscInfo::get_clips(uint32_t playlist_id) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    return playlist ? playlist->clips : vector<bluray_clip_info_t>();
+}
+
+uint32_t DiscInfo::get_mark_count(uint32_t playlist_id) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    return playlist ? playlist->marks.size() : 0;
+}
+
+BLURAY_TITLE_MARK DiscInfo::get_mark(uint32_t playlist_id, uint32_t mark_idx) const {
+    if (mark_idx >= get_mark_count(playlist_id))
+        return BLURAY_TITLE_MARK {};
+
+    return find_playlist(playlist_id)->marks[mark_idx];
+}
+
+time_entry_t DiscInfo::find_time_entry(uint32_t playlist_id, double time) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist) return time_entry_t { 0, 0 };
+
+    const vector<bluray_ep_entry_t> &entries = playlist->time_index.entries;
+    uint64_t ticks = time > 0 ? time * 90000 : 0;
+
+    auto it = upper_bound(entries.begin(), entries.end(), ticks, [](uint64_t ticks, const bluray_ep_entry_t &entry) {
+        return ticks < entry.time;
+    });
+
+    if (it == entries.begin()) {
+        uint32_t play_item = find_play_item(playlist_id, time);
+        return time_entry_t { get_play_item_time(playlist_id, play_item), play_item };
+    }
+
+    --it;
+    return time_entry_t { (double)it->time / 90000, it->play_item };
+}
+
+const bluray_clip_info_t *DiscInfo::find_clip(uint32_t playlist_id, uint32_t play_item) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist || play_item >= playlist->clips.size())
+        return NULL;
+
+    return &playlist->clips[play_item];
+}
+
+vector<bluray_stream_attr_t> DiscInfo::get_audio_streams(uint32_t playlist_id, uint32_t play_item) const {
+    const bluray_clip_info_t *clip = find_clip(playlist_id, play_item);
+    return clip ? clip->audio_streams : vector<bluray_stream_attr_t>();
+}
+
+vector<bluray_stream_attr_t> DiscInfo::get_pg_streams(uint32_t playlist_id, uint32_t play_item) const {
+    const bluray_clip_info_t *clip = find_clip(playlist_id, play_item);
+    return clip ? clip->pg_streams : vector<bluray_stream_attr_t>();
+}
+
+// Stream numbers are 1-based indices into the STN table, as held in PSR1/PSR2.
+uint32_t DiscInfo::get_audio_track(uint32_t playlist_id, uint32_t play_item, uint32_t stream) const {
+    const bluray_clip_info_t *clip = find_clip(playlist_id, play_item);
+    if (!clip || !stream || stream > clip->audio_streams.size())
+        return 0;
+
+    return clip->audio_streams[stream - 1].track_id;
+}
+
+uint32_t DiscInfo::get_pg_track(uint32_t playlist_id, uint32_t play_item, uint32_t stream) const {
+    const bluray_clip_info_t *clip = find_clip(playlist_id, play_item);
+    if (!clip || !stream || stream > clip->pg_streams.size())
+        return 0;
+
+    return clip->pg_streams[stream - 1].track_id;
+}
+
+uint32_t DiscInfo::find_audio_stream(uint32_t playlist_id, uint32_t play_item, uint32_t track_id) const {
+    const bluray_clip_info_t *clip = find_clip(playlist_id, play_item);
+    if (!clip || !track_id) return 0;
+
+    for (uint32_t stream_idx = 0; stream_idx < clip->audio_streams.size(); stream_idx++)
+        if (clip->audio_streams[stream_idx].track_id == track_id)
+            return stream_idx + 1;
+
+    return 0;
+}
+
+uint32_t DiscInfo::find_pg_stream(uint32_t playlist_id, uint32_t play_item, uint32_t track_id) const {
+    const bluray_clip_info_t *clip = find_clip(playlist_id, play_item);
+    if (!clip || !track_id) return 0;
+
+    for (uint32_t stream_idx = 0; stream_idx < clip->pg_streams.size(); stream_idx++)
+        if (clip->pg_streams[stream_idx].track_id == track_id)
+            return stream_idx + 1;
+
+    return 0;
+}
+
+vector<uint32_t> DiscInfo::get_likely_playlists(uint32_t object_idx, uint32_t playlist_id, int32_t page_id) const {
+    vector<uint32_t> playlists;
+    if (!info) return playlists;
+
+    const bluray_nav_graph_t &graph = info->nav_graph;
+
+    auto pages = graph.page_playlists.find(playlist_id);
+    if (page_id >= 0 && pages != graph.page_playlists.end() && (size_t)page_id < pages->second.size())
+        playlists = pages->second[page_id];
+
+    if (object_idx < graph.object_playlists.size())
+        for (uint32_t id : graph.object_playlists[object_idx])
+            if (find(playlists.begin(), playlists.end(), id) == playlists.end())
+                playlists.push_back(id);
+
+    return playlists;
+}
+
+uint32_t DiscInfo::find_play_item(uint32_t playlist_id, double time) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist) return 0;
+
+    const vector<uint64_t> &starts = playlist->time_index.play_item_starts;
+    uint64_t ticks = time > 0 ? time * 90000 : 0;
+
+    auto it = upper_bound(starts.begin(), starts.end(), ticks);
+    return it == starts.begin() ? 0 : it - starts.begin() - 1;
+}
+
+uint32_t DiscInfo::find_chapter(uint32_t playlist_id, double time) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist) return 0;
+
+    const vector<uint64_t> &starts = playlist->time_index.mark_starts;
+    uint64_t ticks = time > 0 ? time * 90000 : 0;
+
+    auto it = upper_bound(starts.begin(), starts.end(), ticks);
+    return it == starts.begin() ? 0 : it - starts.begin() - 1;
+}
+
+double DiscInfo::get_play_item_time(uint32_t playlist_id, uint32_t play_item) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist || play_item >= playlist->time_index.play_item_starts.size())
+        return 0;
+
+    return (double)playlist->time_index.play_item_starts[play_item] / 90000;
+}
+
+menu_info_t DiscInfo::get_menu_info(uint32_t playlist_id) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist) return menu_info_t { 0, 0, 0 };
+
+    const menu_t *menu = &playlist->igs.menu;
+    return menu_info_t { menu->width, menu->height, menu->page_count };
+}
+
+page_info_t DiscInfo::get_page(uint32_t playlist_id, uint32_t page_id) const {
+    const page_t *page = find_page(playlist_id, page_id);
+    if (!page) return page_info_t {};
+
+    return page_info_t {
+        page->id,
+        page->framerate_divider,
+        page->def_button,
+        page->def_activated,
+        page->palette,
+        page->bog_count,
+        get_effects_duration(page->in_effects),
+        get_effects_duration(page->out_effects)
+    };
+}
+
+vector<uint16_t> DiscInfo::get_page_default_buttons(uint32_t playlist_id, uint32_t page_id) const {
+    vector<uint16_t> buttons;
+    const page_t *page = find_page(playlist_id, page_id);
+    if (!page) return buttons;
+
+    for (auto const& bog : page->bogs)
+        buttons.push_back(bog.def_button);
+
+    return buttons;
+}
+
+int DiscInfo::get_button_group(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const {
+    const page_t *page = find_page(playlist_id, page_id);
+    if (!page) return -1;
+
+    for (size_t bog_idx = 0; bog_idx < page->bogs.size(); bog_idx++) {
+        auto const& ids = page->bogs[bog_idx].button_ids;
+        if (find(ids.begin(), ids.end(), button_id) != ids.end())
+            return bog_idx;
+    }
+
+    return -1;
+}
+
+bool DiscInfo::has_button(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const {
+    return find_button(playlist_id, page_id, button_id) != NULL;
+}
+
+button_t DiscInfo::get_button(uint32_t playlist_id, uint32_t page_id, uint16_t button_id) const {
+    const button_t *button = find_button(playlist_id, page_id, button_id);
+    return button ? *button : button_t {};
+}
+
+vector<uint16_t> DiscInfo::get_picture_ids(uint32_t playlist_id) const {
+    vector<uint16_t> ids;
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist) return ids;
+
+    for (auto const& [picture_id, picture] : playlist->igs.pictures)
+        ids.push_back(picture.id);
+
+    return ids;
+}
+
+picture_extended_t DiscInfo::get_picture(uint32_t playlist_id, uint16_t picture_id) const {
+    const bluray_playlist_info_t *playlist = find_playlist(playlist_id);
+    if (!playlist) return picture_extended_t {};
+
+    auto it = playlist->igs.pictures.find(to_string(picture_id));
+    return it == playlist->igs.pictures.end() ? picture_extended_t {} : it->second;
+}
+
+map<uint32_t, string> bd_menu_backgrounds(DiscInfo disc, string disc_path) {
+    pthread_mutex_lock(&menu_backgrounds_lock);
+    auto it = menu_backgrounds.find(disc_path);
+    if (it != menu_backgrounds.end()) {
+        map<uint32_t, string> backgrounds = it->second;
+        pthread_mutex_unlock(&menu_backgrounds_lock);
+        return backgrounds;
+    }
+    pthread_mutex_unlock(&menu_backgrounds_lock);
+
+    map<uint32_t, string> backgrounds;
+    for (uint32_t playlist_id : disc.get_playlist_ids()) {
+        const bluray_playlist_info_t *playlist = disc.find_playlist(playlist_id);
+        if (!playlist || playlist->igs.background_clips.empty())
+            continue;
+
+        string background = get_menu_background(disc_path, playlist->igs.background_clips);
+        if (!background.empty())
+            backgrounds[playlist_id] = background;
+    }
+
+    pthread_mutex_lock(&menu_backgrounds_lock);
+    menu_backgrounds[disc_path] = backgrounds;
+    pthread_mutex_unlock(&menu_backgrounds_lock);
+
+    return backgrounds;
+}
+
+string bd_get_menu_background(string disc_path, uint32_t playlist_id) {
+    pthread_mutex_lock(&menu_backgrounds_lock);
+    string background;
+    auto it = menu_backgrounds.find(disc_path);
+    if (it != menu_backgrounds.end() && it->second.count(playlist_id))
+        background = it->second[playlist_id];
+    pthread_mutex_unlock(&menu_backgrounds_lock);
+
+    return background;
+}
@@ -18,38 +18,108 @@
 #include <filesystem>
 #include <iostream>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cmath>
 
 #include <AL/al.h>
 #include <AL/alc.h>
 
 #include "thumbnail.h"
 #include "libbluray.h"
+#include "hdmv_vm.h"
+#include "bd_stream.h"
+#include "media_library.h"
+#include "scrub_preview.h"
+#include "bd_chapters.h"
+#include "keyframe_index.h"
+#include "waveform.h"
+#include "event_ring.h"
+#include "node_json.h"
+#include "property_filter.h"
+#include "seek_controller.h"
+#include "frame_stats.h"
+#include "shader_presets.h"
+#include "shader_tiers.h"
 
 using namespace emscripten;
 using namespace std;
 
-static Uint32 wakeup_on_mpv_render_update, wakeup_on_mpv_events;
+static Uint32 wakeup_on_render_work;
 int width = 1920;
 int height = 1080;
-int64_t video_width = 1920;
-int64_t video_height = 1080;
+atomic<int64_t> video_width(1920);
+atomic<int64_t> video_height(1080);
 SDL_Window *window;
 mpv_handle *mpv;
 mpv_render_context *mpv_gl;
-pthread_t main_thread;
 pthread_t side_thread;
-bluray_disc_info_t disc_info;
+pthread_t event_thread;
+// Written on the side thread when a disc opens and read from JS, so both
+// are only touched under disc_lock.
+shared_ptr<const bluray_disc_info_t> disc_info;
+string disc_path;
+pthread_mutex_t disc_lock = PTHREAD_MUTEX_INITIALIZER;
 em_proxying_queue* main_queue = em_proxying_queue_create();
+// Work for the render thread. A wakeup only queues an SDL event when no
+// work was waiting yet, so bursts collapse into one.
+const uint32_t RENDER_WORK_UPDATE = 1 << 0;
+const uint32_t RENDER_WORK_RESIZE = 1 << 1;
+const uint32_t RENDER_WORK_PACING = 1 << 2;
+atomic<uint32_t> render_work(0);
+// Display sync renders on every animation frame and reports swaps, so mpv
+// can time frames to the display. It's never used on software GL, where
+// rendering can't keep up with the refresh rate.
+atomic<bool> display_sync_requested(false);
+atomic<bool> software_gl(false);
+bool display_sync = false;
+double reported_fps = 0;
+double vsync_interval = 0;
+// Adaptive sizing follows the canvas's size on the page in device pixels
+// instead of the screen's, and with a frame time budget it also drops
+// the scale while frames take too long.
+const double RENDER_SCALE_MIN = 0.5;
+const double RENDER_SCALE_STEP = 0.85;
+const double RENDER_BUDGET_HIGH = 0.9;
+const double RENDER_BUDGET_LOW = 0.5;
+const double RENDER_DEFAULT_BUDGET = 1000.0 / 60;
+const uint32_t RENDER_BUDGET_COOLDOWN = 60;
+atomic<bool> adaptive_render_size(false);
+atomic<bool> render_budget(false);
+atomic<bool> upscaling_shaders(false);
+atomic<int> display_width(0);
+atomic<int> display_height(0);
+double render_scale = 1;
+double budget_frame_time = 0;
+uint32_t budget_cooldown = 0;
+atomic<bool> library_update_pending(false);
+atomic<bool> quitting(false);
+// Reply ids handed to submitted requests. 0 is left for the fire and
+// forget calls below, whose replies are dropped.
+atomic<uint32_t> next_reply_id(1);
+
+// Persistent caches live in the origin private file system.
+const char *CACHE_DIR = "/cache";
+const char *SHADER_DIR = "/shaders";
+const char *EVENT_STORM_PROPERTY = "user-data/event-storm";
 
 void main_loop();
-void create_mpv_map_obj(mpv_node_list *map);
+void *event_loop(void *args);
+bool apply_shader_preset(string name);
+bool detect_software_gl();
+void mount_cache();
+void match_window_screen_size();
+void resize_render_target();
+void update_video_size(mpv_node *track_list);
+void post_node(const char *name, mpv_node *node);
 int get_shader_count();
 void get_tracks();
 void get_chapters();
 static void *get_proc_address_mpv(void *fn_ctx, const char *name);
-static void on_mpv_events(void *ctx);
 static void on_mpv_render_update(void *ctx);
-intptr_t get_main_thread();
+static void on_library_update();
+intptr_t get_event_thread();
 void die(const char *msg);
 void quit();
 
@@ -61,7 +131,6 @@ void* loop(void* args) {
 }
 
 int main(int argc, char const *argv[]) {
-    main_thread = pthread_self();
     pthread_create(&side_thread, NULL, loop, NULL);
 
     mpv = mpv_create();
@@ -72,6 +141,12 @@ int main(int argc, char const *argv[]) {
     if (mpv_initialize(mpv) < 0)
         die("mpv init failed");
 
+    if (bd_stream_register(mpv) < 0)
+        fprintf(stderr, "Couldn't register %s protocol\n", BD_STREAM_PROTOCOL);
+
+    mount_cache();
+    shader_presets_load(SHADER_DIR);
+
     // mpv_request_log_messages(mpv, "debug");
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -101,188 +176,366 @@ int main(int argc, char const *argv[]) {
     if (mpv_render_context_create(&mpv_gl, mpv, params) < 0)
         die("failed to initialize mpv GL context");
 
-    wakeup_on_mpv_render_update = SDL_RegisterEvents(1);
-    wakeup_on_mpv_events = SDL_RegisterEvents(1);
-    if (wakeup_on_mpv_render_update == (Uint32) - 1 || wakeup_on_mpv_events == (Uint32) - 1)
+    software_gl = detect_software_gl();
+    if (software_gl)
+        printf("Software GL detected, display sync is unavailable\n");
+
+    wakeup_on_render_work = SDL_RegisterEvents(1);
+    if (wakeup_on_render_work == (Uint32) - 1)
         die("could not register events");
 
-    mpv_set_wakeup_callback(mpv, on_mpv_events, NULL);
     mpv_render_context_set_update_callback(mpv_gl, on_mpv_render_update, NULL);
-
-    mpv_observe_property(mpv, 0, "pause", MPV_FORMAT_FLAG);
-    mpv_observe_property(mpv, 0, "duration", MPV_FORMAT_DOUBLE);
-    mpv_observe_property(mpv, 0, "playback-time", MPV_FORMAT_DOUBLE);
-    mpv_observe_property(mpv, 0, "vid", MPV_FORMAT_INT64);
-    mpv_observe_property(mpv, 0, "aid", MPV_FORMAT_INT64);
-    mpv_observe_property(mpv, 0, "sid", MPV_FORMAT_INT64);
-    mpv_observe_property(mpv, 0, "chapter", MPV_FORMAT_INT64);
-    mpv_observe_property(mpv, 0, "metadata/by-key/title", MPV_FORMAT_STRING);
-    mpv_observe_property(mpv, 0, "playlist-current-pos", MPV_FORMAT_INT64);
+    library_set_notify(on_library_update);
+
+    property_policy_t every_change = { 0, 0, false };
+    property_observe(mpv, "pause", MPV_FORMAT_FLAG, every_change);
+    property_observe(mpv, "duration", MPV_FORMAT_DOUBLE, every_change);
+    // Enough for a seek bar; JS interpolates between updates if it wants.
+    property_observe(mpv, "playback-time", MPV_FORMAT_DOUBLE, { 4, 0, false });
+    property_observe(mpv, "vid", MPV_FORMAT_INT64, every_change);
+    property_observe(mpv, "aid", MPV_FORMAT_INT64, every_change);
+    property_observe(mpv, "sid", MPV_FORMAT_INT64, every_change);
+    property_observe(mpv, "chapter", MPV_FORMAT_INT64, every_change);
+    property_observe(mpv, "metadata/by-key/title", MPV_FORMAT_STRING, every_change);
+    property_observe(mpv, "playlist-current-pos", MPV_FORMAT_INT64, every_change);
+
+    // Upscaling is on from the start, stepping down if the client can't keep up.
+    mpv_observe_property(mpv, SHADER_TIER_DROPS_ID, "frame-drop-count", MPV_FORMAT_INT64);
+    mpv_observe_property(mpv, SHADER_TIER_DELAYED_ID, "vo-delayed-frame-count", MPV_FORMAT_INT64);
+    // Every change, so a disc's clip transitions can be timed.
+    mpv_observe_property(mpv, BD_STREAM_TIME_ID, "playback-time", MPV_FORMAT_DOUBLE);
+    string preset;
+    if (shader_tiers_set(SHADER_DEFAULT_TIERS, true, &preset))
+        apply_shader_preset(preset);
+
+    // Events are drained on a thread of their own, so this one only renders.
+    pthread_create(&event_thread, NULL, event_loop, NULL);
 
     emscripten_set_main_loop(main_loop, 0, 1);
 
     return 0;
 }
 
-void main_loop() {
-    SDL_Event event;
-    if (SDL_WaitEvent(&event) != 1)
-        die("event loop error");
-    int redraw = 0;
+void wake_js() {
+    EM_ASM(postMessage(JSON.stringify({ type: 'events' })););
+}
+
+// Discrete events wake JS right away. Property changes wait for its next
+// animation frame unless the ring is filling up.
+void push_event(event_ring_type type, int32_t property, mpv_format format, void *data, bool wake) {
+    int64_t waiting = event_ring_push(type, property, format, data);
+    if (waiting < 0)
+        fprintf(stderr, "Event ring full, dropped event %d\n", type);
+
+    if (wake || waiting == EVENT_RING_HIGH_WATER)
+        wake_js();
+}
+
+void emit_property(const char *name, mpv_format format, void *data) {
+    push_event(EVENT_RING_PROPERTY_CHANGE, event_ring_property_id(name), format, data, false);
+}
+
+void wake_render(uint32_t work) {
+    if (render_work.fetch_or(work) == 0) {
+        SDL_Event event = {.type = wakeup_on_render_work};
+        SDL_PushEvent(&event);
+    }
+}
+
+// Returns whether the event was a reply JS is waiting on.
+bool handle_mpv_event(mpv_event *mp_event) {
+    switch (mp_event->event_id) {
+        case MPV_EVENT_IDLE: {
+            int64_t shader_count = get_shader_count();
+            push_event(EVENT_RING_IDLE, -1, MPV_FORMAT_INT64, &shader_count, true);
+            break;
+        }
+        case MPV_EVENT_LOG_MESSAGE: {
+            mpv_event_log_message *msg = (mpv_event_log_message*)mp_event->data;
+            printf("log: %s", msg->text);
+            break;
+        }
+        case MPV_EVENT_FILE_LOADED: {
+            get_tracks();
+            get_chapters();
+
+            char *path = mpv_get_property_string(mpv, "path");
+            scrub_preview_open(path ? path : "");
+            keyframe_index_request(path ? path : "");
+            mpv_free(path);
+            break;
+        }
+        case MPV_EVENT_START_FILE:
+            seek_reset();
+            bd_stream_reset_timing();
+            push_event(EVENT_RING_FILE_START, -1, MPV_FORMAT_NONE, NULL, true);
+            break;
+        case MPV_EVENT_END_FILE:
+            seek_reset();
+            bd_stream_reset_timing();
+            push_event(EVENT_RING_FILE_END, -1, MPV_FORMAT_NONE, NULL, true);
+            break;
+        case MPV_EVENT_PLAYBACK_RESTART:
+            seek_on_playback_restart(mpv);
+            bd_stream_reset_timing();
+            break;
+        case MPV_EVENT_COMMAND_REPLY:
+        case MPV_EVENT_SET_PROPERTY_REPLY: {
+            if (mp_event->reply_userdata == SEEK_REPLY_ID) {
+                seek_on_reply(mpv, mp_event->error);
+                break;
+            }
+            if (mp_event->reply_userdata == SHADER_PRESET_REPLY_ID) {
+                shader_preset_on_reply(mp_event->error);
+
+                string active = shader_preset_state().active;
+                const char *name = active.c_str();
+                push_event(EVENT_RING_SHADER_PRESET, shader_tiers_current(), MPV_FORMAT_STRING, &name, true);
+                break;
+            }
+            if (!mp_event->reply_userdata)
+                break;
+
+            int64_t error = mp_event->error;
+            push_event(EVENT_RING_COMMAND_REPLY, (int32_t)mp_event->reply_userdata, MPV_FORMAT_INT64, &error, false);
+            return true;
+        }
+        case MPV_EVENT_GET_PROPERTY_REPLY:
+        case MPV_EVENT_PROPERTY_CHANGE: {
+            mpv_event_property *evt = (mpv_event_property*)mp_event->data;
+            if (mp_event->reply_userdata == SHADER_TIER_DROPS_ID || mp_event->reply_userdata == SHADER_TIER_DELAYED_ID) {
+                if (evt->format == MPV_FORMAT_INT64)
+                    shader_tiers_on_drops(mp_event->reply_userdata, *(int64_t *)evt->data);
+                break;
+            }
+            if (mp_event->reply_userdata == BD_STREAM_TIME_ID) {
+                if (evt->format == MPV_FORMAT_DOUBLE && evt->data)
+                    bd_stream_on_playback_time(*(double *)evt->data);
+                break;
+            }
+            if (mp_event->event_id == MPV_EVENT_PROPERTY_CHANGE && strcmp(evt->name, "pause") == 0)
+                bd_stream_reset_timing();
+            if (mp_event->event_id == MPV_EVENT_PROPERTY_CHANGE && !property_filter_accept(mp_event->reply_userdata, evt))
+                break;
+
+            switch (evt->format) {
+                case MPV_FORMAT_NONE:
+                case MPV_FORMAT_STRING:
+                case MPV_FORMAT_FLAG:
+                case MPV_FORMAT_DOUBLE:
+                case MPV_FORMAT_INT64:
+                    push_event(EVENT_RING_PROPERTY_CHANGE, event_ring_property_id(evt->name), evt->format, evt->data, false);
+                    break;
+                case MPV_FORMAT_NODE: {
+                    mpv_node *data = (mpv_node *)evt->data;
+                    if (strcmp(evt->name, "track-list") == 0)
+                        update_video_size(data);
+
+                    post_node(evt->name, data);
+                    break;
+                }
+                default:
+                    printf("property-change: { name: %s, format: %d }\n", evt->name, evt->format);
+            }
+            break;
+        }
+        default:
+            break;
+        //     printf("event: %s\n", mpv_event_name(mp_event->event_id));
+    }
+
+    return false;
+}
+
+// Blocks in mpv until an event arrives, a library update pokes it with
+// mpv_wakeup, or a rate limited property has a value due. Whatever is
+// queued by then is handled in one pass before JS is woken.
+void *event_loop(void *args) {
+    while (!quitting) {
+        int32_t next_flush = property_filter_next_flush();
+        mpv_event *mp_event = mpv_wait_event(mpv, next_flush < 0 ? -1 : next_flush / 1000.0);
+
+        // A batch replies all at once, so JS is woken once for all of them.
+        bool replied = false;
+        for (; mp_event->event_id != MPV_EVENT_NONE; mp_event = mpv_wait_event(mpv, 0)) {
+            if (mp_event->event_id == MPV_EVENT_SHUTDOWN)
+                return NULL;
+            replied |= handle_mpv_event(mp_event);
+        }
+
+        // Only a wakeup; JS pulls the entries with libraryTakeUpdates.
+        if (library_update_pending.exchange(false)) {
+            int scanning = library_is_scanning();
+            push_event(EVENT_RING_LIBRARY_UPDATE, -1, MPV_FORMAT_FLAG, &scanning, true);
+        }
+
+        property_filter_flush(emit_property);
+        if (replied)
+            wake_js();
+    }
+
+    return NULL;
+}
+
+// Runs on the render thread, where the GL context is current.
+bool detect_software_gl() {
+    return EM_ASM_INT({
+        const gl = GL.currentContext && GL.currentContext.GLctx;
+        if (!gl) return 0;
+
+        const info = gl.getExtension('WEBGL_debug_renderer_info');
+        const renderer = String(gl.getParameter(info ? info.UNMASKED_RENDERER_WEBGL : gl.RENDERER));
+        return /swiftshader|llvmpipe|softpipe|software|basic render/i.test(renderer) ? 1 : 0;
+    });
+}
+
+void apply_frame_pacing() {
+    display_sync = display_sync_requested && !software_gl;
+    reported_fps = 0;
+    frame_stats_set_display_sync(display_sync);
+
+    const char *video_sync = display_sync ? "display-resample" : "audio";
+    mpv_set_property_async(mpv, 0, "video-sync", MPV_FORMAT_STRING, &video_sync);
+}
+
+// mpv can't see the refresh rate from here, so it gets the measured one.
+void report_display_fps(double vsync_interval) {
+    if (vsync_interval <= 0)
+        return;
+
+    double fps = 1000 / vsync_interval;
+    if (fabs(fps - reported_fps) <= reported_fps * 0.005)
+        return;
+
+    reported_fps = fps;
+    mpv_set_property_async(mpv, 0, "display-fps-override", MPV_FORMAT_DOUBLE, &fps);
+}
+
+// Returns whether the frame needs to be redrawn.
+int handle_sdl_event(const SDL_Event &event) {
     switch (event.type) {
         case SDL_EVENT_QUIT:
             quit();
-            break;
+            return 0;
         case SDL_EVENT_WINDOW_EXPOSED:
-            redraw = 1;
-            break;
+            return 1;
         default:
-            if (event.type == wakeup_on_mpv_render_update) {
+            if (event.type != wakeup_on_render_work)
+                return 0;
+
+            int redraw = 0;
+            uint32_t work = render_work.exchange(0);
+            if (work & RENDER_WORK_PACING)
+                apply_frame_pacing();
+            if (work & RENDER_WORK_RESIZE)
+                resize_render_target();
+            if (work & RENDER_WORK_UPDATE) {
                 uint64_t flags = mpv_render_context_update(mpv_gl);
                 if (flags & MPV_RENDER_UPDATE_FRAME)
                     redraw = 1;
             }
-            if (event.type == wakeup_on_mpv_events) {
-                while (1) {
-                    mpv_event *mp_event = mpv_wait_event(mpv, 0);
-                    if (mp_event->event_id == MPV_EVENT_NONE)
-                        break;
-                    switch (mp_event->event_id) {
-                        case MPV_EVENT_IDLE:
-                            EM_ASM({
-                                postMessage(JSON.stringify({ type: 'idle', shaderCount: $0 }));
-                            }, get_shader_count());
-                            break;
-                        case MPV_EVENT_LOG_MESSAGE: {
-                            mpv_event_log_message *msg = (mpv_event_log_message*)mp_event->data;
-                            printf("log: %s", msg->text);
-                            break;
-                        }
-                        case MPV_EVENT_FILE_LOADED:
-                            get_tracks();
-                            get_chapters();
-                            break;
-                        case MPV_EVENT_START_FILE:
-                            EM_ASM(postMessage(JSON.stringify({ type: 'file-start' })););
-                            break;
-                        case MPV_EVENT_END_FILE:
-                            EM_ASM(postMessage(JSON.stringify({ type: 'file-end' })););
-                            break;
-                        case MPV_EVENT_GET_PROPERTY_REPLY:
-                        case MPV_EVENT_PROPERTY_CHANGE: {
-                            mpv_event_property *evt = (mpv_event_property*)mp_event->data;
-                            
-                            switch (evt->format) {
-                                case MPV_FORMAT_NONE:
-                                    EM_ASM({
-                                        postMessage(JSON.stringify({
-                                            type: 'property-change',
-                                            name: UTF8ToString($0),
-                                            value: 0
-                                        }));
-                                    }, evt->name);
-                                    break;
-                                case MPV_FORMAT_STRING: {
-                                    const char **data = (const char **)evt->data;
-                                    EM_ASM({
-                                        postMessage(JSON.stringify({
-                                            type: 'property-change',
-                                            name: UTF8ToString($0),
-                                            value: UTF8ToString($1)
-                                        }));
-                                    }, evt->name, *data);
-                                    break;
-                                }
-                                case MPV_FORMAT_FLAG: {
-                                    int *data = (int *)evt->data;
-                                    EM_ASM({
-                                        postMessage(JSON.stringify({
-                                            type: 'property-change',
-                                            name: UTF8ToString($0),
-                                            value: $1
-                                        }));
-                                    }, evt->name, *data);
-                                    break;
-                                }
-                                case MPV_FORMAT_DOUBLE: {
-                                    double *data = (double *)evt->data;
-                                    EM_ASM({
-                                        postMessage(JSON.stringify({
-                                            type: 'property-change',
-                                            name: UTF8ToString($0),
-                                            value: $1
-                                        }));
-                                    }, evt->name, *data);
-                                    break;
-                                }
-                                case MPV_FORMAT_INT64: {
-                                    int64_t *data = (int64_t *)evt->data;
-                                    EM_ASM({
-                                        postMessage(JSON.stringify({
-                                            type: 'property-change',
-                                            name: UTF8ToString($0),
-                                            value: $1.toString()
-                                        }));
-                                    }, evt->name, *data);
-                                    break;
-                                }
-                                case MPV_FORMAT_NODE: {
-                                    mpv_node *data = (mpv_node *)evt->data;
-                                    mpv_node_list *list;
-                                    mpv_node_list *map;
-    
-                                    if (strcmp(evt->name, "track-list") != 0 && strcmp(evt->name, "chapter-list") != 0)
-                                        break;
-
-                                    list = (mpv_node_list *)data->u.list;
-                                    EM_ASM(arr = [];);
-                                    
-                                    for (int i = 0; i < list->num; i++) {
-                                        map = (mpv_node_list *)list->values[i].u.list;
-                                        create_mpv_map_obj(map);
-                                        EM_ASM(arr.push(obj););
-                                    }
-                                    if (strcmp(evt->name, "track-list") == 0) {
-                                        EM_ASM({
-                                            postMessage(JSON.stringify({
-                                                type: 'track-list',
-                                                tracks: arr
-                                            }));
-                                        });
-                                    }
-                                    if (strcmp(evt->name, "chapter-list") == 0) {
-                                        EM_ASM({
-                                            postMessage(JSON.stringify({
-                                                type: 'chapter-list',
-                                                chapters: arr
-                                            }));
-                                        });
-                                    }
-                                    break;
-                                }
-                                default:
-                                    printf("property-change: { name: %s, format: %d }\n", evt->name, evt->format);
-                            }
-                            break;
-                        }
-                        default:
-                            break;
-                        //     printf("event: %s\n", mpv_event_name(mp_event->event_id));
-                    }
-                }
-            }
+            return redraw;
     }
-    if (redraw) {
-        mpv_opengl_fbo fbo = { 0, width, height };
-        int flip_y = 1;
-        mpv_render_param params[] = {
-            {MPV_RENDER_PARAM_OPENGL_FBO, &fbo},
-            {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
-            {(mpv_render_param_type) 0}
-        };
-        mpv_render_context_render(mpv_gl, params);
-        SDL_GL_SwapWindow(window);
+}
+
+double frame_budget() {
+    return vsync_interval > 0 ? vsync_interval : RENDER_DEFAULT_BUDGET;
+}
+
+// Steps the scale down while the average frame time is close to the
+// budget, and back up once there's room again.
+void adjust_render_scale(double frame_time) {
+    if (!adaptive_render_size || !render_budget)
+        return;
+
+    budget_frame_time += (frame_time - budget_frame_time) * 0.1;
+    if (budget_cooldown) {
+        budget_cooldown--;
+        return;
+    }
+
+    double budget = frame_budget();
+    double scale = render_scale;
+    if (budget_frame_time > budget * RENDER_BUDGET_HIGH)
+        scale = max(RENDER_SCALE_MIN, scale * RENDER_SCALE_STEP);
+    else if (budget_frame_time < budget * RENDER_BUDGET_LOW)
+        scale = min(1.0, scale / RENDER_SCALE_STEP);
+
+    if (scale == render_scale)
+        return;
+
+    render_scale = scale;
+    budget_cooldown = RENDER_BUDGET_COOLDOWN;
+    resize_render_target();
+}
+
+// Sleeps until the next frame is due, which mpv would otherwise do inside
+// mpv_render_context_render and count towards the frame time. Untimed
+// frames (target_time 0) are drawn right away.
+void wait_for_target_time() {
+    mpv_render_frame_info info = {};
+    mpv_render_param param = { MPV_RENDER_PARAM_NEXT_FRAME_INFO, &info };
+    if (mpv_render_context_get_info(mpv_gl, param) < 0 || !info.target_time)
+        return;
+
+    int64_t wait = info.target_time - mpv_get_time_us(mpv);
+    if (wait > 0)
+        this_thread::sleep_for(chrono::microseconds(min<int64_t>(wait, 1000000)));
+}
+
+void render_frame() {
+    // The animation frame is already the target time when paced to the display.
+    if (!display_sync)
+        wait_for_target_time();
+
+    auto start = chrono::steady_clock::now();
+
+    mpv_opengl_fbo fbo = { 0, width, height };
+    int flip_y = 1;
+    int block_for_target_time = 0;
+    mpv_render_param params[] = {
+        {MPV_RENDER_PARAM_OPENGL_FBO, &fbo},
+        {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
+        {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target_time},
+        {(mpv_render_param_type) 0}
+    };
+    mpv_render_context_render(mpv_gl, params);
+    SDL_GL_SwapWindow(window);
+
+    if (display_sync)
+        mpv_render_context_report_swap(mpv_gl);
+    shader_preset_on_frame();
+
+    double frame_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    frame_stats_record(frame_time);
+    adjust_render_scale(frame_time);
+
+    string preset;
+    if (shader_tiers_on_frame(frame_time, frame_budget(), &preset))
+        apply_shader_preset(preset);
+}
+
+// Paced to the display, this runs once per animation frame and never
+// blocks. Otherwise it sleeps until there's something to draw.
+void main_loop() {
+    SDL_Event event;
+    int redraw = 0;
+
+    if (display_sync) {
+        while (SDL_PollEvent(&event))
+            redraw |= handle_sdl_event(event);
+
+        vsync_interval = frame_stats_vsync(emscripten_get_now());
+        report_display_fps(vsync_interval);
+    } else {
+        if (!SDL_WaitEvent(&event))
+            return;
+
+        redraw = handle_sdl_event(event);
     }
+
+    if (redraw && !quitting)
+        render_frame();
 }
 
 typedef struct {
@@ -290,21 +543,50 @@ typedef struct {
     string options;
 } load_file_args_t;
 
-void load_file_proxy(void* args) {
-    load_file_args_t* load_file_args = (load_file_args_t*)args;
+// OPFS-backed directory for data that should outlive the page: keyframe
+// indexes and mpv's shader cache.
+void mount_cache() {
+    backend_t backend = wasmfs_create_opfs_backend();
+    if (wasmfs_create_directory(CACHE_DIR, 0777, backend)) {
+        fprintf(stderr, "Couldn't mount the cache directory at %s\n", CACHE_DIR);
+        return;
+    }
 
-    filesystem::path path = load_file_args->path;
+    keyframe_index_set_dir(string(CACHE_DIR) + "/keyframes");
+
+    // Read when the render context is created, so compiled programs are
+    // reused across page loads wherever the GL backend can store them.
+    string shader_cache_dir = string(CACHE_DIR) + "/shaders";
+    error_code err;
+    filesystem::create_directories(shader_cache_dir, err);
+    if (err || mpv_set_option_string(mpv, "gpu-shader-cache-dir", shader_cache_dir.c_str()) < 0)
+        fprintf(stderr, "Couldn't use %s for the shader cache\n", shader_cache_dir.c_str());
+}
+
+// Mounts the external directory an absolute path starts in, if it isn't yet.
+bool mount_root(filesystem::path path) {
     string root_name = *next(path.begin());
     string root_path = "/" + root_name;
-    
+
     if (!filesystem::is_directory(root_path)) {
+        printf("mounting directory at %s\n", root_path.c_str());
         backend_t backend = wasmfs_create_externalfs_backend(root_name.c_str());
         int err = wasmfs_create_directory(root_path.c_str(), 0777, backend);
         if (err) {
             fprintf(stderr, "Couldn't mount directory at %s\n", root_path.c_str());
-            return;
+            return false;
         }
     }
+
+    return true;
+}
+
+void load_file_proxy(void* args) {
+    load_file_args_t* load_file_args = (load_file_args_t*)args;
+
+    filesystem::path path = load_file_args->path;
+    if (!mount_root(path))
+        return;
     
     // printf("loading %s with options %s\n", path.c_str(), load_file_args->options.c_str());
     
@@ -327,25 +609,22 @@ void load_file(string path, string options) {
 
 void open_disc_proxy(void* args) {
     filesystem::path path = *(string*)args;
-    string root_name = *next(path.begin());
-    string root_path = "/" + root_name;
-    
-    if (!filesystem::is_directory(root_path)) {
-        printf("mounting directory at %s\n", root_path.c_str());
-        backend_t backend = wasmfs_create_externalfs_backend(root_name.c_str());
-        int err = wasmfs_create_directory(root_path.c_str(), 0777, backend);
-        if (err) {
-            fprintf(stderr, "Couldn't mount directory at %s\n", root_path.c_str());
-            return;
-        }
-    }
+    if (!mount_root(path))
+        return;
     
-    if (!filesystem::is_directory(path)) {
-        fprintf(stderr, "%s is not a directory\n", path.c_str());
+    if (!filesystem::is_directory(path) && !bd_image_is_iso(path)) {
+        fprintf(stderr, "%s is not a disc directory or image\n", path.c_str());
         return;
     }
 
-    disc_info = open_bd_disc(path);
+    shared_ptr<const bluray_disc_info_t> info = make_shared<const bluray_disc_info_t>(open_bd_disc(path));
+    pthread_mutex_lock(&disc_lock);
+    disc_info = info;
+    disc_path = path;
+    pthread_mutex_unlock(&disc_lock);
+    bd_stream_set_disc(path);
+    // Clips inside an image are already served through its block cache.
+    bd_prefetch_set_disc(bd_image_is_iso(path) ? "" : path);
     free(args);
 }
 
@@ -356,8 +635,43 @@ uint32_t open_disc(string path) {
     return (uint32_t)emscripten_proxy_promise(main_queue, side_thread, open_disc_proxy, path_ptr);
 }
 
-bluray_disc_info_t get_disc_info() {
-    return disc_info;
+void scan_library_proxy(void* args) {
+    string path = *(string*)args;
+    delete (string*)args;
+
+    if (!mount_root(path))
+        return;
+
+    if (!library_scan(path))
+        fprintf(stderr, "A library scan is already running\n");
+}
+
+void scan_library(string path) {
+    emscripten_proxy_async(main_queue, side_thread, scan_library_proxy, new string(path));
+}
+
+// The open disc and its path, from any thread.
+DiscInfo get_open_disc(string *path) {
+    pthread_mutex_lock(&disc_lock);
+    DiscInfo disc(disc_info);
+    if (path) *path = disc_path;
+    pthread_mutex_unlock(&disc_lock);
+
+    return disc;
+}
+
+DiscInfo get_disc_info() {
+    return get_open_disc(NULL);
+}
+
+void prefetch_bd_clips(uint32_t playlist_id, uint32_t play_item, vector<uint32_t> playlist_ids) {
+    bd_prefetch_next(get_open_disc(NULL), playlist_id, play_item, playlist_ids);
+}
+
+void load_bd_playlist(uint32_t playlist_id, string options) {
+    string uri = bd_stream_uri(playlist_id);
+    const char * cmd[] = {"loadfile", uri.c_str(), "replace", "0", options.c_str(), NULL};
+    mpv_command_async(mpv, 0, cmd);
 }
 
 void load_files(vector<string> paths) {
@@ -424,8 +738,178 @@ void stop() {
     mpv_command_async(mpv, 0, cmd);
 }
 
+bool observe_property(string name, int format, double max_rate, double min_delta, bool on_change) {
+    return property_observe(mpv, name, (mpv_format)format, { max_rate, min_delta, on_change });
+}
+
+bool unobserve_property(string name) {
+    return property_unobserve(mpv, name);
+}
+
+int32_t take_reply_id() {
+    int32_t id;
+    do {
+        id = (int32_t)(next_reply_id++ & INT32_MAX);
+    } while (!id);
+
+    return id;
+}
+
+// The JS type of value picks the format. Whole numbers go as INT64, which
+// mpv also takes for double properties.
+int set_property_value(int32_t reply_id, string name, val value) {
+    string type = value.typeOf().as<string>();
+
+    if (type == "boolean") {
+        int flag = value.as<bool>();
+        return mpv_set_property_async(mpv, reply_id, name.c_str(), MPV_FORMAT_FLAG, &flag);
+    }
+
+    if (type == "bigint") {
+        int64_t number = value.as<int64_t>();
+        return mpv_set_property_async(mpv, reply_id, name.c_str(), MPV_FORMAT_INT64, &number);
+    }
+
+    if (type == "number") {
+        double number = value.as<double>();
+        if (number != trunc(number) || fabs(number) > 9007199254740991.0)
+            return mpv_set_property_async(mpv, reply_id, name.c_str(), MPV_FORMAT_DOUBLE, &number);
+
+        int64_t integer = (int64_t)number;
+        return mpv_set_property_async(mpv, reply_id, name.c_str(), MPV_FORMAT_INT64, &integer);
+    }
+
+    if (type == "string") {
+        string text = value.as<string>();
+        const char *data = text.c_str();
+        return mpv_set_property_async(mpv, reply_id, name.c_str(), MPV_FORMAT_STRING, &data);
+    }
+
+    return MPV_ERROR_PROPERTY_FORMAT;
+}
+
+// Each request is { command: string[] } or { property, value }. Returns a
+// reply id per request, in order, or the mpv error code of a request that
+// was turned down before it was queued. Replies come back through the
+// event ring.
+val submit_requests(val requests) {
+    uint32_t count = requests["length"].as<uint32_t>();
+    val ids = val::array();
+
+    for (uint32_t i = 0; i < count; i++) {
+        val request = requests[i];
+        int32_t reply_id = take_reply_id();
+        int err;
+
+        if (request.hasOwnProperty("command")) {
+            vector<string> args = vecFromJSArray<string>(request["command"]);
+            vector<const char *> cmd;
+            for (const string &arg : args)
+                cmd.push_back(arg.c_str());
+            cmd.push_back(NULL);
+
+            err = mpv_command_async(mpv, reply_id, cmd.data());
+        } else {
+            err = set_property_value(reply_id, request["property"].as<string>(), request["value"]);
+        }
+
+        ids.set(i, err < 0 ? err : reply_id);
+    }
+
+    return ids;
+}
+
+string error_string(int error) {
+    return mpv_error_string(error);
+}
+
+typedef struct {
+    uint32_t rate;
+    double seconds;
+} event_storm_args_t;
+
+void *event_storm_thread_gen(void *args) {
+    event_storm_args_t *storm = (event_storm_args_t *)args;
+    auto started = chrono::steady_clock::now();
+    auto until = started + chrono::duration<double>(storm->seconds);
+    int64_t sent = 0;
+
+    property_observe(mpv, EVENT_STORM_PROPERTY, MPV_FORMAT_INT64, { 0, 0, false });
+
+    for (auto now = started; now < until && !quitting; now = chrono::steady_clock::now()) {
+        int64_t due = (int64_t)(chrono::duration<double>(now - started).count() * storm->rate);
+        for (; sent < due; sent++) {
+            int64_t value = sent;
+            mpv_set_property_async(mpv, 0, EVENT_STORM_PROPERTY, MPV_FORMAT_INT64, &value);
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    property_unobserve(mpv, EVENT_STORM_PROPERTY);
+    printf("Event storm sent %lld changes in %.1f s\n", (long long)sent, storm->seconds);
+    delete storm;
+
+    return NULL;
+}
+
+// Debug load for frame time measurements: changes an observed user-data
+// property rate times a second for the given time. Every change goes
+// through the event thread and the ring to JS like any other property.
+void start_event_storm(uint32_t rate, double seconds) {
+    pthread_t thread;
+    pthread_create(&thread, NULL, event_storm_thread_gen, new event_storm_args_t { rate, seconds });
+    pthread_detach(thread);
+}
+
+// Returns whether display sync is used, which it isn't on software GL.
+bool set_frame_pacing(bool enabled) {
+    display_sync_requested = enabled;
+    wake_render(RENDER_WORK_PACING);
+
+    return enabled && !software_gl;
+}
+
+// Adaptive sizing needs the canvas's displayed size, which only JS knows.
+void set_render_size(bool adaptive, bool budget) {
+    adaptive_render_size = adaptive;
+    render_budget = budget;
+    wake_render(RENDER_WORK_RESIZE);
+}
+
+void set_display_size(int w, int h) {
+    display_width = w;
+    display_height = h;
+    if (adaptive_render_size)
+        wake_render(RENDER_WORK_RESIZE);
+}
+
+// Released seek bar. Coalesced with whatever seek is still in flight.
 void set_playback_time_pos(double time) {
-    mpv_set_property_async(mpv, 0, "playback-time", MPV_FORMAT_DOUBLE, &time);
+    seek_request(mpv, time, true);
+}
+
+// Seek bar being dragged: keyframes only, so each step is cheap.
+void scrub_playback_time(double time) {
+    seek_request(mpv, time, false);
+}
+
+// Runs on the side thread, since the index lookup reads from the file system.
+void seek_keyframe_proxy(void *args) {
+    double time = *(double *)args;
+    delete (double *)args;
+
+    char *path = mpv_get_property_string(mpv, "path");
+    if (path)
+        keyframe_index_find(path, time, false, &time);
+    mpv_free(path);
+
+    string target = to_string(time);
+    const char * cmd[] = {"seek", target.c_str(), "absolute+keyframes", NULL};
+    mpv_command_async(mpv, 0, cmd);
+}
+
+void seek_keyframe(double time) {
+    emscripten_proxy_async(main_queue, side_thread, seek_keyframe_proxy, new double(time));
 }
 
 void set_ao_volume(double volume) {
@@ -470,48 +954,87 @@ void skip_backward() {
     mpv_command_async(mpv, 0, cmd);
 }
 
+// An empty name clears the shaders.
+bool apply_shader_preset(string name) {
+    string paths;
+    if (!name.empty() && !shader_preset_paths(name, &paths)) {
+        fprintf(stderr, "Shader preset %s isn't available\n", name.c_str());
+        return false;
+    }
+
+    shader_preset_begin(name);
+
+    const char * cmd[] = {"change-list", "glsl-shaders", name.empty() ? "clr" : "set", paths.c_str(), NULL};
+    if (mpv_command_async(mpv, SHADER_PRESET_REPLY_ID, cmd) < 0)
+        return false;
+
+    upscaling_shaders = !name.empty();
+    wake_render(RENDER_WORK_RESIZE);
+    return true;
+}
+
+// Picking a preset by hand ends adaptive tiers until they're turned on again.
+bool choose_shader_preset(string name) {
+    shader_tiers_disable();
+    return apply_shader_preset(name);
+}
+
+// tiers are preset names from best to cheapest, or empty for the default
+// Anime4K chain. Turning it off keeps whatever preset is active.
+void set_adaptive_shaders(bool enabled, val tiers) {
+    if (!enabled) {
+        shader_tiers_disable();
+        return;
+    }
+
+    vector<string> names = tiers.isUndefined() ? vector<string>() : vecFromJSArray<string>(tiers);
+    string preset;
+    if (shader_tiers_set(names.empty() ? SHADER_DEFAULT_TIERS : names, true, &preset))
+        apply_shader_preset(preset);
+}
+
+// The first available preset in the manifest.
 void add_shaders() {
-    const char *shader_list = "/shaders/Anime4K_Clamp_Highlights.glsl:/shaders/Anime4K_Restore_CNN_VL.glsl:/shaders/Anime4K_Upscale_CNN_x2_VL.glsl:/shaders/Anime4K_AutoDownscalePre_x2.glsl:/shaders/Anime4K_AutoDownscalePre_x4.glsl:/shaders/Anime4K_Upscale_CNN_x2_M.glsl";
-    const char * cmd[] = {"change-list", "glsl-shaders", "set", shader_list, NULL};
-    mpv_command_async(mpv, 0, cmd);
+    shader_tiers_disable();
+    for (const shader_preset_t &preset : shader_presets_get()) {
+        if (preset.available) {
+            apply_shader_preset(preset.name);
+            return;
+        }
+    }
 }
 
 void clear_shaders() {
-    const char * cmd[] = {"change-list", "glsl-shaders", "clr", "", NULL};
-    mpv_command_async(mpv, 0, cmd);
+    choose_shader_preset("");
 }
 
 int get_shader_count() {
-    auto dirIter = std::filesystem::directory_iterator("/shaders");
-
-    int fileCount = std::count_if(
-        begin(dirIter),
-        end(dirIter),
-        [](auto& entry) { return entry.is_regular_file(); }
-    );
-
-    return fileCount - 1;
+    return shader_inventory_count();
 }
 
-intptr_t get_main_thread() {
-    return (intptr_t)main_thread;
+// The thread JS listens to for event and node messages.
+intptr_t get_event_thread() {
+    return (intptr_t)event_thread;
 }
 
 static void *get_proc_address_mpv(void *fn_ctx, const char *name) {
     return (void *)SDL_GL_GetProcAddress(name);
 }
 
-static void on_mpv_events(void *ctx) {
-    SDL_Event event = {.type = wakeup_on_mpv_events};
-    SDL_PushEvent(&event);
+static void on_mpv_render_update(void *ctx) {
+    wake_render(RENDER_WORK_UPDATE);
 }
 
-static void on_mpv_render_update(void *ctx) {
-    SDL_Event event = {.type = wakeup_on_mpv_render_update};
-    SDL_PushEvent(&event);
+static void on_library_update() {
+    library_update_pending = true;
+    mpv_wakeup(mpv);
 }
 
 void quit() {
+    quitting = true;
+    mpv_wakeup(mpv);
+    pthread_join(event_thread, NULL);
+
     mpv_render_context_free(mpv_gl);
     mpv_destroy(mpv);
 
@@ -525,71 +1048,107 @@ void quit() {
 }
 
 void match_window_screen_size() {
-    emscripten_get_screen_size(&width, &height);
-        
+    wake_render(RENDER_WORK_RESIZE);
+}
+
+// Runs on the render thread, which owns the window. The canvas keeps the
+// video's aspect ratio either way, fitted to the screen's width or inside
+// the displayed canvas.
+void resize_render_target() {
     double aspect_ratio = (double)video_height / video_width;
-    int new_height = height;
-    if (aspect_ratio != (double)height / width)
-        new_height = aspect_ratio * width;
-
-    SDL_SetWindowSize(window, width, new_height);
-
-    // printf("video: %lldx%lld -> screen: %dx%d = canvas: %dx%d\n", video_width, video_height, width, height, width, new_height);
-}
-
-void create_mpv_map_obj(mpv_node_list *map) {
-    mpv_node node;
-    char* key;
-    int is_video = 0;
-    int is_first = 0;
-    int w = 16;
-    int h = 9;
-    EM_ASM(obj = {};);
-    for (int i = 0; i < map->num; i++) {
-        key = map->keys[i];
-        node = map->values[i];
-        if (strcmp(key, "id") == 0 && node.u.int64 == 1) 
-            is_first = 1;
-        if (strcmp(key, "type") == 0 && node.format == MPV_FORMAT_STRING && strcmp(node.u.string, "video") == 0) 
-            is_video = 1;
-        if (strcmp(key, "demux-w") == 0) 
-            w = node.u.int64;
-        if (strcmp(key, "demux-h") == 0) 
-            h = node.u.int64;
-        switch (node.format) {
-            case MPV_FORMAT_INT64:
-                EM_ASM({
-                    obj[UTF8ToString($0)] = $1.toString();
-                }, key, node.u.int64);
-                break;
-            case MPV_FORMAT_STRING:
-                EM_ASM({
-                    obj[UTF8ToString($0)] = UTF8ToString($1);
-                }, key, node.u.string);
-                break;
-            case MPV_FORMAT_FLAG:
-                EM_ASM({
-                    obj[UTF8ToString($0)] = $1;
-                }, key, node.u.flag);
-                break;
-            case MPV_FORMAT_DOUBLE:
-                EM_ASM({
-                    obj[UTF8ToString($0)] = $1;
-                }, key, node.u.double_);
-                break;
-            default:
-                printf("%s, format: %d\n", key, node.format);
+    int new_width, new_height;
+
+    if (!adaptive_render_size || display_width <= 0 || display_height <= 0) {
+        int screen_height;
+        emscripten_get_screen_size(&new_width, &screen_height);
+        new_height = aspect_ratio * new_width;
+        render_scale = 1;
+    } else {
+        new_width = display_width;
+        new_height = aspect_ratio * new_width;
+        if (new_height > display_height) {
+            new_height = display_height;
+            new_width = new_height / aspect_ratio;
+        }
+
+        // Past the video's own size, only upscaling shaders add detail.
+        if (!upscaling_shaders && new_width > video_width) {
+            new_width = video_width;
+            new_height = video_height;
         }
+
+        if (!render_budget)
+            render_scale = 1;
+        new_width *= render_scale;
+        new_height *= render_scale;
     }
 
-    if (is_video && is_first) {
-        video_width = w;
-        video_height = h;
+    width = max(new_width, 1);
+    height = max(new_height, 1);
+    SDL_SetWindowSize(window, width, height);
+    frame_stats_set_render_size(width, height, render_scale);
 
-        match_window_screen_size();
+    // printf("video: %lldx%lld -> canvas: %dx%d\n", (long long)video_width, (long long)video_height, width, height);
+}
+
+// The first video track's demuxer size decides the window's aspect.
+void update_video_size(mpv_node *track_list) {
+    if (track_list->format != MPV_FORMAT_NODE_ARRAY)
+        return;
+
+    mpv_node_list *list = track_list->u.list;
+    for (int i = 0; i < list->num; i++) {
+        if (list->values[i].format != MPV_FORMAT_NODE_MAP)
+            continue;
+
+        mpv_node_list *map = list->values[i].u.list;
+        bool is_first = false, is_video = false;
+        int w = 16, h = 9;
+
+        for (int j = 0; j < map->num; j++) {
+            const char *key = map->keys[j];
+            const mpv_node &node = map->values[j];
+
+            if (strcmp(key, "id") == 0 && node.format == MPV_FORMAT_INT64 && node.u.int64 == 1)
+                is_first = true;
+            if (strcmp(key, "type") == 0 && node.format == MPV_FORMAT_STRING && strcmp(node.u.string, "video") == 0)
+                is_video = true;
+            if (strcmp(key, "demux-w") == 0 && node.format == MPV_FORMAT_INT64)
+                w = node.u.int64;
+            if (strcmp(key, "demux-h") == 0 && node.format == MPV_FORMAT_INT64)
+                h = node.u.int64;
+        }
+
+        // The window belongs to the render thread.
+        if (is_video && is_first) {
+            video_width = w;
+            video_height = h;
+
+            wake_render(RENDER_WORK_RESIZE);
+            return;
+        }
     }
 }
 
+// The whole tree is serialized natively and crosses into JS as one
+// message. The buffer is kept between calls, so it's already large enough
+// after the first long track or chapter list.
+void post_node(const char *name, mpv_node *node) {
+    static string message;
+    message.clear();
+
+    message += "{\"type\":\"property-node\",\"name\":";
+    mpv_node name_node;
+    name_node.format = MPV_FORMAT_STRING;
+    name_node.u.string = (char *)name;
+    node_to_json(&name_node, message);
+    message += ",\"value\":";
+    node_to_json(node, message);
+    message += '}';
+
+    EM_ASM(postMessage(UTF8ToString($0, $1)), message.c_str(), message.size());
+}
+
 void *thumbnail_thread_gen(void *args) {
     string *path_ptr = (string *)(args);
     generate_thumbnail(path_ptr, 15);
@@ -605,6 +1164,258 @@ void create_thumbnail_thread(string path) {
     pthread_create(&thumbnail_thread, NULL, thumbnail_thread_gen, path_ptr);
 }
 
+typedef struct {
+    string path;
+    uint32_t count;
+    uint32_t tile_width;
+    uint32_t columns;
+    bool benchmark;
+    em_proxying_ctx *ctx;
+} storyboard_args_t;
+
+map<string, storyboard_t> storyboards;
+storyboard_benchmark_t last_storyboard_benchmark = { 0, 0, 0, 0, 0 };
+pthread_mutex_t storyboard_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void *storyboard_thread_gen(void *args) {
+    storyboard_args_t *storyboard_args = (storyboard_args_t *)args;
+    if (storyboard_args->benchmark) {
+        storyboard_benchmark_t benchmark = benchmark_storyboard(
+            storyboard_args->path, storyboard_args->count, storyboard_args->tile_width
+        );
+
+        pthread_mutex_lock(&storyboard_lock);
+        last_storyboard_benchmark = benchmark;
+        pthread_mutex_unlock(&storyboard_lock);
+
+        emscripten_proxy_finish(storyboard_args->ctx);
+        delete storyboard_args;
+        return NULL;
+    }
+
+    storyboard_t storyboard = generate_storyboard(
+        storyboard_args->path, storyboard_args->count, storyboard_args->tile_width, storyboard_args->columns
+    );
+
+    pthread_mutex_lock(&storyboard_lock);
+    storyboards[storyboard_args->path] = storyboard;
+    pthread_mutex_unlock(&storyboard_lock);
+
+    emscripten_proxy_finish(storyboard_args->ctx);
+    delete storyboard_args;
+
+    return NULL;
+}
+
+// Mounts on the side thread, then decodes on a thread of its own so the
+// side thread stays free for loads while the promise is pending.
+void storyboard_proxy(em_proxying_ctx *ctx, void *args) {
+    storyboard_args_t *storyboard_args = (storyboard_args_t *)args;
+    storyboard_args->ctx = ctx;
+
+    if (!mount_root(storyboard_args->path)) {
+        emscripten_proxy_finish(ctx);
+        delete storyboard_args;
+        return;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, storyboard_thread_gen, storyboard_args);
+    pthread_detach(thread);
+}
+
+uint32_t create_storyboard(string path, uint32_t count, uint32_t tile_width, uint32_t columns) {
+    storyboard_args_t *args = new storyboard_args_t { path, count, tile_width, columns, false, NULL };
+    return (uint32_t)emscripten_proxy_promise_with_ctx(main_queue, side_thread, storyboard_proxy, args);
+}
+
+uint32_t run_storyboard_benchmark(string path, uint32_t count, uint32_t tile_width) {
+    storyboard_args_t *args = new storyboard_args_t { path, count, tile_width, 0, true, NULL };
+    return (uint32_t)emscripten_proxy_promise_with_ctx(main_queue, side_thread, storyboard_proxy, args);
+}
+
+storyboard_benchmark_t get_storyboard_benchmark() {
+    pthread_mutex_lock(&storyboard_lock);
+    storyboard_benchmark_t benchmark = last_storyboard_benchmark;
+    pthread_mutex_unlock(&storyboard_lock);
+
+    return benchmark;
+}
+
+typedef struct {
+    DiscInfo disc;
+    string disc_path;
+    uint32_t playlist_id;
+    int width;
+    em_proxying_ctx *ctx;
+} chapter_args_t;
+
+void *chapter_thumbnails_thread_gen(void *args) {
+    chapter_args_t *chapter_args = (chapter_args_t *)args;
+    bd_chapter_thumbnails(chapter_args->disc, chapter_args->disc_path, chapter_args->playlist_id, chapter_args->width);
+
+    emscripten_proxy_finish(chapter_args->ctx);
+    delete chapter_args;
+
+    return NULL;
+}
+
+// The disc is captured on the side thread, after any open queued before
+// this, then the batch moves to a thread of its own.
+void chapter_thumbnails_proxy(em_proxying_ctx *ctx, void *args) {
+    chapter_args_t *chapter_args = (chapter_args_t *)args;
+    chapter_args->disc = get_open_disc(&chapter_args->disc_path);
+    chapter_args->ctx = ctx;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, chapter_thumbnails_thread_gen, chapter_args);
+    pthread_detach(thread);
+}
+
+uint32_t create_chapter_thumbnails(uint32_t playlist_id, int width) {
+    chapter_args_t *args = new chapter_args_t { DiscInfo(), "", playlist_id, width, NULL };
+    return (uint32_t)emscripten_proxy_promise_with_ctx(main_queue, side_thread, chapter_thumbnails_proxy, args);
+}
+
+vector<bd_chapter_thumbnail_t> get_chapter_thumbnails(uint32_t playlist_id, int width) {
+    string path;
+    get_open_disc(&path);
+    return bd_get_chapter_thumbnails(path, playlist_id, width);
+}
+
+typedef struct {
+    DiscInfo disc;
+    string disc_path;
+    em_proxying_ctx *ctx;
+} menu_backgrounds_args_t;
+
+void *menu_backgrounds_thread_gen(void *args) {
+    menu_backgrounds_args_t *backgrounds_args = (menu_backgrounds_args_t *)args;
+    bd_menu_backgrounds(backgrounds_args->disc, backgrounds_args->disc_path);
+
+    emscripten_proxy_finish(backgrounds_args->ctx);
+    delete backgrounds_args;
+
+    return NULL;
+}
+
+// Captures the open disc on the side thread, like chapter thumbnails.
+void menu_backgrounds_proxy(em_proxying_ctx *ctx, void *args) {
+    menu_backgrounds_args_t *backgrounds_args = (menu_backgrounds_args_t *)args;
+    backgrounds_args->disc = get_open_disc(&backgrounds_args->disc_path);
+    backgrounds_args->ctx = ctx;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, menu_backgrounds_thread_gen, backgrounds_args);
+    pthread_detach(thread);
+}
+
+uint32_t create_menu_backgrounds() {
+    menu_backgrounds_args_t *args = new menu_backgrounds_args_t { DiscInfo(), "", NULL };
+    return (uint32_t)emscripten_proxy_promise_with_ctx(main_queue, side_thread, menu_backgrounds_proxy, args);
+}
+
+string get_menu_background(uint32_t playlist_id) {
+    string path;
+    get_open_disc(&path);
+    return bd_get_menu_background(path, playlist_id);
+}
+
+typedef struct {
+    double time;
+    int width;
+} scrub_args_t;
+
+shared_ptr<const scrub_frame_t> scrub_frame;
+
+void finish_scrub_request(void *ctx) {
+    emscripten_proxy_finish((em_proxying_ctx *)ctx);
+}
+
+void scrub_request_proxy(em_proxying_ctx *ctx, void *args) {
+    scrub_args_t *scrub_args = (scrub_args_t *)args;
+    scrub_preview_request(scrub_args->time, scrub_args->width, finish_scrub_request, ctx);
+    delete scrub_args;
+}
+
+// Resolves when this request is decoded or superseded by a newer one.
+uint32_t request_scrub_preview(double time, int width) {
+    return (uint32_t)emscripten_proxy_promise_with_ctx(main_queue, side_thread, scrub_request_proxy, new scrub_args_t { time, width });
+}
+
+// The RGBA view points into the cached frame, which stays held until the
+// next call.
+val get_scrub_preview() {
+    double time;
+    scrub_frame = scrub_preview_get(&time);
+    if (!scrub_frame)
+        return val::null();
+
+    val preview = val::object();
+    preview.set("time", time);
+    preview.set("keyframeTime", scrub_frame->keyframe_time);
+    preview.set("width", scrub_frame->width);
+    preview.set("height", scrub_frame->height);
+    preview.set("data", val(typed_memory_view(scrub_frame->rgba.size(), scrub_frame->rgba.data())));
+
+    return preview;
+}
+
+typedef struct {
+    string path;
+    uint32_t audio_track;
+    uint32_t buckets;
+    bool loudness;
+} waveform_args_t;
+
+shared_ptr<const waveform_t> waveform;
+
+void finish_waveform_request(void *ctx) {
+    emscripten_proxy_finish((em_proxying_ctx *)ctx);
+}
+
+void waveform_proxy(em_proxying_ctx *ctx, void *args) {
+    waveform_args_t *waveform_args = (waveform_args_t *)args;
+
+    if (mount_root(waveform_args->path))
+        waveform_request(waveform_args->path, waveform_args->audio_track, waveform_args->buckets, waveform_args->loudness, finish_waveform_request, ctx);
+    else
+        emscripten_proxy_finish(ctx);
+
+    delete waveform_args;
+}
+
+uint32_t create_waveform(string path, uint32_t audio_track, uint32_t buckets, bool loudness) {
+    waveform_args_t *args = new waveform_args_t { path, audio_track, buckets, loudness };
+    return (uint32_t)emscripten_proxy_promise_with_ctx(main_queue, side_thread, waveform_proxy, args);
+}
+
+// The views point into the cached overview, which is also held here until
+// the next call.
+val get_waveform(string path, uint32_t audio_track, uint32_t buckets, bool loudness) {
+    waveform = waveform_get(path, audio_track, buckets, loudness);
+    if (!waveform)
+        return val::null();
+
+    val result = val::object();
+    result.set("buckets", waveform->buckets);
+    result.set("bucketDuration", waveform->bucket_duration);
+    result.set("peaks", val(typed_memory_view(waveform->peaks.size(), waveform->peaks.data())));
+    result.set("rms", val(typed_memory_view(waveform->rms.size(), waveform->rms.data())));
+    result.set("loudness", val(typed_memory_view(waveform->loudness.size(), waveform->loudness.data())));
+
+    return result;
+}
+
+storyboard_t get_storyboard(string path) {
+    pthread_mutex_lock(&storyboard_lock);
+    auto it = storyboards.find(path);
+    storyboard_t storyboard = it != storyboards.end() ? it->second : storyboard_t { 0, 0, 0, 0 };
+    pthread_mutex_unlock(&storyboard_lock);
+
+    return storyboard;
+}
+
 void die(const char *msg) {
     fprintf(stderr, "%s\n", msg);
     exit(1);
@@ -618,41 +1429,135 @@ EMSCRIPTEN_BINDINGS(libmpv) {
     // emscripten::function("loadUrl", &load_url);
     emscripten::function("togglePlay", &toggle_play);
     emscripten::function("stop", &stop);
+    emscripten::function("observeProperty", &observe_property);
+    emscripten::function("unobserveProperty", &unobserve_property);
+    emscripten::function("submitRequests", &submit_requests);
+    emscripten::function("errorString", &error_string);
     emscripten::function("setPlaybackTime", &set_playback_time_pos);
+    emscripten::function("scrubPlaybackTime", &scrub_playback_time);
+    emscripten::function("seekKeyframe", &seek_keyframe);
     emscripten::function("setVolume", &set_ao_volume);
     emscripten::function("getTracks", &get_tracks);
     emscripten::function("getChapters", &get_chapters);
+    emscripten::function("getMetadata", &get_metadata);
     emscripten::function("setVideoTrack", &set_video_track);
     emscripten::function("setAudioTrack", &set_audio_track);
     emscripten::function("setSubtitleTrack", &set_subtitle_track);
     emscripten::function("setChapter", &set_chapter);
     emscripten::function("skipForward", &skip_forward);
     emscripten::function("skipBackward", &skip_backward);
-    emscripten::function("getMpvThread", &get_main_thread);
+    emscripten::function("getMpvThread", &get_event_thread);
     emscripten::function("addShaders", &add_shaders);
     emscripten::function("clearShaders", &clear_shaders);
     emscripten::function("getShaderCount", &get_shader_count);
     emscripten::function("matchWindowScreenSize", &match_window_screen_size);
     emscripten::function("createThumbnail", &create_thumbnail_thread);
 
+    register_vector<double>("DoubleVector");
+
+    value_object<storyboard_t>("Storyboard")
+        .field("tileWidth", &storyboard_t::tile_width)
+        .field("tileHeight", &storyboard_t::tile_height)
+        .field("columns", &storyboard_t::columns)
+        .field("rows", &storyboard_t::rows)
+        .field("times", &storyboard_t::times)
+        .field("sprite", &storyboard_t::sprite);
+
+    emscripten::function("createStoryboard", &create_storyboard);
+    emscripten::function("getStoryboard", &get_storyboard);
+
+    value_object<storyboard_benchmark_t>("StoryboardBenchmark")
+        .field("tiles", &storyboard_benchmark_t::tiles)
+        .field("duration", &storyboard_benchmark_t::duration)
+        .field("storyboardTime", &storyboard_benchmark_t::storyboard_time)
+        .field("linearTime", &storyboard_benchmark_t::linear_time)
+        .field("linearFrames", &storyboard_benchmark_t::linear_frames);
+
+    emscripten::function("benchmarkStoryboard", &run_storyboard_benchmark);
+    emscripten::function("getStoryboardBenchmark", &get_storyboard_benchmark);
+
+    emscripten::function("createWaveform", &create_waveform);
+    emscripten::function("getWaveform", &get_waveform);
+
+    emscripten::function("requestScrubPreview", &request_scrub_preview);
+    emscripten::function("getScrubPreview", &get_scrub_preview);
+
+    register_vector<bd_chapter_thumbnail_t>("ChapterThumbnailVector");
+
+    value_object<bd_chapter_thumbnail_t>("ChapterThumbnail")
+        .field("markIdx", &bd_chapter_thumbnail_t::mark_idx)
+        .field("time", &bd_chapter_thumbnail_t::time)
+        .field("image", &bd_chapter_thumbnail_t::image);
+
+    emscripten::function("createChapterThumbnails", &create_chapter_thumbnails);
+    emscripten::function("getChapterThumbnails", &get_chapter_thumbnails);
+
+    emscripten::function("createMenuBackgrounds", &create_menu_backgrounds);
+    emscripten::function("getMenuBackground", &get_menu_background);
+
+    value_object<event_ring_info_t>("EventRingInfo")
+        .field("records", &event_ring_info_t::records)
+        .field("head", &event_ring_info_t::head)
+        .field("tail", &event_ring_info_t::tail)
+        .field("capacity", &event_ring_info_t::capacity)
+        .field("recordSize", &event_ring_info_t::record_size);
+
+    emscripten::function("eventRingInfo", &event_ring_get_info);
+    emscripten::function("eventRingPropertyName", &event_ring_property_name);
+
+    value_object<seek_stats_t>("SeekStats")
+        .field("seeks", &seek_stats_t::seeks)
+        .field("coalesced", &seek_stats_t::coalesced)
+        .field("lastLatency", &seek_stats_t::last_latency)
+        .field("averageLatency", &seek_stats_t::average_latency)
+        .field("maxLatency", &seek_stats_t::max_latency);
+
+    emscripten::function("getSeekStats", &seek_get_stats);
+
+    value_object<frame_stats_t>("FrameStats")
+        .field("frames", &frame_stats_t::frames)
+        .field("averageTime", &frame_stats_t::average_time)
+        .field("maxTime", &frame_stats_t::max_time)
+        .field("histogram", &frame_stats_t::histogram)
+        .field("displaySync", &frame_stats_t::display_sync)
+        .field("vsyncInterval", &frame_stats_t::vsync_interval)
+        .field("missedFrames", &frame_stats_t::missed_frames)
+        .field("renderWidth", &frame_stats_t::render_width)
+        .field("renderHeight", &frame_stats_t::render_height)
+        .field("renderScale", &frame_stats_t::render_scale);
+
+    emscripten::function("getFrameStats", &frame_stats_get);
+    emscripten::function("resetFrameStats", &frame_stats_reset);
+    emscripten::function("startEventStorm", &start_event_storm);
+    emscripten::function("setFramePacing", &set_frame_pacing);
+    emscripten::function("setRenderSize", &set_render_size);
+    emscripten::function("setDisplaySize", &set_display_size);
+
+    register_vector<shader_preset_t>("ShaderPresetVector");
+
+    value_object<shader_preset_t>("ShaderPreset")
+        .field("name", &shader_preset_t::name)
+        .field("shaders", &shader_preset_t::shaders)
+        .field("available", &shader_preset_t::available);
+
+    value_object<shader_state_t>("ShaderState")
+        .field("active", &shader_state_t::active)
+        .field("latency", &shader_state_t::latency);
+
+    emscripten::function("getShaderPresets", &shader_presets_get);
+    emscripten::function("applyShaderPreset", &choose_shader_preset);
+    emscripten::function("setAdaptiveShaders", &set_adaptive_shaders);
+    emscripten::function("getShaderState", &shader_preset_state);
+
     register_vector<uint16_t>("UInt16Vector");
     register_vector<uint32_t>("UInt32Vector");
     register_vector<bluray_mobj_cmd_t>("MobjCmdVector");
-    register_vector<bluray_mobj_object_t>("MobjObjectVector");
-    register_vector<effect_object_t>("EffectObjectVector");
-    register_vector<effect_t>("EffectVector");
-    register_vector<bog_t>("BogVector");
-    register_vector<page_t>("PageVector");
-    register_vector<color_t>("ColorVector");
-    register_vector<vector<color_t>>("PaletteVector");
     register_vector<BLURAY_TITLE_MARK>("BlurayTitleMarkVector");
     register_vector<bluray_clip_info_t>("BlurayClipInfoVector");
+    register_vector<hdmv_action_t>("HdmvActionVector");
+    register_vector<bluray_stream_attr_t>("StreamAttrVector");
 
-    register_map<string, window_t>("WindowMap");
     register_map<string, string>("StringMap");
-    register_map<string, picture_extended_t>("PictureMap");
-    register_map<string, button_t>("ButtonMap");
-    register_map<string, bluray_playlist_info_t>("BlurayPlaylistMap");
 
     value_object<bluray_hdmv_insn_t>("HdmvInsn")
         .field("opCnt", &bluray_hdmv_insn_t::op_cnt)
@@ -676,11 +1581,6 @@ EMSCRIPTEN_BINDINGS(libmpv) {
         .field("numCmds", &bluray_mobj_object_t::num_cmds)
         .field("cmds", &bluray_mobj_object_t::cmds);
 
-    value_object<bluray_mobj_objects_t>("MobjObjects")
-        .field("mobjVersion", &bluray_mobj_objects_t::mobj_version)
-        .field("numObjects", &bluray_mobj_objects_t::num_objects)
-        .field("objects", &bluray_mobj_objects_t::objects);
-
     value_object<button_navigation_t>("ButtonNavigation")
         .field("up", &button_navigation_t::up)
         .field("down", &button_navigation_t::down)
@@ -707,59 +1607,20 @@ EMSCRIPTEN_BINDINGS(libmpv) {
         .field("cmdsCount", &button_t::cmds_count)
         .field("commands", &button_t::commands);
 
-    value_object<bog_t>("Bog")
-        .field("defButton", &bog_t::def_button)
-        .field("buttonCount", &bog_t::button_count)
-        .field("buttonIds", &bog_t::button_ids);
-
-    value_object<window_t>("Window")
-        .field("id", &window_t::id)
-        .field("x", &window_t::x)
-        .field("y", &window_t::y)
-        .field("width", &window_t::width)
-        .field("height", &window_t::height);
-
-    value_object<effect_object_t>("EffectObject")
-        .field("id", &effect_object_t::id)
-        .field("window", &effect_object_t::window)
-        .field("x", &effect_object_t::x)
-        .field("y", &effect_object_t::y);
-
-    value_object<effect_t>("Effect")
-        .field("duration", &effect_t::duration)
-        .field("palette", &effect_t::palette)
-        .field("objectCount", &effect_t::object_count)
-        .field("objects", &effect_t::objects);
-
-    value_object<window_effect_t>("WindowEffect")
-        .field("windows", &window_effect_t::windows)
-        .field("effects", &window_effect_t::effects);
-
-    value_object<page_t>("Page")
-        .field("id", &page_t::id)
-        .field("uo", &page_t::uo)
-        .field("inEffects", &page_t::in_effects)
-        .field("outEffects", &page_t::out_effects)
-        .field("framerateDivider", &page_t::framerate_divider)
-        .field("defButton", &page_t::def_button)
-        .field("defActivated", &page_t::def_activated)
-        .field("palette", &page_t::palette)
-        .field("bogCount", &page_t::bog_count)
-        .field("bogs", &page_t::bogs)
-        .field("buttons", &page_t::buttons);
-
-    value_object<menu_t>("Menu")
-        .field("width", &menu_t::width)
-        .field("height", &menu_t::height)
-        .field("pageCount", &menu_t::page_count)
-        .field("pages", &menu_t::pages);
-
-    value_object<color_t>("Color")
-        .field("id", &color_t::id)
-        .field("r", &color_t::r)
-        .field("g", &color_t::g)
-        .field("b", &color_t::b)
-        .field("alpha", &color_t::alpha);
+    value_object<menu_info_t>("MenuInfo")
+        .field("width", &menu_info_t::width)
+        .field("height", &menu_info_t::height)
+        .field("pageCount", &menu_info_t::page_count);
+
+    value_object<page_info_t>("PageInfo")
+        .field("id", &page_info_t::id)
+        .field("framerateDivider", &page_info_t::framerate_divider)
+        .field("defButton", &page_info_t::def_button)
+        .field("defActivated", &page_info_t::def_activated)
+        .field("palette", &page_info_t::palette)
+        .field("bogCount", &page_info_t::bog_count)
+        .field("inEffectsDuration", &page_info_t::in_effects_duration)
+        .field("outEffectsDuration", &page_info_t::out_effects_duration);
 
     value_object<picture_extended_t>("Picture")
         .field("id", &picture_extended_t::id)
@@ -767,11 +1628,6 @@ EMSCRIPTEN_BINDINGS(libmpv) {
         .field("height", &picture_extended_t::height)
         .field("data", &picture_extended_t::data);
 
-    value_object<igs_t>("Igs")
-        .field("menu", &igs_t::menu)
-        .field("palettes", &igs_t::palettes)
-        .field("pictures", &igs_t::pictures);
-
     value_object<BLURAY_TITLE_MARK>("BlurayTitleMark")
         .field("idx", &BLURAY_TITLE_MARK::idx)
         .field("type", &BLURAY_TITLE_MARK::type)
@@ -785,21 +1641,151 @@ EMSCRIPTEN_BINDINGS(libmpv) {
         .field("inTime", &bluray_clip_info_t::in_time)
         .field("outTime", &bluray_clip_info_t::out_time);
 
-    value_object<bluray_playlist_info_t>("BlurayPlaylistInfo")
-        .field("clips", &bluray_playlist_info_t::clips)
-        .field("marks", &bluray_playlist_info_t::marks)
-        .field("igs", &bluray_playlist_info_t::igs);
-
-    value_object<bluray_disc_info_t>("BlurayDiscInfo")
-        .field("discName", &bluray_disc_info_t::disc_name)
-        .field("numPlaylists", &bluray_disc_info_t::num_playlists)
-        .field("firstPlaySupported", &bluray_disc_info_t::first_play_supported)
-        .field("firstPlayIdx", &bluray_disc_info_t::first_play_idx)
-        .field("topMenuSupported", &bluray_disc_info_t::top_menu_supported)
-        .field("titleMap", &bluray_disc_info_t::title_map)
-        .field("playlists", &bluray_disc_info_t::playlists)
-        .field("mobjObjects", &bluray_disc_info_t::mobj);
+    value_object<bluray_stream_attr_t>("StreamAttr")
+        .field("pid", &bluray_stream_attr_t::pid)
+        .field("codingType", &bluray_stream_attr_t::coding_type)
+        .field("lang", &bluray_stream_attr_t::lang)
+        .field("trackId", &bluray_stream_attr_t::track_id);
+
+    value_object<time_entry_t>("TimeEntry")
+        .field("time", &time_entry_t::time)
+        .field("playItem", &time_entry_t::play_item);
+
+    class_<DiscInfo>("DiscInfo")
+        .property("discName", &DiscInfo::disc_name)
+        .property("numPlaylists", &DiscInfo::num_playlists)
+        .property("firstPlaySupported", &DiscInfo::first_play_supported)
+        .property("firstPlayIdx", &DiscInfo::first_play_idx)
+        .property("topMenuSupported", &DiscInfo::top_menu_supported)
+        .property("numTitles", &DiscInfo::num_titles)
+        .property("numObjects", &DiscInfo::num_objects)
+        .function("getTitleObject", &DiscInfo::get_title_object)
+        .function("getObject", &DiscInfo::get_object)
+        .function("getObjectCommandCount", &DiscInfo::get_object_command_count)
+        .function("getObjectCommand", &DiscInfo::get_object_command)
+        .function("getPlaylistIds", &DiscInfo::get_playlist_ids)
+        .function("hasPlaylist", &DiscInfo::has_playlist)
+        .function("getClipCount", &DiscInfo::get_clip_count)
+        .function("getClip", &DiscInfo::get_clip)
+        .function("getClips", &DiscInfo::get_clips)
+        .function("getMarkCount", &DiscInfo::get_mark_count)
+        .function("getMark", &DiscInfo::get_mark)
+        .function("findTimeEntry", &DiscInfo::find_time_entry)
+        .function("findPlayItem", &DiscInfo::find_play_item)
+        .function("findChapter", &DiscInfo::find_chapter)
+        .function("getPlayItemTime", &DiscInfo::get_play_item_time)
+        .function("getLikelyPlaylists", &DiscInfo::get_likely_playlists)
+        .function("getAudioStreams", &DiscInfo::get_audio_streams)
+        .function("getPgStreams", &DiscInfo::get_pg_streams)
+        .function("getAudioTrack", &DiscInfo::get_audio_track)
+        .function("getPgTrack", &DiscInfo::get_pg_track)
+        .function("findAudioStream", &DiscInfo::find_audio_stream)
+        .function("findPgStream", &DiscInfo::find_pg_stream)
+        .function("getMenuInfo", &DiscInfo::get_menu_info)
+        .function("getPage", &DiscInfo::get_page)
+        .function("getPageDefaultButtons", &DiscInfo::get_page_default_buttons)
+        .function("getButtonGroup", &DiscInfo::get_button_group)
+        .function("hasButton", &DiscInfo::has_button)
+        .function("getButton", &DiscInfo::get_button)
+        .function("getPictureIds", &DiscInfo::get_picture_ids)
+        .function("getPicture", &DiscInfo::get_picture);
+
+    enum_<hdmv_action_type>("HdmvActionType")
+        .value("PLAY_PL", HDMV_ACTION_PLAY_PL)
+        .value("STOP", HDMV_ACTION_STOP)
+        .value("MENU_PAGE", HDMV_ACTION_MENU_PAGE)
+        .value("BUTTON_STATE", HDMV_ACTION_BUTTON_STATE)
+        .value("POPUP_OFF", HDMV_ACTION_POPUP_OFF)
+        .value("SET_STREAM", HDMV_ACTION_SET_STREAM);
+
+    enum_<hdmv_direction>("HdmvDirection")
+        .value("UP", HDMV_DIRECTION_UP)
+        .value("DOWN", HDMV_DIRECTION_DOWN)
+        .value("LEFT", HDMV_DIRECTION_LEFT)
+        .value("RIGHT", HDMV_DIRECTION_RIGHT);
+
+    value_object<hdmv_action_t>("HdmvAction")
+        .field("type", &hdmv_action_t::type)
+        .field("playlist", &hdmv_action_t::playlist)
+        .field("playItem", &hdmv_action_t::play_item)
+        .field("start", &hdmv_action_t::start)
+        .field("audioFlag", &hdmv_action_t::audio_flag)
+        .field("audioStream", &hdmv_action_t::audio_stream)
+        .field("pgFlag", &hdmv_action_t::pg_flag)
+        .field("pgDisplay", &hdmv_action_t::pg_display)
+        .field("pgStream", &hdmv_action_t::pg_stream)
+        .field("page", &hdmv_action_t::page)
+        .field("button", &hdmv_action_t::button)
+        .field("delay", &hdmv_action_t::delay);
+
+    value_object<hdmv_state_t>("HdmvState")
+        .field("title", &hdmv_state_t::title)
+        .field("object", &hdmv_state_t::object)
+        .field("objectPc", &hdmv_state_t::object_pc)
+        .field("playlist", &hdmv_state_t::playlist)
+        .field("playItem", &hdmv_state_t::play_item)
+        .field("menuPage", &hdmv_state_t::menu_page)
+        .field("menuSelected", &hdmv_state_t::menu_selected)
+        .field("menuActivated", &hdmv_state_t::menu_activated)
+        .field("menuCallAllow", &hdmv_state_t::menu_call_allow)
+        .field("hasPopupMenu", &hdmv_state_t::has_popup_menu)
+        .field("hasResume", &hdmv_state_t::has_resume);
+
+    class_<HdmvVm>("HdmvVm")
+        .constructor<DiscInfo>()
+        .function("start", &HdmvVm::start)
+        .function("playlistEnd", &HdmvVm::playlist_end)
+        .function("runCommand", &HdmvVm::run_command)
+        .function("topMenu", &HdmvVm::top_menu)
+        .function("resume", &HdmvVm::resume)
+        .function("playMark", &HdmvVm::play_mark)
+        .function("popupOn", &HdmvVm::popup_on)
+        .function("popupOff", &HdmvVm::popup_off)
+        .function("selectButton", &HdmvVm::select_button)
+        .function("moveSelection", &HdmvVm::move_selection)
+        .function("activateButton", &HdmvVm::activate_button)
+        .function("setPlaybackPosition", &HdmvVm::set_playback_position)
+        .function("setAudioStream", &HdmvVm::set_audio_stream)
+        .function("setPgStream", &HdmvVm::set_pg_stream)
+        .function("getPsr", &HdmvVm::get_psr)
+        .function("getGpr", &HdmvVm::get_gpr)
+        .function("getState", &HdmvVm::get_state)
+        .function("getButtonState", &HdmvVm::get_button_state)
+        .function("getLikelyPlaylists", &HdmvVm::get_likely_playlists);
 
     emscripten::function("bdOpen", &open_disc);
     emscripten::function("bdGetInfo", &get_disc_info);
+    emscripten::function("bdLoadPlaylist", &load_bd_playlist);
+    emscripten::function("bdPlaylistUri", &bd_stream_uri);
+    emscripten::function("bdPrefetch", &prefetch_bd_clips);
+
+    register_vector<bd_clip_gap_t>("ClipGapVector");
+
+    value_object<bd_clip_gap_t>("ClipGap")
+        .field("playlistId", &bd_clip_gap_t::playlist_id)
+        .field("playItem", &bd_clip_gap_t::play_item)
+        .field("gap", &bd_clip_gap_t::gap);
+
+    emscripten::function("bdTakeClipGaps", &bd_stream_take_gaps);
+
+    register_vector<library_entry_t>("LibraryEntryVector");
+
+    value_object<library_entry_t>("LibraryEntry")
+        .field("path", &library_entry_t::path)
+        .field("isDisc", &library_entry_t::is_disc)
+        .field("removed", &library_entry_t::removed)
+        .field("size", &library_entry_t::size)
+        .field("mtime", &library_entry_t::mtime)
+        .field("duration", &library_entry_t::duration)
+        .field("title", &library_entry_t::title)
+        .field("videoCodec", &library_entry_t::video_codec)
+        .field("audioCodec", &library_entry_t::audio_codec)
+        .field("width", &library_entry_t::width)
+        .field("height", &library_entry_t::height)
+        .field("titleCount", &library_entry_t::title_count)
+        .field("poster", &library_entry_t::poster);
+
+    emscripten::function("libraryScan", &scan_library);
+    emscripten::function("libraryTakeUpdates", &library_take_updates);
+    emscripten::function("libraryGetEntries", &library_get_entries);
 }
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "media_library.h"
+
+typedef struct library_job_t {
+    string path;
+    bool is_disc;
+    int64_t size;
+    int64_t mtime;
+} library_job_t;
+
+static const set<string> media_extensions = {
+    ".mkv", ".mp4", ".m4v", ".webm", ".avi", ".mov", ".wmv", ".flv", ".ogv",
+    ".ts", ".m2ts", ".mts", ".mpg", ".mpeg", ".vob",
+    ".mp3", ".flac", ".ogg", ".opus", ".m4a", ".wav",
+};
+
+static map<string, library_entry_t> entries;
+static vector<library_entry_t> updates;
+static deque<library_job_t> jobs;
+static set<string> seen;
+static string scan_root;
+static uint32_t pending_jobs = 0;
+static bool walking = false;
+static bool scanning = false;
+static bool workers_running = false;
+static pthread_t workers[LIBRARY_WORKERS];
+static void (*notify)() = NULL;
+static pthread_mutex_t library_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cond = PTHREAD_COND_INITIALIZER;
+
+static const char *bd_video_codec(uint8_t coding_type) {
+    switch (coding_type) {
+        case 0x01: return "mpeg1video";
+        case 0x02: return "mpeg2video";
+        case 0x1B: return "h264";
+        case 0x20: return "h264";
+        case 0x24: return "hevc";
+        case 0xEA: return "vc1";
+        default: return "";
+    }
+}
+
+static const char *bd_audio_codec(uint8_t coding_type) {
+    switch (coding_type) {
+        case 0x03: return "mp2";
+        case 0x04: return "mp2";
+        case 0x80: return "pcm_bluray";
+        case 0x81: return "ac3";
+        case 0x82: return "dts";
+        case 0x83: return "truehd";
+        case 0x84: return "eac3";
+        case 0x85: return "dts";
+        case 0x86: return "dts";
+        case 0xA1: return "eac3";
+        case 0xA2: return "dts";
+        default: return "";
+    }
+}
+
+static void bd_video_size(uint8_t format, uint32_t *width, uint32_t *height) {
+    switch (format) {
+        case 1: case 3: *width = 720; *height = 480; break;
+        case 2: case 7: *width = 720; *height = 576; break;
+        case 4: case 6: *width = 1920; *height = 1080; break;
+        case 5: *width = 1280; *height = 720; break;
+        case 8: *width = 3840; *height = 2160; break;
+        default: *width = 0; *height = 0;
+    }
+}
+
+static string get_poster(video_decoder_t *decoder) {
+    double duration = decoder->format->duration != AV_NOPTS_VALUE
+        ? (double)decoder->format->duration / AV_TIME_BASE
+        : 0;
+
+    AVFrame *frame = decode_frame_at(decoder, duration * LIBRARY_POSTER_POSITION);
+    if (!frame)
+        return "";
+
+    string poster = encode_frame_png(frame, LIBRARY_POSTER_WIDTH);
+    av_frame_free(&frame);
+
+    return poster;
+}
+
+static void probe_file(library_entry_t &entry) {
+    entry.title = filesystem::path(entry.path).stem().string();
+
+    video_decoder_t decoder;
+    if (!open_video_decoder(&decoder, entry.path.c_str(), LIBRARY_PROBE_SIZE, LIBRARY_ANALYZE_DURATION))
+        return;
+
+    AVFormatContext *format = decoder.format;
+    if (format->duration != AV_NOPTS_VALUE)
+        entry.duration = (double)format->duration / AV_TIME_BASE;
+
+    AVDictionaryEntry *title = av_dict_get(format->metadata, "title", NULL, 0);
+    if (title && *title->value)
+        entry.title = title->value;
+
+    for (unsigned int i = 0; i < format->nb_streams; i++) {
+        AVStream *stream = format->streams[i];
+        AVCodecParameters *params = stream->codecpar;
+
+        if (params->codec_type == AVMEDIA_TYPE_VIDEO && entry.video_codec.empty() && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            entry.video_codec = avcodec_get_name(params->codec_id);
+            entry.width = params->width;
+            entry.height = params->height;
+        } else if (params->codec_type == AVMEDIA_TYPE_AUDIO && entry.audio_codec.empty()) {
+            entry.audio_codec = avcodec_get_name(params->codec_id);
+        }
+    }
+
+    entry.poster = get_poster(&decoder);
+    close_video_decoder(&decoder);
+}
+
+static void probe_disc(library_entry_t &entry) {
+    entry.title = filesystem::path(entry.path).filename().string();
+
+    bluray_disc_summary_t summary;
+    if (!probe_bd_disc(entry.path, &summary)) {
+        fprintf(stderr, "Couldn't scan disc at %s\n", entry.path.c_str());
+        return;
+    }
+
+    if (!summary.disc_name.empty())
+        entry.title = summary.disc_name;
+    entry.duration = summary.duration;
+    entry.title_count = summary.num_titles;
+    entry.video_codec = bd_video_codec(summary.video_coding_type);
+    entry.audio_codec = bd_audio_codec(summary.audio_coding_type);
+    bd_video_size(summary.video_format, &entry.width, &entry.height);
+
+    // Clips inside images aren't reachable by path, so only BDMV trees get a poster.
+    if (bd_image_is_iso(entry.path) || summary.main_clip_id.empty())
+        return;
+
+    string clip_path = entry.path + "/BDMV/STREAM/" + summary.main_clip_id + ".m2ts";
+    video_decoder_t decoder;
+    if (!open_video_decoder(&decoder, clip_path.c_str(), LIBRARY_PROBE_SIZE, LIBRARY_ANALYZE_DURATION))
+        return;
+
+    entry.poster = get_poster(&decoder);
+    close_video_decoder(&decoder);
+}
+
+// Caller holds library_lock. Drops entries under the scanned root that
+// weren't seen this time.
+static void finish_scan() {
+    string prefix = scan_root + "/";
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if ((it->first == scan_root || it->first.compare(0, prefix.size(), prefix) == 0) && !seen.count(it->first)) {
+            library_entry_t removed = it->second;
+            removed.removed = true;
+            removed.poster.clear();
+            updates.push_back(removed);
+            it = entries.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    seen.clear();
+    scanning = false;
+    printf("Library scan of %s finished with %zu entries\n", scan_root.c_str(), entries.size());
+}
+
+static void *library_worker(void *args) {
+    pthread_mutex_lock(&library_lock);
+
+    while (true) {
+        while (jobs.empty())
+            pthread_cond_wait(&job_cond, &library_lock);
+
+        library_job_t job = jobs.front();
+        jobs.pop_front();
+        pthread_mutex_unlock(&library_lock);
+
+        library_entry_t entry = { job.path, job.is_disc, false, job.size, job.mtime };
+        if (job.is_disc)
+            probe_disc(entry);
+        else
+            probe_file(entry);
+
+        pthread_mutex_lock(&library_lock);
+        entries[entry.path] = entry;
+        updates.push_back(entry);
+
+        if (--pending_jobs == 0 && !walking)
+            finish_scan();
+
+        if (notify) notify();
+    }
+
+    return NULL;
+}
+
+// Caller holds library_lock.
+static void queue_job(string path, bool is_disc, const struct stat &info) {
+    seen.insert(path);
+
+    auto it = entries.find(path);
+    if (it != entries.end() && it->second.size == info.st_size && it->second.mtime == info.st_mtime)
+        return;
+
+    jobs.push_back({ path, is_disc, info.st_size, info.st_mtime });
+    pending_jobs++;
+    pthread_cond_signal(&job_cond);
+}
+
+// A BDMV root is stamped by its index.bdmv, since the clips never change alone.
+static bool is_disc_root(const filesystem::path &path, struct stat *info) {
+    return stat((path / "BDMV" / "index.bdmv").c_str(), info) == 0;
+}
+
+static void *library_walker(void *args) {
+    pthread_mutex_lock(&library_lock);
+    string root = scan_root;
+    pthread_mutex_unlock(&library_lock);
+
+    struct stat info;
+    error_code err, entry_err;
+
+    if (is_disc_root(root, &info)) {
+        pthread_mutex_lock(&library_lock);
+        queue_job(root, true, info);
+        pthread_mutex_unlock(&library_lock);
+    } else {
+        filesystem::recursive_directory_iterator it(root, filesystem::directory_options::skip_permission_denied, err);
+        if (err)
+            fprintf(stderr, "Couldn't scan %s: %s\n", root.c_str(), err.message().c_str());
+
+        for (; !err && it != filesystem::recursive_directory_iterator(); it.increment(err)) {
+            const filesystem::path &path = it->path();
+
+            if (it->is_directory(entry_err)) {
+                if (path.filename() == "BDMV") {
+                    it.disable_recursion_pending();
+                } else if (is_disc_root(path, &info)) {
+                    it.disable_recursion_pending();
+                    pthread_mutex_lock(&library_lock);
+                    queue_job(path.string(), true, info);
+                    pthread_mutex_unlock(&library_lock);
+                }
+                continue;
+            }
+
+            string extension = path.extension().string();
+            transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+            bool is_disc = extension == ".iso";
+            if ((!is_disc && !media_extensions.count(extension)) || stat(path.c_str(), &info) != 0)
+                continue;
+
+            pthread_mutex_lock(&library_lock);
+            queue_job(path.string(), is_disc, info);
+            pthread_mutex_unlock(&library_lock);
+        }
+    }
+
+    pthread_mutex_lock(&library_lock);
+    walking = false;
+    if (pending_jobs == 0)
+        finish_scan();
+    if (notify) notify();
+    pthread_mutex_unlock(&library_lock);
+
+    return NULL;
+}
+
+bool library_scan(string root) {
+    while (root.size() > 1 && root.back() == '/')
+        root.pop_back();
+
+    pthread_mutex_lock(&library_lock);
+
+    if (scanning) {
+        pthread_mutex_unlock(&library_lock);
+        return false;
+    }
+
+    if (!workers_running) {
+        for (uint32_t i = 0; i < LIBRARY_WORKERS; i++)
+            pthread_create(&workers[i], NULL, library_worker, NULL);
+        workers_running = true;
+    }
+
+    scan_root = root;
+    scanning = true;
+    walking = true;
+
+    pthread_t walker;
+    pthread_create(&walker, NULL, library_walker, NULL);
+    pthread_detach(walker);
+
+    if (notify) notify();
+    pthread_mutex_unlock(&library_lock);
+
+    return true;
+}
+
+bool library_is_scanning() {
+    pthread_mutex_lock(&library_lock);
+    bool is_scanning = scanning;
+    pthread_mutex_unlock(&library_lock);
+
+    return is_scanning;
+}
+
+vector<library_entry_t> library_take_updates() {
+    pthread_mutex_lock(&library_lock);
+    vector<library_entry_t> taken;
+    taken.swap(updates);
+    pthread_mutex_unlock(&library_lock);
+
+    return taken;
+}
+
+vector<library_entry_t> library_get_entries() {
+    vector<library_entry_t> all;
+
+    pthread_mutex_lock(&library_lock);
+    for (const auto &[path, entry] : entries)
+        all.push_back(entry);
+    pthread_mutex_unlock(&library_lock);
+
+    return all;
+}
+
+void library_set_notify(void (*callback)()) {
+    pthread_mutex_lock(&library_lock);
+    notify = callback;
+    pthread_mutex_unlock(&library_lock);
+}
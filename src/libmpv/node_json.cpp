@@ -0,0 +1,77 @@
+#include "node_json.h"
+
+static void append_string(const char *str, string &out) {
+    out += '"';
+
+    for (const char *c = str; *c; c++) {
+        switch (*c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)*c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                    out += escaped;
+                } else {
+                    out += *c;
+                }
+        }
+    }
+
+    out += '"';
+}
+
+void node_to_json(const mpv_node *node, string &out) {
+    char number[32];
+
+    switch (node->format) {
+        case MPV_FORMAT_STRING:
+        case MPV_FORMAT_OSD_STRING:
+            append_string(node->u.string, out);
+            break;
+        case MPV_FORMAT_FLAG:
+            out += node->u.flag ? '1' : '0';
+            break;
+        case MPV_FORMAT_INT64:
+            snprintf(number, sizeof(number), "%lld", (long long)node->u.int64);
+            out += number;
+            break;
+        case MPV_FORMAT_DOUBLE:
+            if (isfinite(node->u.double_)) {
+                snprintf(number, sizeof(number), "%.17g", node->u.double_);
+                out += number;
+            } else {
+                out += "null";
+            }
+            break;
+        case MPV_FORMAT_NODE_ARRAY: {
+            const mpv_node_list *list = node->u.list;
+            out += '[';
+            for (int i = 0; i < list->num; i++) {
+                if (i) out += ',';
+                node_to_json(&list->values[i], out);
+            }
+            out += ']';
+            break;
+        }
+        case MPV_FORMAT_NODE_MAP: {
+            const mpv_node_list *map = node->u.list;
+            out += '{';
+            for (int i = 0; i < map->num; i++) {
+                if (i) out += ',';
+                append_string(map->keys[i], out);
+                out += ':';
+                node_to_json(&map->values[i], out);
+            }
+            out += '}';
+            break;
+        }
+        default:
+            out += "null";
+    }
+}
@@ -0,0 +1,205 @@
+#include "property_filter.h"
+
+typedef chrono::steady_clock::time_point property_time_t;
+
+typedef struct property_value_t {
+    mpv_format format;
+    double number;
+    int64_t int64;
+    string str;
+} property_value_t;
+
+typedef struct subscription_t {
+    string name;
+    mpv_format format;
+    property_policy_t policy;
+    bool has_sent;
+    property_value_t sent;
+    property_time_t sent_at;
+    bool has_pending;
+    property_value_t pending;
+} subscription_t;
+
+// Ids double as mpv's reply_userdata, so 0 stays free for unfiltered
+// observers.
+static map<uint64_t, subscription_t> subscriptions;
+static map<string, uint64_t> subscription_ids;
+static uint64_t next_id = 1;
+static pthread_mutex_t filter_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool read_value(mpv_event_property *property, property_value_t *value) {
+    value->format = property->format;
+    value->number = 0;
+    value->int64 = 0;
+    value->str.clear();
+
+    switch (property->format) {
+        case MPV_FORMAT_STRING:
+        case MPV_FORMAT_OSD_STRING:
+            value->str = *(const char **)property->data;
+            return true;
+        case MPV_FORMAT_FLAG:
+            value->number = *(int *)property->data;
+            return true;
+        case MPV_FORMAT_INT64:
+            value->int64 = *(int64_t *)property->data;
+            value->number = (double)value->int64;
+            return true;
+        case MPV_FORMAT_DOUBLE:
+            value->number = *(double *)property->data;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static chrono::nanoseconds get_interval(const property_policy_t &policy) {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double>(1.0 / policy.max_rate));
+}
+
+bool property_observe(mpv_handle *mpv, string name, mpv_format format, property_policy_t policy) {
+    pthread_mutex_lock(&filter_lock);
+
+    auto it = subscription_ids.find(name);
+    if (it != subscription_ids.end()) {
+        mpv_unobserve_property(mpv, it->second);
+        subscriptions.erase(it->second);
+        subscription_ids.erase(it);
+    }
+
+    uint64_t id = next_id++;
+    if (mpv_observe_property(mpv, id, name.c_str(), format) < 0) {
+        pthread_mutex_unlock(&filter_lock);
+        fprintf(stderr, "Couldn't observe %s\n", name.c_str());
+        return false;
+    }
+
+    subscription_t &subscription = subscriptions[id];
+    subscription.name = name;
+    subscription.format = format;
+    subscription.policy = policy;
+    subscription.has_sent = false;
+    subscription.has_pending = false;
+    subscription_ids[name] = id;
+
+    pthread_mutex_unlock(&filter_lock);
+    return true;
+}
+
+bool property_unobserve(mpv_handle *mpv, string name) {
+    pthread_mutex_lock(&filter_lock);
+
+    auto it = subscription_ids.find(name);
+    bool found = it != subscription_ids.end();
+    if (found) {
+        mpv_unobserve_property(mpv, it->second);
+        subscriptions.erase(it->second);
+        subscription_ids.erase(it);
+    }
+
+    pthread_mutex_unlock(&filter_lock);
+    return found;
+}
+
+bool property_filter_accept(uint64_t reply_userdata, mpv_event_property *property) {
+    pthread_mutex_lock(&filter_lock);
+
+    auto it = subscriptions.find(reply_userdata);
+    if (it == subscriptions.end()) {
+        pthread_mutex_unlock(&filter_lock);
+        return true;
+    }
+
+    subscription_t &subscription = it->second;
+    const property_policy_t &policy = subscription.policy;
+    property_value_t value;
+    bool accept = true;
+
+    // Unavailable properties and nodes go through untouched, and the next
+    // value after them always counts as a change.
+    if (!read_value(property, &value)) {
+        subscription.has_sent = false;
+        subscription.has_pending = false;
+        pthread_mutex_unlock(&filter_lock);
+        return true;
+    }
+
+    if (subscription.has_sent) {
+        const property_value_t &sent = subscription.sent;
+        bool same_format = sent.format == value.format;
+        bool numeric = value.format == MPV_FORMAT_INT64 || value.format == MPV_FORMAT_DOUBLE;
+        bool equal = same_format && sent.number == value.number && sent.int64 == value.int64 && sent.str == value.str;
+
+        if ((policy.on_change && equal) || (same_format && numeric && policy.min_delta > 0 && fabs(value.number - sent.number) < policy.min_delta)) {
+            // Close enough to what JS already has; anything held is older still.
+            subscription.has_pending = false;
+            accept = false;
+        } else if (policy.max_rate > 0 && chrono::steady_clock::now() - subscription.sent_at < get_interval(policy)) {
+            subscription.pending = value;
+            subscription.has_pending = true;
+            accept = false;
+        }
+    }
+
+    if (accept) {
+        subscription.has_sent = true;
+        subscription.sent = value;
+        subscription.sent_at = chrono::steady_clock::now();
+        subscription.has_pending = false;
+    }
+
+    pthread_mutex_unlock(&filter_lock);
+    return accept;
+}
+
+void property_filter_flush(property_emit_t emit) {
+    property_time_t now = chrono::steady_clock::now();
+    map<string, property_value_t> due;
+
+    pthread_mutex_lock(&filter_lock);
+    for (auto &[id, subscription] : subscriptions) {
+        if (!subscription.has_pending || now - subscription.sent_at < get_interval(subscription.policy))
+            continue;
+
+        due[subscription.name] = subscription.pending;
+        subscription.sent = subscription.pending;
+        subscription.sent_at = now;
+        subscription.has_pending = false;
+    }
+    pthread_mutex_unlock(&filter_lock);
+
+    for (auto &[name, value] : due) {
+        const char *str = value.str.c_str();
+        int flag = (int)value.number;
+        int64_t int64 = value.int64;
+        double number = value.number;
+
+        switch (value.format) {
+            case MPV_FORMAT_STRING:
+            case MPV_FORMAT_OSD_STRING: emit(name.c_str(), value.format, &str); break;
+            case MPV_FORMAT_FLAG: emit(name.c_str(), value.format, &flag); break;
+            case MPV_FORMAT_INT64: emit(name.c_str(), value.format, &int64); break;
+            case MPV_FORMAT_DOUBLE: emit(name.c_str(), value.format, &number); break;
+            default: break;
+        }
+    }
+}
+
+int32_t property_filter_next_flush() {
+    property_time_t now = chrono::steady_clock::now();
+    int64_t next = -1;
+
+    pthread_mutex_lock(&filter_lock);
+    for (auto &[id, subscription] : subscriptions) {
+        if (!subscription.has_pending)
+            continue;
+
+        property_time_t due = subscription.sent_at + get_interval(subscription.policy);
+        int64_t wait = max<int64_t>(0, chrono::duration_cast<chrono::milliseconds>(due - now).count() + 1);
+        if (next < 0 || wait < next)
+            next = wait;
+    }
+    pthread_mutex_unlock(&filter_lock);
+
+    return (int32_t)next;
+}
@@ -0,0 +1,231 @@
+#include "scrub_preview.h"
+
+typedef pair<int64_t, int> scrub_key_t;
+
+typedef struct scrub_request_t {
+    double time;
+    int width;
+    scrub_done_t done;
+    void *arg;
+} scrub_request_t;
+
+typedef struct scrub_entry_t {
+    shared_ptr<const scrub_frame_t> frame;
+    list<scrub_key_t>::iterator lru;
+} scrub_entry_t;
+
+// Only touched by the worker, apart from path changes under scrub_lock.
+static video_decoder_t decoder = { NULL, NULL, -1, NULL };
+static SwsContext *conversion = NULL;
+static string decoder_path;
+static map<scrub_key_t, scrub_entry_t> cache;
+static list<scrub_key_t> lru;
+static AVPacket *packet = NULL;
+static AVFrame *decoded = NULL;
+
+static string path;
+static bool has_request = false;
+static scrub_request_t request;
+static shared_ptr<const scrub_frame_t> last_frame;
+static double last_time = 0;
+static bool worker_running = false;
+static pthread_t worker_thread;
+static pthread_mutex_t scrub_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scrub_cond = PTHREAD_COND_INITIALIZER;
+
+static void close_decoder() {
+    if (decoder.format)
+        close_video_decoder(&decoder);
+    sws_freeContext(conversion);
+    conversion = NULL;
+    cache.clear();
+    lru.clear();
+    decoder_path.clear();
+}
+
+static bool open_decoder(string new_path) {
+    close_decoder();
+    decoder_path = new_path;
+
+    if (new_path.empty() || !open_video_decoder(&decoder, new_path.c_str(), 0, 0))
+        return false;
+
+    if (!decoder.codec) {
+        close_video_decoder(&decoder);
+        return false;
+    }
+
+    // Previews only ever show keyframes.
+    decoder.codec->skip_frame = AVDISCARD_NONKEY;
+    return true;
+}
+
+static shared_ptr<const scrub_frame_t> decode_preview(double time, int width) {
+    if (!decoder.codec)
+        return NULL;
+
+    AVStream *stream = decoder.format->streams[decoder.stream_index];
+    int64_t start_time = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    int64_t timestamp = av_rescale_q((int64_t)(time * AV_TIME_BASE), AV_TIME_BASE_Q, stream->time_base) + start_time;
+
+    if (!keyframe_index_seek(decoder.format, decoder.stream_index, time)
+        && av_seek_frame(decoder.format, decoder.stream_index, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+        return NULL;
+
+    // The first keyframe after the seek names the cache entry, so repeated
+    // hovers anywhere in a GOP cost one packet read.
+    bool found = false;
+    while (av_read_frame(decoder.format, packet) >= 0) {
+        if (packet->stream_index == decoder.stream_index && (packet->flags & AV_PKT_FLAG_KEY)) {
+            found = true;
+            break;
+        }
+        av_packet_unref(packet);
+    }
+
+    if (!found)
+        return NULL;
+
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    scrub_key_t key = { pts, width };
+
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        av_packet_unref(packet);
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return it->second.frame;
+    }
+
+    avcodec_flush_buffers(decoder.codec);
+    bool sent = avcodec_send_packet(decoder.codec, packet) >= 0;
+    av_packet_unref(packet);
+
+    bool ok = sent && avcodec_receive_frame(decoder.codec, decoded) >= 0;
+    if (sent && !ok && avcodec_send_packet(decoder.codec, NULL) >= 0)
+        ok = avcodec_receive_frame(decoder.codec, decoded) >= 0;
+    if (!ok)
+        return NULL;
+
+    shared_ptr<scrub_frame_t> frame = make_shared<scrub_frame_t>();
+    frame->keyframe_time = pts != AV_NOPTS_VALUE ? (pts - start_time) * av_q2d(stream->time_base) : time;
+    frame->width = width;
+    frame->height = max(1, (int)((int64_t)decoded->height * width / decoded->width));
+    frame->rgba.resize((size_t)frame->width * frame->height * 4);
+
+    conversion = sws_getCachedContext(
+        conversion,
+        decoded->width, decoded->height, (AVPixelFormat)decoded->format,
+        frame->width, frame->height, AV_PIX_FMT_RGBA,
+        SWS_FAST_BILINEAR, NULL, NULL, NULL
+    );
+
+    uint8_t *dst[4] = { frame->rgba.data() };
+    int dst_linesize[4] = { frame->width * 4 };
+    sws_scale(conversion, decoded->data, decoded->linesize, 0, decoded->height, dst, dst_linesize);
+    av_frame_unref(decoded);
+
+    while (cache.size() >= SCRUB_CACHE_FRAMES) {
+        cache.erase(lru.back());
+        lru.pop_back();
+    }
+
+    lru.push_front(key);
+    cache[key] = { frame, lru.begin() };
+
+    return frame;
+}
+
+static void *scrub_worker(void *args) {
+    packet = av_packet_alloc();
+    decoded = av_frame_alloc();
+
+    pthread_mutex_lock(&scrub_lock);
+
+    while (true) {
+        while (!has_request && path == decoder_path)
+            pthread_cond_wait(&scrub_cond, &scrub_lock);
+
+        if (path != decoder_path) {
+            string new_path = path;
+            pthread_mutex_unlock(&scrub_lock);
+            open_decoder(new_path);
+            pthread_mutex_lock(&scrub_lock);
+            continue;
+        }
+
+        scrub_request_t current = request;
+        has_request = false;
+        pthread_mutex_unlock(&scrub_lock);
+
+        shared_ptr<const scrub_frame_t> frame = decode_preview(current.time, current.width);
+
+        pthread_mutex_lock(&scrub_lock);
+        if (frame) {
+            last_frame = frame;
+            last_time = current.time;
+        }
+        pthread_mutex_unlock(&scrub_lock);
+
+        if (current.done) current.done(current.arg);
+
+        pthread_mutex_lock(&scrub_lock);
+    }
+
+    return NULL;
+}
+
+void scrub_preview_open(string new_path) {
+    if (new_path.find("://") != string::npos)
+        new_path.clear();
+
+    pthread_mutex_lock(&scrub_lock);
+
+    if (!worker_running && !new_path.empty()) {
+        pthread_create(&worker_thread, NULL, scrub_worker, NULL);
+        worker_running = true;
+    }
+
+    if (path != new_path) {
+        path = new_path;
+        last_frame = NULL;
+        pthread_cond_signal(&scrub_cond);
+    }
+
+    pthread_mutex_unlock(&scrub_lock);
+}
+
+void scrub_preview_close() {
+    scrub_preview_open("");
+}
+
+void scrub_preview_request(double time, int width, scrub_done_t done, void *arg) {
+    width = max(16, min(width, SCRUB_MAX_WIDTH));
+
+    pthread_mutex_lock(&scrub_lock);
+
+    scrub_request_t superseded = request;
+    bool had_request = has_request;
+
+    if (!worker_running || path.empty()) {
+        pthread_mutex_unlock(&scrub_lock);
+        if (done) done(arg);
+        return;
+    }
+
+    request = { time, width, done, arg };
+    has_request = true;
+    pthread_cond_signal(&scrub_cond);
+    pthread_mutex_unlock(&scrub_lock);
+
+    if (had_request && superseded.done)
+        superseded.done(superseded.arg);
+}
+
+shared_ptr<const scrub_frame_t> scrub_preview_get(double *time) {
+    pthread_mutex_lock(&scrub_lock);
+    shared_ptr<const scrub_frame_t> frame = last_frame;
+    if (time) *time = last_time;
+    pthread_mutex_unlock(&scrub_lock);
+
+    return frame;
+}
@@ -0,0 +1,98 @@
+#include "seek_controller.h"
+
+typedef chrono::steady_clock::time_point seek_time_t;
+
+static bool in_flight = false;
+static seek_time_t issued_at;
+static bool has_pending = false;
+static double pending_time = 0;
+static bool pending_precise = false;
+static seek_stats_t stats = { 0, 0, 0, 0, 0 };
+// Seeks that failed or timed out have no latency, so the mean only counts these.
+static uint32_t completed = 0;
+static pthread_mutex_t seek_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Caller holds seek_lock.
+static void issue_seek(mpv_handle *mpv, double time, bool precise) {
+    string target = to_string(time);
+    const char * cmd[] = {"seek", target.c_str(), precise ? "absolute+exact" : "absolute+keyframes", NULL};
+
+    if (mpv_command_async(mpv, SEEK_REPLY_ID, cmd) < 0) {
+        fprintf(stderr, "Couldn't seek to %s\n", target.c_str());
+        return;
+    }
+
+    in_flight = true;
+    issued_at = chrono::steady_clock::now();
+    stats.seeks++;
+}
+
+// Caller holds seek_lock.
+static void issue_pending(mpv_handle *mpv) {
+    in_flight = false;
+    if (!has_pending)
+        return;
+
+    has_pending = false;
+    issue_seek(mpv, pending_time, pending_precise);
+}
+
+void seek_request(mpv_handle *mpv, double time, bool precise) {
+    pthread_mutex_lock(&seek_lock);
+
+    bool timed_out = in_flight && chrono::steady_clock::now() - issued_at > chrono::milliseconds(SEEK_TIMEOUT_MS);
+
+    if (in_flight && !timed_out) {
+        if (has_pending)
+            stats.coalesced++;
+
+        has_pending = true;
+        pending_time = time;
+        pending_precise = precise;
+    } else {
+        has_pending = false;
+        issue_seek(mpv, time, precise);
+    }
+
+    pthread_mutex_unlock(&seek_lock);
+}
+
+void seek_on_playback_restart(mpv_handle *mpv) {
+    pthread_mutex_lock(&seek_lock);
+
+    if (in_flight) {
+        double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - issued_at).count();
+        stats.last_latency = latency;
+        stats.average_latency += (latency - stats.average_latency) / ++completed;
+        stats.max_latency = max(stats.max_latency, latency);
+    }
+
+    issue_pending(mpv);
+    pthread_mutex_unlock(&seek_lock);
+}
+
+// Success is only a queued seek; it's done once playback restarts.
+void seek_on_reply(mpv_handle *mpv, int error) {
+    if (error >= 0)
+        return;
+
+    pthread_mutex_lock(&seek_lock);
+    fprintf(stderr, "Seek failed: %s\n", mpv_error_string(error));
+    issue_pending(mpv);
+    pthread_mutex_unlock(&seek_lock);
+}
+
+void seek_reset() {
+    pthread_mutex_lock(&seek_lock);
+    in_flight = false;
+    has_pending = false;
+    pthread_mutex_unlock(&seek_lock);
+}
+
+seek_stats_t seek_get_stats() {
+    pthread_mutex_lock(&seek_lock);
+    seek_stats_t current = stats;
+    pthread_mutex_unlock(&seek_lock);
+
+    return current;
+}
@@ -0,0 +1,144 @@
+#include "shader_presets.h"
+
+typedef chrono::steady_clock::time_point shader_time_t;
+
+static string shader_dir;
+static set<string> inventory;
+static vector<shader_preset_t> presets;
+static shader_state_t state = { "", 0 };
+static shader_time_t applied_at;
+// Set once mpv has taken the preset, so the next frame is the first one
+// rendered with it.
+static atomic<bool> awaiting_frame(false);
+static pthread_mutex_t presets_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static string trim(const string &str) {
+    size_t start = str.find_first_not_of(" \t\r");
+    if (start == string::npos)
+        return "";
+
+    return str.substr(start, str.find_last_not_of(" \t\r") - start + 1);
+}
+
+static vector<string> split_paths(const string &list) {
+    vector<string> paths;
+    size_t start = 0;
+
+    while (start <= list.size()) {
+        size_t end = list.find(':', start);
+        if (end == string::npos)
+            end = list.size();
+
+        string path = trim(list.substr(start, end - start));
+        if (!path.empty())
+            paths.push_back(path);
+        start = end + 1;
+    }
+
+    return paths;
+}
+
+void shader_presets_load(string dir) {
+    pthread_mutex_lock(&presets_lock);
+    shader_dir = dir;
+    inventory.clear();
+    presets.clear();
+
+    error_code err;
+    for (const auto &entry : filesystem::directory_iterator(dir, err)) {
+        if (entry.is_regular_file(err) && entry.path().extension() == ".glsl")
+            inventory.insert(entry.path().filename().string());
+    }
+
+    ifstream manifest(filesystem::path(dir) / SHADER_PRESETS_MANIFEST);
+    string line;
+    while (getline(manifest, line)) {
+        line = trim(line);
+        size_t separator = line.find('=');
+        if (line.empty() || line[0] == '#' || separator == string::npos)
+            continue;
+
+        shader_preset_t preset = { trim(line.substr(0, separator)), split_paths(line.substr(separator + 1)), true };
+        for (const string &shader : preset.shaders)
+            preset.available = preset.available && inventory.count(shader);
+
+        if (!preset.name.empty() && !preset.shaders.empty())
+            presets.push_back(preset);
+    }
+
+    printf("Found %zu shaders and %zu presets in %s\n", inventory.size(), presets.size(), dir.c_str());
+    pthread_mutex_unlock(&presets_lock);
+}
+
+vector<shader_preset_t> shader_presets_get() {
+    pthread_mutex_lock(&presets_lock);
+    vector<shader_preset_t> all = presets;
+    pthread_mutex_unlock(&presets_lock);
+
+    return all;
+}
+
+uint32_t shader_inventory_count() {
+    pthread_mutex_lock(&presets_lock);
+    uint32_t count = inventory.size();
+    pthread_mutex_unlock(&presets_lock);
+
+    return count;
+}
+
+bool shader_preset_paths(string name, string *paths) {
+    pthread_mutex_lock(&presets_lock);
+
+    bool found = false;
+    for (const shader_preset_t &preset : presets) {
+        if (preset.name != name || !preset.available)
+            continue;
+
+        paths->clear();
+        for (const string &shader : preset.shaders) {
+            if (!paths->empty())
+                *paths += ':';
+            *paths += (filesystem::path(shader_dir) / shader).string();
+        }
+        found = true;
+        break;
+    }
+
+    pthread_mutex_unlock(&presets_lock);
+    return found;
+}
+
+void shader_preset_begin(string name) {
+    pthread_mutex_lock(&presets_lock);
+    state = { name, -1 };
+    applied_at = chrono::steady_clock::now();
+    awaiting_frame = false;
+    pthread_mutex_unlock(&presets_lock);
+}
+
+void shader_preset_on_reply(int error) {
+    if (error < 0) {
+        fprintf(stderr, "Couldn't apply shader preset: %s\n", mpv_error_string(error));
+        return;
+    }
+
+    awaiting_frame = true;
+}
+
+void shader_preset_on_frame() {
+    if (!awaiting_frame.exchange(false))
+        return;
+
+    pthread_mutex_lock(&presets_lock);
+    state.latency = chrono::duration<double, milli>(chrono::steady_clock::now() - applied_at).count();
+    printf("Shader preset %s took %.1f ms to its first frame\n", state.active.empty() ? "(none)" : state.active.c_str(), state.latency);
+    pthread_mutex_unlock(&presets_lock);
+}
+
+shader_state_t shader_preset_state() {
+    pthread_mutex_lock(&presets_lock);
+    shader_state_t current = state;
+    pthread_mutex_unlock(&presets_lock);
+
+    return current;
+}
@@ -0,0 +1,126 @@
+#include "shader_tiers.h"
+
+const vector<string> SHADER_DEFAULT_TIERS = { "anime4k-a-hq", "anime4k-a-fast" };
+
+static vector<string> tiers = { "" };
+static bool adaptive = false;
+static uint32_t tier = 0;
+static uint32_t up_windows = SHADER_TIER_UP_WINDOWS;
+static uint32_t good_windows = 0;
+static uint32_t settle_frames = 0;
+
+// The current window.
+static chrono::steady_clock::time_point window_start;
+static double window_frame_time = 0;
+static uint32_t window_frames = 0;
+static int64_t window_drops = -1;
+
+static atomic<int64_t> drop_count(0);
+static atomic<int64_t> delayed_count(0);
+static pthread_mutex_t tiers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Caller holds tiers_lock.
+static void start_window() {
+    window_start = chrono::steady_clock::now();
+    window_frame_time = 0;
+    window_frames = 0;
+    window_drops = drop_count + delayed_count;
+}
+
+// Caller holds tiers_lock.
+static void change_tier(uint32_t next, string *preset) {
+    tier = next;
+    good_windows = 0;
+    settle_frames = SHADER_TIER_SETTLE_FRAMES;
+    start_window();
+    *preset = tiers[tier];
+}
+
+bool shader_tiers_set(vector<string> names, bool enable, string *preset) {
+    vector<shader_preset_t> presets = shader_presets_get();
+
+    pthread_mutex_lock(&tiers_lock);
+
+    tiers.clear();
+    for (const string &name : names) {
+        bool available = any_of(presets.begin(), presets.end(), [&](const shader_preset_t &p) {
+            return p.name == name && p.available;
+        });
+        if (available)
+            tiers.push_back(name);
+    }
+    tiers.push_back("");
+
+    adaptive = enable;
+    up_windows = SHADER_TIER_UP_WINDOWS;
+    if (adaptive)
+        change_tier(0, preset);
+
+    pthread_mutex_unlock(&tiers_lock);
+    return enable;
+}
+
+void shader_tiers_disable() {
+    pthread_mutex_lock(&tiers_lock);
+    adaptive = false;
+    pthread_mutex_unlock(&tiers_lock);
+}
+
+void shader_tiers_on_drops(uint64_t reply_userdata, int64_t count) {
+    if (reply_userdata == SHADER_TIER_DROPS_ID)
+        drop_count = count;
+    else if (reply_userdata == SHADER_TIER_DELAYED_ID)
+        delayed_count = count;
+}
+
+bool shader_tiers_on_frame(double frame_time, double budget, string *preset) {
+    pthread_mutex_lock(&tiers_lock);
+
+    if (!adaptive || settle_frames) {
+        if (settle_frames && !--settle_frames)
+            start_window();
+        pthread_mutex_unlock(&tiers_lock);
+        return false;
+    }
+
+    window_frame_time += frame_time;
+    window_frames++;
+
+    if (chrono::steady_clock::now() - window_start < chrono::duration<double, milli>(SHADER_TIER_WINDOW_MS)) {
+        pthread_mutex_unlock(&tiers_lock);
+        return false;
+    }
+
+    double average = window_frame_time / window_frames;
+    int64_t drops = drop_count + delayed_count - window_drops;
+    bool changed = false;
+
+    if ((average > budget * SHADER_TIER_DOWN || drops >= SHADER_TIER_MAX_DROPS) && tier + 1 < tiers.size()) {
+        up_windows = min(up_windows * 2, SHADER_TIER_MAX_UP_WINDOWS);
+        printf("Shader tier down to %s: %.1f ms frames, %lld dropped\n",
+            tiers[tier + 1].empty() ? "(none)" : tiers[tier + 1].c_str(), average, (long long)drops);
+        change_tier(tier + 1, preset);
+        changed = true;
+    } else if (average < budget * SHADER_TIER_UP && drops == 0 && tier > 0) {
+        if (++good_windows >= up_windows) {
+            change_tier(tier - 1, preset);
+            changed = true;
+        } else {
+            start_window();
+        }
+    } else {
+        good_windows = 0;
+        start_window();
+    }
+
+    pthread_mutex_unlock(&tiers_lock);
+    return changed;
+}
+
+int32_t shader_tiers_current() {
+    pthread_mutex_lock(&tiers_lock);
+    int32_t current = adaptive ? (int32_t)tier : -1;
+    pthread_mutex_unlock(&tiers_lock);
+
+    return current;
+}
@@ -6,153 +6,196 @@ static void logging(const char *fmt, ...);
 static AVFrame* allocPicture(enum AVPixelFormat pix_fmt, int width, int height);
 static AVFrame* avFrameConvertPixelFormat(AVFrame *src, AVPixelFormat dstFormat);
 static int save_frame(string *path, AVFrame *frame);
-static int decode_packet(string *path, AVPacket *pPacket, AVCodecContext *pCodecContext, AVFrame *pFrame);
+static string encode_rgb_png(uint8_t *data, int linesize, int width, int height);
+static void png_write_buffer(png_structp png, png_bytep data, png_size_t length);
+static bool open_video_stream(video_decoder_t *decoder, const char *path);
+static int read_stream_packet(void *opaque, uint8_t *buf, int size);
+static int64_t seek_stream(void *opaque, int64_t offset, int whence);
 
 void generate_thumbnail(string *path, int64_t offset_in_seconds) {
-    logging("initializing all the containers, codecs and protocols.");
-    AVFormatContext *pFormatContext = avformat_alloc_context();
-    if (!pFormatContext) {
-        logging("ERROR could not allocate memory for Format Context");
+    video_decoder_t decoder;
+    if (!open_video_decoder(&decoder, path->c_str(), 0, 0))
         return;
-    }
 
-    logging("opening the input file (%s) and loading format (container) header", path->c_str());
-    if (avformat_open_input(&pFormatContext, path->c_str(), NULL, NULL) != 0) {
-        logging("ERROR could not open the file");
+    AVFrame *frame = decode_frame_at(&decoder, offset_in_seconds);
+    if (!frame) {
+        logging("No video frame at %" PRId64 "s in %s", offset_in_seconds, path->c_str());
+        close_video_decoder(&decoder);
         return;
     }
 
-    logging("format %s, duration %lld us, bit_rate %lld", pFormatContext->iformat->name, pFormatContext->duration, pFormatContext->bit_rate);
+    AVFrame *rgb = avFrameConvertPixelFormat(frame, AV_PIX_FMT_RGB24);
+    string frame_path = path->substr(0, path->find_last_of(".")) + ".png";
+    save_frame(&frame_path, rgb);
 
-    logging("finding stream info from format");
-    if (avformat_find_stream_info(pFormatContext,  NULL) < 0) {
-        logging("ERROR could not get the stream info");
-        return;
+    av_freep(&rgb->data[0]);
+    av_frame_free(&rgb);
+    av_frame_free(&frame);
+    close_video_decoder(&decoder);
+}
+
+storyboard_t generate_storyboard(string path, uint32_t count, uint32_t tile_width, uint32_t columns) {
+    storyboard_t storyboard = { 0, 0, 0, 0 };
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    video_decoder_t decoder;
+    if (!count || !tile_width || !columns || !open_video_decoder(&decoder, path.c_str(), 0, 0))
+        return storyboard;
+
+    if (!decoder.codec || !decoder.codec->width || !decoder.codec->height) {
+        logging("No video to storyboard in %s", path.c_str());
+        close_video_decoder(&decoder);
+        return storyboard;
     }
-        
-    const AVCodec *pCodec = NULL;
-    AVCodecParameters *pCodecParameters =  NULL;
-    int video_stream_index = -1;
 
-    for (int i = 0; i < pFormatContext->nb_streams; i++) {
-        AVCodecParameters *pLocalCodecParameters = pFormatContext->streams[i]->codecpar;
-        logging("AVStream->time_base before open coded %d/%d", pFormatContext->streams[i]->time_base.num, pFormatContext->streams[i]->time_base.den);
-        logging("AVStream->r_frame_rate before open coded %d/%d", pFormatContext->streams[i]->r_frame_rate.num, pFormatContext->streams[i]->r_frame_rate.den);
-        logging("AVStream->start_time %" PRId64, pFormatContext->streams[i]->start_time);
-        logging("AVStream->duration %" PRId64, pFormatContext->streams[i]->duration);
+    AVCodecContext *codec = decoder.codec;
+    AVStream *stream = decoder.format->streams[decoder.stream_index];
+    double duration = decoder.format->duration != AV_NOPTS_VALUE ? (double)decoder.format->duration / AV_TIME_BASE : 0;
+    int64_t start_time = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
 
-        logging("finding the proper decoder (CODEC)");
+    // Every tile is one seek and one intra frame; nothing between
+    // keyframes is ever sent to the decoder.
+    codec->skip_frame = AVDISCARD_NONKEY;
 
-        const AVCodec *pLocalCodec = avcodec_find_decoder(pLocalCodecParameters->codec_id);
+    storyboard.columns = min(columns, count);
+    storyboard.rows = (count + storyboard.columns - 1) / storyboard.columns;
+    storyboard.tile_width = tile_width;
+    storyboard.tile_height = max(1, (int)((int64_t)codec->height * tile_width / codec->width));
+    storyboard.times.assign(count, -1);
 
-        if (pLocalCodec == NULL) {
-            logging("ERROR unsupported codec!");
-            continue;
-        }
+    int sheet_width = storyboard.tile_width * storyboard.columns;
+    int sheet_height = storyboard.tile_height * storyboard.rows;
+    vector<uint8_t> sheet((size_t)sheet_width * sheet_height * 3, 0);
 
-        if (pLocalCodecParameters->codec_type == AVMEDIA_TYPE_VIDEO) {
-            if (video_stream_index == -1) {
-                video_stream_index = i;
-                pCodec = pLocalCodec;
-                pCodecParameters = pLocalCodecParameters;
-            }
+    SwsContext *conversion = NULL;
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
 
-            logging("Video Codec: resolution %d x %d", pLocalCodecParameters->width, pLocalCodecParameters->height);
-        } else if (pLocalCodecParameters->codec_type == AVMEDIA_TYPE_AUDIO) {
-            logging("Audio Codec: %d channels, sample rate %d", pLocalCodecParameters->ch_layout.nb_channels, pLocalCodecParameters->sample_rate);
+    for (uint32_t tile = 0; tile < count; tile++) {
+        double time = duration * (tile + 0.5) / count;
+        int64_t timestamp = av_rescale_q((int64_t)(time * AV_TIME_BASE), AV_TIME_BASE_Q, stream->time_base) + start_time;
+
+        if (!keyframe_index_seek(decoder.format, decoder.stream_index, time)
+            && av_seek_frame(decoder.format, decoder.stream_index, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+            logging("couldn't seek to %f, decoding from the current position", time);
+        avcodec_flush_buffers(codec);
+
+        bool sent = false;
+        while (!sent && av_read_frame(decoder.format, packet) >= 0) {
+            if (packet->stream_index == decoder.stream_index && (packet->flags & AV_PKT_FLAG_KEY))
+                sent = avcodec_send_packet(codec, packet) >= 0;
+            av_packet_unref(packet);
         }
 
-        logging("\tCodec %s ID %d bit_rate %lld", pLocalCodec->name, pLocalCodec->id, pLocalCodecParameters->bit_rate);
-    }
+        // Decoders with reorder delay only give the frame up once drained.
+        bool decoded = sent && avcodec_receive_frame(codec, frame) >= 0;
+        if (sent && !decoded && avcodec_send_packet(codec, NULL) >= 0)
+            decoded = avcodec_receive_frame(codec, frame) >= 0;
 
-    if (video_stream_index == -1) {
-        logging("File does not contain a video stream!\n");
-        return;
-    }
+        if (!decoded)
+            continue;
 
-    AVCodecContext *pCodecContext = avcodec_alloc_context3(pCodec);
-    if (!pCodecContext) {
-        logging("failed to allocated memory for AVCodecContext\n");
-        return;
-    }
+        int64_t pts = frame->best_effort_timestamp;
+        storyboard.times[tile] = pts != AV_NOPTS_VALUE ? (pts - start_time) * av_q2d(stream->time_base) : time;
 
-    if (avcodec_parameters_to_context(pCodecContext, pCodecParameters) < 0) {
-        logging("failed to copy codec params to codec context\n");
-        return;
-    }
+        // Scale straight into the tile's place in the sheet.
+        conversion = sws_getCachedContext(
+            conversion,
+            frame->width, frame->height, (AVPixelFormat)frame->format,
+            storyboard.tile_width, storyboard.tile_height, AV_PIX_FMT_RGB24,
+            SWS_BILINEAR, NULL, NULL, NULL
+        );
 
-    if (avcodec_open2(pCodecContext, pCodec, NULL) < 0) {
-        logging("failed to open codec through avcodec_open2\n");
-        return;
-    }
+        uint32_t column = tile % storyboard.columns;
+        uint32_t row = tile / storyboard.columns;
+        uint8_t *dst[4] = { sheet.data() + ((size_t)row * storyboard.tile_height * sheet_width + column * storyboard.tile_width) * 3 };
+        int dst_linesize[4] = { sheet_width * 3 };
+        sws_scale(conversion, frame->data, frame->linesize, 0, frame->height, dst, dst_linesize);
 
-    AVFrame *pFrame = av_frame_alloc();
-    if (!pFrame) {
-        logging("failed to allocate memory for AVFrame\n");
-        return;
-    }
-    
-    AVPacket *pPacket = av_packet_alloc();
-    if (!pPacket) {
-        logging("failed to allocate memory for AVPacket\n");
-        return;
+        av_frame_unref(frame);
     }
 
-    int response = 0;
-    double elapsed;
+    sws_freeContext(conversion);
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    close_video_decoder(&decoder);
 
-    while (av_read_frame(pFormatContext, pPacket) >= 0) {
-        if (pPacket->stream_index == video_stream_index) {
-            elapsed = (double)(pPacket->pts - pFormatContext->streams[video_stream_index]->start_time) * pFormatContext->streams[video_stream_index]->time_base.num / pFormatContext->streams[video_stream_index]->time_base.den;
-            printf("elapsed: %f\n", elapsed);
-            logging("AVPacket->pts %" PRId64, pPacket->pts);
-            if (elapsed > offset_in_seconds) {
-                response = decode_packet(path, pPacket, pCodecContext, pFrame);
-                if (response <= 0 && response != AVERROR(EAGAIN))
-                    break;
-            }
-        }
-        av_packet_unref(pPacket);
-    }
+    storyboard.sprite = encode_rgb_png(sheet.data(), sheet_width * 3, sheet_width, sheet_height);
 
-    logging("releasing all the resources");
+    logging("storyboard of %u tiles for %s in %lld ms", count, path.c_str(),
+        (long long)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count());
 
-    avformat_close_input(&pFormatContext);
-    av_packet_free(&pPacket);
-    av_frame_free(&pFrame);
-    avcodec_free_context(&pCodecContext);
+    return storyboard;
 }
 
-static int decode_packet(string *path, AVPacket *pPacket, AVCodecContext *pCodecContext, AVFrame *pFrame) {
-    int response = avcodec_send_packet(pCodecContext, pPacket);
+storyboard_benchmark_t benchmark_storyboard(string path, uint32_t count, uint32_t tile_width) {
+    storyboard_benchmark_t benchmark = { count, 0, 0, 0, 0 };
+
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    storyboard_t storyboard = generate_storyboard(path, count, tile_width, 10);
+    benchmark.storyboard_time = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
 
-    if (response < 0) {
-        logging("Error while sending a packet to the decoder: %s", av_err2str(response));
-        return response;
+    if (storyboard.sprite.empty())
+        return benchmark;
+
+    video_decoder_t decoder;
+    if (!open_video_decoder(&decoder, path.c_str(), 0, 0))
+        return benchmark;
+    if (!decoder.codec) {
+        close_video_decoder(&decoder);
+        return benchmark;
     }
 
-    while (response >= 0) {
-        response = avcodec_receive_frame(pCodecContext, pFrame);
-        if (response == AVERROR_EOF) {
-            break;
-        } else if (response < 0) {
-            if (response != AVERROR(EAGAIN))
-                logging("Error while receiving a frame from the decoder: %s", av_err2str(response));
-            return response;
-        }
+    started = chrono::steady_clock::now();
 
-        pFrame = avFrameConvertPixelFormat(pFrame, AV_PIX_FMT_RGB24);
+    AVStream *stream = decoder.format->streams[decoder.stream_index];
+    int64_t start_time = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    benchmark.duration = decoder.format->duration != AV_NOPTS_VALUE ? (double)decoder.format->duration / AV_TIME_BASE : 0;
 
-        if (response >= 0) {
-            printf("Frame %lld\n", pCodecContext->frame_num);
+    // Same tiles and scaling as the storyboard, so only the way frames
+    // are found differs.
+    vector<uint8_t> tile((size_t)storyboard.tile_width * storyboard.tile_height * 3);
+    SwsContext *conversion = NULL;
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    uint32_t next_tile = 0;
+
+    while (next_tile < count && av_read_frame(decoder.format, packet) >= 0) {
+        bool sent = packet->stream_index == decoder.stream_index && avcodec_send_packet(decoder.codec, packet) >= 0;
+        av_packet_unref(packet);
+
+        while (sent && avcodec_receive_frame(decoder.codec, frame) >= 0) {
+            benchmark.linear_frames++;
+
+            int64_t pts = frame->best_effort_timestamp;
+            double time = pts != AV_NOPTS_VALUE ? (pts - start_time) * av_q2d(stream->time_base) : 0;
+            for (; next_tile < count && time >= benchmark.duration * (next_tile + 0.5) / count; next_tile++) {
+                conversion = sws_getCachedContext(
+                    conversion,
+                    frame->width, frame->height, (AVPixelFormat)frame->format,
+                    storyboard.tile_width, storyboard.tile_height, AV_PIX_FMT_RGB24,
+                    SWS_BILINEAR, NULL, NULL, NULL
+                );
+
+                uint8_t *dst[4] = { tile.data() };
+                int dst_linesize[4] = { (int)storyboard.tile_width * 3 };
+                sws_scale(conversion, frame->data, frame->linesize, 0, frame->height, dst, dst_linesize);
+            }
 
-            string frame_path = path->substr(0, path->find_last_of(".")) + ".png";
-            save_frame(&frame_path, pFrame);
-            break;
+            av_frame_unref(frame);
         }
     }
 
-    return 0;
+    sws_freeContext(conversion);
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    close_video_decoder(&decoder);
+
+    benchmark.linear_time = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+    logging("storyboard benchmark for %s: %u tiles over %.0f s, %.0f ms with keyframe seeks, %.0f ms decoding %u frames linearly",
+        path.c_str(), count, benchmark.duration, benchmark.storyboard_time, benchmark.linear_time, benchmark.linear_frames);
+
+    return benchmark;
 }
 
 static int save_frame(string *path, AVFrame *frame) {
@@ -245,6 +288,206 @@ static AVFrame* avFrameConvertPixelFormat(AVFrame *src, AVPixelFormat dstFormat)
     return dst;
 }
 
+bool open_video_decoder(video_decoder_t *decoder, const char *path, int64_t probesize, int64_t analyzeduration) {
+    *decoder = { NULL, NULL, -1, NULL };
+
+    AVDictionary *options = NULL;
+    if (probesize) av_dict_set_int(&options, "probesize", probesize, 0);
+    if (analyzeduration) av_dict_set_int(&options, "analyzeduration", analyzeduration, 0);
+
+    int err = avformat_open_input(&decoder->format, path, NULL, &options);
+    av_dict_free(&options);
+    if (err < 0) {
+        logging("ERROR could not open %s", path);
+        return false;
+    }
+
+    return open_video_stream(decoder, path);
+}
+
+bool open_video_decoder_stream(video_decoder_t *decoder, unique_ptr<istream> stream, const char *name) {
+    *decoder = { NULL, NULL, -1, NULL };
+    if (!stream || !*stream) {
+        logging("ERROR could not open %s", name);
+        return false;
+    }
+
+    const int buffer_size = 64 * 1024;
+    uint8_t *buffer = (uint8_t *)av_malloc(buffer_size);
+    decoder->io = avio_alloc_context(buffer, buffer_size, 0, stream.release(), read_stream_packet, NULL, seek_stream);
+    decoder->format = avformat_alloc_context();
+    decoder->format->pb = decoder->io;
+    decoder->format->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    if (avformat_open_input(&decoder->format, name, NULL, NULL) < 0) {
+        logging("ERROR could not open %s", name);
+        close_video_decoder(decoder);
+        return false;
+    }
+
+    return open_video_stream(decoder, name);
+}
+
+static bool open_video_stream(video_decoder_t *decoder, const char *path) {
+    if (avformat_find_stream_info(decoder->format, NULL) < 0) {
+        logging("ERROR could not get the stream info of %s", path);
+        close_video_decoder(decoder);
+        return false;
+    }
+
+    const AVCodec *codec = NULL;
+    decoder->stream_index = av_find_best_stream(decoder->format, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (decoder->stream_index < 0 || !codec) {
+        decoder->stream_index = -1;
+        return true;
+    }
+
+    // Callers run several decoders at once, so each one stays single threaded.
+    decoder->codec = avcodec_alloc_context3(codec);
+    if (decoder->codec)
+        decoder->codec->thread_count = 1;
+
+    if (!decoder->codec
+        || avcodec_parameters_to_context(decoder->codec, decoder->format->streams[decoder->stream_index]->codecpar) < 0
+        || avcodec_open2(decoder->codec, codec, NULL) < 0
+    ) {
+        logging("ERROR could not open the video decoder for %s", path);
+        avcodec_free_context(&decoder->codec);
+        decoder->stream_index = -1;
+    }
+
+    return true;
+}
+
+void close_video_decoder(video_decoder_t *decoder) {
+    avcodec_free_context(&decoder->codec);
+    avformat_close_input(&decoder->format);
+    decoder->stream_index = -1;
+
+    // Custom IO is left to the caller by avformat_close_input.
+    if (decoder->io) {
+        delete (istream *)decoder->io->opaque;
+        av_freep(&decoder->io->buffer);
+        avio_context_free(&decoder->io);
+    }
+}
+
+static int read_stream_packet(void *opaque, uint8_t *buf, int size) {
+    istream *stream = (istream *)opaque;
+    stream->read((char *)buf, size);
+    int count = (int)stream->gcount();
+
+    return count > 0 ? count : AVERROR_EOF;
+}
+
+static int64_t seek_stream(void *opaque, int64_t offset, int whence) {
+    istream *stream = (istream *)opaque;
+    stream->clear();
+
+    if (whence & AVSEEK_SIZE) {
+        streampos current = stream->tellg();
+        stream->seekg(0, ios::end);
+        int64_t size = stream->tellg();
+        stream->seekg(current);
+        return size;
+    }
+
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: stream->seekg(offset, ios::beg); break;
+        case SEEK_CUR: stream->seekg(offset, ios::cur); break;
+        case SEEK_END: stream->seekg(offset, ios::end); break;
+        default: return -1;
+    }
+
+    return stream->fail() ? -1 : (int64_t)stream->tellg();
+}
+
+AVFrame *decode_frame_at(video_decoder_t *decoder, double time) {
+    if (!decoder->codec)
+        return NULL;
+
+    AVStream *stream = decoder->format->streams[decoder->stream_index];
+    int64_t timestamp = av_rescale_q((int64_t)(time * AV_TIME_BASE), AV_TIME_BASE_Q, stream->time_base);
+    if (stream->start_time != AV_NOPTS_VALUE)
+        timestamp += stream->start_time;
+
+    if (!keyframe_index_seek(decoder->format, decoder->stream_index, time)
+        && av_seek_frame(decoder->format, decoder->stream_index, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+        logging("couldn't seek to %f, decoding from the current position", time);
+    avcodec_flush_buffers(decoder->codec);
+
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    bool decoded = false;
+
+    while (!decoded && av_read_frame(decoder->format, packet) >= 0) {
+        if (packet->stream_index == decoder->stream_index && avcodec_send_packet(decoder->codec, packet) >= 0)
+            decoded = avcodec_receive_frame(decoder->codec, frame) >= 0;
+        av_packet_unref(packet);
+    }
+
+    if (!decoded && avcodec_send_packet(decoder->codec, NULL) >= 0)
+        decoded = avcodec_receive_frame(decoder->codec, frame) >= 0;
+
+    av_packet_free(&packet);
+    if (!decoded)
+        av_frame_free(&frame);
+
+    return frame;
+}
+
+string encode_frame_png(AVFrame *frame, int width) {
+    if (width <= 0 || width > frame->width)
+        width = frame->width;
+    int height = max(1, (int)((int64_t)frame->height * width / frame->width));
+
+    AVFrame *rgb = allocPicture(AV_PIX_FMT_RGB24, width, height);
+    SwsContext *conversion = sws_getContext(
+        frame->width, frame->height, (AVPixelFormat)frame->format,
+        width, height, AV_PIX_FMT_RGB24,
+        SWS_BILINEAR, NULL, NULL, NULL
+    );
+    sws_scale(conversion, frame->data, frame->linesize, 0, frame->height, rgb->data, rgb->linesize);
+    sws_freeContext(conversion);
+
+    string png = encode_rgb_png(rgb->data[0], rgb->linesize[0], width, height);
+
+    av_freep(&rgb->data[0]);
+    av_frame_free(&rgb);
+
+    return png;
+}
+
+static string encode_rgb_png(uint8_t *data, int linesize, int width, int height) {
+    vector<uint8_t> buffer;
+    vector<png_bytep> row_pointers(height);
+    for (int y = 0; y < height; y++)
+        row_pointers[y] = data + (size_t)y * linesize;
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+
+    if (!info || setjmp(png_jmpbuf(png))) {
+        logging("Error encoding PNG");
+        png_destroy_write_struct(&png, &info);
+        return "";
+    }
+
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+    png_set_rows(png, info, row_pointers.data());
+    png_set_write_fn(png, &buffer, png_write_buffer, NULL);
+    png_write_png(png, info, PNG_TRANSFORM_IDENTITY, NULL);
+    png_destroy_write_struct(&png, &info);
+
+    return base64_encode(buffer.data(), buffer.size());
+}
+
+static void png_write_buffer(png_structp png, png_bytep data, png_size_t length) {
+    vector<uint8_t> *buffer = (vector<uint8_t> *)png_get_io_ptr(png);
+    buffer->insert(buffer->end(), data, data + length);
+}
+
 static void logging(const char *fmt, ...) {
     va_list args;
     fprintf( stdout, "LOG: " );
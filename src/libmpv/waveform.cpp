@@ -0,0 +1,334 @@
+#include "waveform.h"
+
+typedef tuple<string, uint32_t, uint32_t, bool> waveform_key_t;
+
+typedef struct waveform_job_t {
+    waveform_key_t key;
+    waveform_done_t done;
+    void *arg;
+} waveform_job_t;
+
+// Transposed direct form II, one stage of the K-weighting filter.
+typedef struct biquad_t {
+    double b0, b1, b2, a1, a2;
+    double z1, z2;
+} biquad_t;
+
+static map<waveform_key_t, shared_ptr<const waveform_t>> cache;
+static deque<waveform_job_t> jobs;
+static bool worker_running = false;
+static pthread_t worker_thread;
+static pthread_mutex_t waveform_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cond = PTHREAD_COND_INITIALIZER;
+
+static double run_biquad(biquad_t &filter, double x) {
+    double y = filter.b0 * x + filter.z1;
+    filter.z1 = filter.b1 * x - filter.a1 * y + filter.z2;
+    filter.z2 = filter.b2 * x - filter.a2 * y;
+    return y;
+}
+
+// High shelf then high pass from ITU-R BS.1770, worked out for the
+// stream's sample rate instead of the tabulated 48kHz coefficients.
+static void init_k_weighting(biquad_t *shelf, biquad_t *high_pass, int sample_rate) {
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / sample_rate);
+    double vh = pow(10.0, gain / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+
+    *shelf = {
+        (vh + vb * k / q + k * k) / a0,
+        2.0 * (k * k - vh) / a0,
+        (vh - vb * k / q + k * k) / a0,
+        2.0 * (k * k - 1.0) / a0,
+        (1.0 - k / q + k * k) / a0,
+        0, 0
+    };
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+
+    *high_pass = {
+        1.0, -2.0, 1.0,
+        2.0 * (k * k - 1.0) / a0,
+        (1.0 - k / q + k * k) / a0,
+        0, 0
+    };
+}
+
+// Channel weights from BS.1770 for the usual layouts: LFE is left out
+// and surrounds count for +1.5dB.
+static double channel_weight(int channel, int channels) {
+    if (channels < 6) return 1.0;
+    if (channel == 3) return 0.0;
+    if (channel == 4 || channel == 5) return 1.41;
+    return 1.0;
+}
+
+static float get_sample(const AVFrame *frame, int channel, int index, int channels) {
+    AVSampleFormat format = (AVSampleFormat)frame->format;
+    bool planar = av_sample_fmt_is_planar(format);
+    const uint8_t *data = frame->extended_data[planar ? channel : 0];
+    int i = planar ? index : index * channels + channel;
+
+    switch (format) {
+        case AV_SAMPLE_FMT_U8:
+        case AV_SAMPLE_FMT_U8P: return (data[i] - 128) / 128.0f;
+        case AV_SAMPLE_FMT_S16:
+        case AV_SAMPLE_FMT_S16P: return ((const int16_t *)data)[i] / 32768.0f;
+        case AV_SAMPLE_FMT_S32:
+        case AV_SAMPLE_FMT_S32P: return ((const int32_t *)data)[i] / 2147483648.0f;
+        case AV_SAMPLE_FMT_FLT:
+        case AV_SAMPLE_FMT_FLTP: return ((const float *)data)[i];
+        case AV_SAMPLE_FMT_DBL:
+        case AV_SAMPLE_FMT_DBLP: return (float)((const double *)data)[i];
+        default: return 0;
+    }
+}
+
+// mpv numbers audio tracks in stream order, starting from 1.
+static int find_audio_stream(AVFormatContext *format, uint32_t audio_track) {
+    if (!audio_track)
+        return av_find_best_stream(format, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+
+    uint32_t track = 0;
+    for (unsigned int i = 0; i < format->nb_streams; i++)
+        if (format->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && ++track == audio_track)
+            return i;
+
+    return -1;
+}
+
+// Running state for one pass; memory only depends on the bucket count
+// and channel count, never on the file's length.
+typedef struct waveform_state_t {
+    waveform_t *waveform;
+    vector<double> sums;
+    vector<int64_t> counts;
+    double time;
+    int sample_rate;
+    int channels;
+    vector<biquad_t> filters;
+    double block_sum;
+    int block_count;
+    int block_samples;
+    deque<double> blocks;
+} waveform_state_t;
+
+static void add_frame(waveform_state_t &state, const AVFrame *frame, double frame_time, bool with_loudness) {
+    waveform_t *waveform = state.waveform;
+    int channels = frame->ch_layout.nb_channels;
+    if (channels <= 0 || frame->sample_rate <= 0)
+        return;
+
+    if (frame->sample_rate != state.sample_rate || channels != state.channels) {
+        state.sample_rate = frame->sample_rate;
+        state.channels = channels;
+        state.filters.assign(channels * 2, biquad_t {});
+        for (int channel = 0; channel < channels; channel++)
+            init_k_weighting(&state.filters[channel * 2], &state.filters[channel * 2 + 1], state.sample_rate);
+        state.block_samples = max(1, (int)(state.sample_rate * WAVEFORM_LOUDNESS_BLOCK));
+        state.block_sum = 0;
+        state.block_count = 0;
+    }
+
+    if (!isnan(frame_time))
+        state.time = frame_time;
+
+    for (int i = 0; i < frame->nb_samples; i++) {
+        double time = state.time + (double)i / state.sample_rate;
+        uint32_t bucket = (uint32_t)max(0.0, min(time / waveform->bucket_duration, (double)waveform->buckets - 1));
+
+        float mix = 0;
+        for (int channel = 0; channel < channels; channel++) {
+            float sample = get_sample(frame, channel, i, channels);
+            mix += sample;
+
+            if (with_loudness) {
+                double weighted = run_biquad(state.filters[channel * 2 + 1], run_biquad(state.filters[channel * 2], sample));
+                state.block_sum += channel_weight(channel, channels) * weighted * weighted;
+            }
+        }
+        mix /= channels;
+
+        waveform->peaks[bucket] = max(waveform->peaks[bucket], fabsf(mix));
+        state.sums[bucket] += (double)mix * mix;
+        state.counts[bucket]++;
+
+        if (with_loudness && ++state.block_count == state.block_samples) {
+            state.blocks.push_back(state.block_sum / state.block_samples);
+            if (state.blocks.size() > WAVEFORM_LOUDNESS_WINDOW / WAVEFORM_LOUDNESS_BLOCK)
+                state.blocks.pop_front();
+            state.block_sum = 0;
+            state.block_count = 0;
+
+            double mean = 0;
+            for (double block : state.blocks)
+                mean += block;
+            mean /= state.blocks.size();
+
+            // Later blocks overwrite earlier ones, leaving the reading at the bucket's end.
+            waveform->loudness[bucket] = mean > 0 ? max(WAVEFORM_SILENCE, (float)(-0.691 + 10 * log10(mean))) : WAVEFORM_SILENCE;
+        }
+    }
+
+    state.time += (double)frame->nb_samples / state.sample_rate;
+}
+
+static shared_ptr<waveform_t> generate_waveform(string path, uint32_t audio_track, uint32_t buckets, bool with_loudness) {
+    AVFormatContext *format = NULL;
+    if (avformat_open_input(&format, path.c_str(), NULL, NULL) < 0) {
+        fprintf(stderr, "Couldn't open %s for its waveform\n", path.c_str());
+        return NULL;
+    }
+
+    int stream_index = avformat_find_stream_info(format, NULL) >= 0 && format->duration != AV_NOPTS_VALUE && format->duration > 0
+        ? find_audio_stream(format, audio_track)
+        : -1;
+
+    AVStream *stream = stream_index >= 0 ? format->streams[stream_index] : NULL;
+    const AVCodec *decoder = stream ? avcodec_find_decoder(stream->codecpar->codec_id) : NULL;
+    AVCodecContext *codec = decoder ? avcodec_alloc_context3(decoder) : NULL;
+
+    if (codec)
+        codec->thread_count = 1;
+
+    if (!codec
+        || avcodec_parameters_to_context(codec, stream->codecpar) < 0
+        || avcodec_open2(codec, decoder, NULL) < 0
+    ) {
+        fprintf(stderr, "No audio to draw a waveform from in %s\n", path.c_str());
+        avcodec_free_context(&codec);
+        avformat_close_input(&format);
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < format->nb_streams; i++)
+        if ((int)i != stream_index)
+            format->streams[i]->discard = AVDISCARD_ALL;
+
+    shared_ptr<waveform_t> waveform = make_shared<waveform_t>();
+    waveform->buckets = buckets;
+    waveform->bucket_duration = (double)format->duration / AV_TIME_BASE / buckets;
+    waveform->peaks.assign(buckets, 0);
+    waveform->rms.assign(buckets, 0);
+    if (with_loudness)
+        waveform->loudness.assign(buckets, NAN);
+
+    waveform_state_t state = { waveform.get(), vector<double>(buckets, 0), vector<int64_t>(buckets, 0), 0, 0, 0 };
+    int64_t start_time = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    uint32_t packet_count = 0;
+    bool draining = false;
+
+    while (!draining) {
+        if (av_read_frame(format, packet) < 0) {
+            draining = true;
+            avcodec_send_packet(codec, NULL);
+        } else {
+            bool ours = packet->stream_index == stream_index;
+            if (ours)
+                avcodec_send_packet(codec, packet);
+            av_packet_unref(packet);
+            if (!ours)
+                continue;
+        }
+
+        while (avcodec_receive_frame(codec, frame) >= 0) {
+            double frame_time = frame->best_effort_timestamp != AV_NOPTS_VALUE
+                ? (frame->best_effort_timestamp - start_time) * av_q2d(stream->time_base)
+                : NAN;
+            add_frame(state, frame, frame_time, with_loudness);
+            av_frame_unref(frame);
+        }
+
+        if (++packet_count % WAVEFORM_YIELD_PACKETS == 0)
+            sched_yield();
+    }
+
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&codec);
+    avformat_close_input(&format);
+
+    for (uint32_t bucket = 0; bucket < buckets; bucket++) {
+        if (state.counts[bucket])
+            waveform->rms[bucket] = sqrt(state.sums[bucket] / state.counts[bucket]);
+
+        // Buckets shorter than a loudness block carry the last reading.
+        if (with_loudness && isnan(waveform->loudness[bucket]))
+            waveform->loudness[bucket] = bucket ? waveform->loudness[bucket - 1] : WAVEFORM_SILENCE;
+    }
+
+    return waveform;
+}
+
+static void *waveform_worker(void *args) {
+    pthread_mutex_lock(&waveform_lock);
+
+    while (true) {
+        while (jobs.empty())
+            pthread_cond_wait(&job_cond, &waveform_lock);
+
+        waveform_job_t job = jobs.front();
+        jobs.pop_front();
+        bool cached = cache.count(job.key);
+        pthread_mutex_unlock(&waveform_lock);
+
+        if (!cached) {
+            auto [path, audio_track, buckets, loudness] = job.key;
+            shared_ptr<waveform_t> waveform = generate_waveform(path, audio_track, buckets, loudness);
+
+            if (waveform) {
+                pthread_mutex_lock(&waveform_lock);
+                cache[job.key] = waveform;
+                pthread_mutex_unlock(&waveform_lock);
+            }
+        }
+
+        if (job.done) job.done(job.arg);
+
+        pthread_mutex_lock(&waveform_lock);
+    }
+
+    return NULL;
+}
+
+void waveform_request(string path, uint32_t audio_track, uint32_t buckets, bool loudness, waveform_done_t done, void *arg) {
+    waveform_key_t key = { path, audio_track, max(1u, min(buckets, WAVEFORM_MAX_BUCKETS)), loudness };
+
+    pthread_mutex_lock(&waveform_lock);
+
+    if (cache.count(key)) {
+        pthread_mutex_unlock(&waveform_lock);
+        if (done) done(arg);
+        return;
+    }
+
+    if (!worker_running) {
+        pthread_create(&worker_thread, NULL, waveform_worker, NULL);
+        worker_running = true;
+    }
+
+    jobs.push_back({ key, done, arg });
+    pthread_cond_signal(&job_cond);
+    pthread_mutex_unlock(&waveform_lock);
+}
+
+shared_ptr<const waveform_t> waveform_get(string path, uint32_t audio_track, uint32_t buckets, bool loudness) {
+    waveform_key_t key = { path, audio_track, max(1u, min(buckets, WAVEFORM_MAX_BUCKETS)), loudness };
+
+    pthread_mutex_lock(&waveform_lock);
+    auto it = cache.find(key);
+    shared_ptr<const waveform_t> waveform = it != cache.end() ? it->second : NULL;
+    pthread_mutex_unlock(&waveform_lock);
+
+    return waveform;
+}
@@ -53,12 +53,4 @@ interface Vector<T> {
     get(idx: number): T | undefined;
     set(idx: number, val: T): boolean;
     delete(): void;
-}
-
-interface ResumeInfo {
-    blurayTitle: number;
-    objectIdx: number;
-    playlistId: number;
-    playItemId: number;
-    resumeTime: number;
 }
\ No newline at end of file